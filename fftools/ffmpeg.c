@@ -95,6 +95,8 @@ typedef struct BenchmarkTimeStamps {
     int64_t real_usec;
     int64_t user_usec;
     int64_t sys_usec;
+    int64_t vol_csw;
+    int64_t invol_csw;
 } BenchmarkTimeStamps;
 
 static BenchmarkTimeStamps get_benchmark_time_stamps(void);
@@ -959,6 +961,10 @@ static BenchmarkTimeStamps get_benchmark_time_stamps(void)
         (rusage.ru_utime.tv_sec * 1000000LL) + rusage.ru_utime.tv_usec;
     time_stamps.sys_usec =
         (rusage.ru_stime.tv_sec * 1000000LL) + rusage.ru_stime.tv_usec;
+#if HAVE_STRUCT_RUSAGE_RU_NVCSW
+    time_stamps.vol_csw   = rusage.ru_nvcsw;
+    time_stamps.invol_csw = rusage.ru_nivcsw;
+#endif
 #elif HAVE_GETPROCESSTIMES
     HANDLE proc;
     FILETIME c, e, k, u;
@@ -1052,6 +1058,12 @@ int main(int argc, char **argv)
         av_log(NULL, AV_LOG_INFO,
                "bench: utime=%0.3fs stime=%0.3fs rtime=%0.3fs\n",
                utime / 1000000.0, stime / 1000000.0, rtime / 1000000.0);
+#if HAVE_STRUCT_RUSAGE_RU_NVCSW
+        av_log(NULL, AV_LOG_INFO,
+               "bench: csw=%"PRId64" voluntary, %"PRId64" involuntary\n",
+               current_time.vol_csw   - ti.vol_csw,
+               current_time.invol_csw - ti.invol_csw);
+#endif
     }
 
     ret = received_nb_signals                 ? 255 :
@@ -196,6 +196,7 @@ typedef struct OptionsContext {
     SpecifierOptList keep_metadata;
     SpecifierOptList max_frames;
     SpecifierOptList bitstream_filters;
+    SpecifierOptList bsf_pipeline;
     SpecifierOptList codec_tags;
     SpecifierOptList sample_fmts;
     SpecifierOptList qscale;
@@ -289,6 +290,8 @@ enum OFilterFlags {
     OFILTER_FLAG_AUTOSCALE          = (1 << 2),
     OFILTER_FLAG_AUTOROTATE         = (1 << 3),
     OFILTER_FLAG_CROP               = (1 << 4),
+    // allocate output frames in the layout the encoder can consume without a copy
+    OFILTER_FLAG_PACKED_FRAMES      = (1 << 5),
 };
 
 typedef struct OutputFilterOptions {
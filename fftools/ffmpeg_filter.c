@@ -1722,8 +1722,9 @@ static int configure_output_video_filter(FilterGraphPriv *fgp, AVFilterGraph *gr
 
     snprintf(name, sizeof(name), "out_%s", ofilter->output_name);
     ret = avfilter_graph_create_filter(&ofilter->filter,
-                                       avfilter_get_by_name("buffersink"),
-                                       name, NULL, NULL, graph);
+                                       avfilter_get_by_name("buffersink"), name,
+                                       ofp->flags & OFILTER_FLAG_PACKED_FRAMES ?
+                                       "packed_frames=1" : NULL, NULL, graph);
 
     if (ret < 0)
         return ret;
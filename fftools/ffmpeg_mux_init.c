@@ -900,7 +900,9 @@ ost_bind_filter(const Muxer *mux, MuxStream *ms, OutputFilter *ofilter,
 
         .flags = OFILTER_FLAG_DISABLE_CONVERT * !!keep_pix_fmt |
                  OFILTER_FLAG_AUTOSCALE       * !!autoscale    |
-                 OFILTER_FLAG_AUDIO_24BIT * !!(av_get_exact_bits_per_sample(enc_ctx->codec_id) == 24),
+                 OFILTER_FLAG_AUDIO_24BIT * !!(av_get_exact_bits_per_sample(enc_ctx->codec_id) == 24) |
+                 OFILTER_FLAG_PACKED_FRAMES *
+                     !!(enc_ctx->codec->capabilities & AV_CODEC_CAP_ENCODER_PACKED_FRAMES),
     };
 
     snprintf(name, sizeof(name), "#%d:%d", mux->of.index, ost->index);
@@ -1144,7 +1146,7 @@ static int ost_add(Muxer *mux, const OptionsContext *o, enum AVMediaType type,
     SchedulerNode src = { .type = SCH_NODE_TYPE_NONE };
     AVDictionary *encoder_opts = NULL;
     int ret = 0, keep_pix_fmt = 0, autoscale = 1;
-    int threads_manual = 0;
+    int threads_manual = 0, bsf_pipeline = 0;
     AVRational enc_tb = { 0, 0 };
     enum VideoSyncMethod vsync_method = VSYNC_AUTO;
     const char *bsfs = NULL, *time_base = NULL, *codec_tag = NULL;
@@ -1436,6 +1438,11 @@ static int ost_add(Muxer *mux, const OptionsContext *o, enum AVMediaType type,
             av_log(ost, AV_LOG_ERROR, "Error parsing bitstream filter sequence '%s': %s\n", bsfs, av_err2str(ret));
             goto fail;
         }
+
+        opt_match_per_stream_int(ost, &o->bsf_pipeline, oc, st, &bsf_pipeline);
+        if (bsf_pipeline &&
+            av_opt_set_int(ms->bsf_ctx, "pipeline", 1, AV_OPT_SEARCH_CHILDREN) < 0)
+            av_log(ost, AV_LOG_VERBOSE, "Not pipelining a single bitstream filter\n");
     }
 
     opt_match_per_stream_str(ost, &o->codec_tags, oc, st, &codec_tag);
@@ -92,6 +92,9 @@ int recast_media = 0;
 typedef struct GlobalOptionsContext {
     Scheduler      *sch;
 
+    enum SchedulerMode sched_mode;
+    unsigned        sched_threads;
+
     char          **filtergraphs;
     int          nb_filtergraphs;
 } GlobalOptionsContext;
@@ -467,6 +470,36 @@ static int opt_filter_threads(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_sched_mode(void *optctx, const char *opt, const char *arg)
+{
+    GlobalOptionsContext *go = optctx;
+
+    if (!strcmp(arg, "thread"))
+        go->sched_mode = SCH_MODE_THREAD;
+    else if (!strcmp(arg, "pool"))
+        go->sched_mode = SCH_MODE_POOL;
+    else {
+        av_log(NULL, AV_LOG_ERROR, "Invalid scheduling mode: %s\n", arg);
+        return AVERROR(EINVAL);
+    }
+
+    return sch_set_mode(go->sch, go->sched_mode, go->sched_threads);
+}
+
+static int opt_sched_threads(void *optctx, const char *opt, const char *arg)
+{
+    GlobalOptionsContext *go = optctx;
+    double nb_threads;
+    int ret;
+
+    ret = parse_number(opt, arg, OPT_TYPE_INT, 0, INT_MAX, &nb_threads);
+    if (ret < 0)
+        return ret;
+    go->sched_threads = nb_threads;
+
+    return sch_set_mode(go->sch, go->sched_mode, go->sched_threads);
+}
+
 static int opt_abort_on(void *optctx, const char *opt, const char *arg)
 {
     static const AVOption opts[] = {
@@ -1746,6 +1779,12 @@ const OptionDef options[] = {
     { "filter_threads",         OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
         { .func_arg = opt_filter_threads },
         "number of non-complex filter threads" },
+    { "sched_mode",             OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
+        { .func_arg = opt_sched_mode },
+        "how to run the transcoding tasks: thread or pool", "mode" },
+    { "sched_threads",          OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
+        { .func_arg = opt_sched_threads },
+        "number of worker threads of the pool scheduling mode", "number" },
     { "filter_buffered_frames", OPT_TYPE_INT, OPT_EXPERT,
         { &filter_buffered_frames },
         "maximum number of buffered frames in a filter graph" },
@@ -2054,6 +2093,9 @@ const OptionDef options[] = {
     { "bsf", OPT_TYPE_STRING, OPT_PERSTREAM | OPT_EXPERT | OPT_OUTPUT | OPT_INPUT,
         { .off = OFFSET(bitstream_filters) },
         "A comma-separated list of bitstream filters", "bitstream_filters", },
+    { "bsf_pipeline", OPT_TYPE_BOOL, OPT_PERSTREAM | OPT_EXPERT | OPT_OUTPUT,
+        { .off = OFFSET(bsf_pipeline) },
+        "run each output bitstream filter in its own thread" },
 
     { "apre", OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_AUDIO | OPT_EXPERT| OPT_PERFILE | OPT_OUTPUT | OPT_HAS_CANON,
         { .func_arg = opt_preset },
@@ -27,6 +27,7 @@
 #include "ffmpeg_sched.h"
 #include "ffmpeg_utils.h"
 #include "sync_queue.h"
+#include "task_pool.h"
 #include "thread_queue.h"
 
 #include "libavcodec/packet.h"
@@ -37,7 +38,6 @@
 #include "libavutil/frame.h"
 #include "libavutil/mem.h"
 #include "libavutil/thread.h"
-#include "libavutil/threadmessage.h"
 #include "libavutil/time.h"
 
 // 100 ms
@@ -51,7 +51,7 @@ enum QueueType {
 
 typedef struct SchWaiter {
     pthread_mutex_t     lock;
-    pthread_cond_t      cond;
+    TaskPoolCond        cond;
     atomic_int          choked;
 
     // the following are internal state of schedule_update_locked() and must not
@@ -68,6 +68,7 @@ typedef struct SchTask {
     void               *func_arg;
 
     pthread_t           thread;
+    PoolTask           *pool_task;
     int                 thread_running;
 } SchTask;
 
@@ -89,8 +90,9 @@ typedef struct SchDec {
     // Queue for receiving input packets, one stream.
     ThreadQueue        *queue;
 
-    // Queue for sending post-flush end timestamps back to the source
-    AVThreadMessageQueue *queue_end_ts;
+    // Queue for sending post-flush end timestamps back to the source, as the
+    // pts/time_base of empty packets
+    ThreadQueue        *queue_end_ts;
     int                 expect_end_ts;
 
     // temporary storage used by sch_dec_send()
@@ -100,7 +102,12 @@ typedef struct SchDec {
 typedef struct SchSyncQueue {
     SyncQueue          *sq;
     AVFrame            *frame;
+
+    // held while sending to the encoders, which may block; taken with
+    // sq_lock() so that pool tasks waiting for it are suspended
     pthread_mutex_t     lock;
+    TaskPoolCond        cond;
+    int                 locked;
 
     unsigned           *enc_idx;
     unsigned         nb_enc_idx;
@@ -306,6 +313,10 @@ struct Scheduler {
     enum SchedulerState state;
     atomic_int          terminate;
 
+    enum SchedulerMode  mode;
+    unsigned            pool_threads;
+    TaskPool           *pool;
+
     pthread_mutex_t     schedule_lock;
 
     atomic_int_least64_t last_dts;
@@ -327,7 +338,7 @@ static int waiter_wait(Scheduler *sch, SchWaiter *w)
     pthread_mutex_lock(&w->lock);
 
     while (atomic_load(&w->choked) && !atomic_load(&sch->terminate))
-        pthread_cond_wait(&w->cond, &w->lock);
+        tp_cond_wait(&w->cond, &w->lock);
 
     terminate = atomic_load(&sch->terminate);
 
@@ -341,7 +352,7 @@ static void waiter_set(SchWaiter *w, int choked)
     pthread_mutex_lock(&w->lock);
 
     atomic_store(&w->choked, choked);
-    pthread_cond_signal(&w->cond);
+    tp_cond_broadcast(&w->cond);
 
     pthread_mutex_unlock(&w->lock);
 }
@@ -356,7 +367,7 @@ static int waiter_init(SchWaiter *w)
     if (ret)
         return AVERROR(ret);
 
-    ret = pthread_cond_init(&w->cond, NULL);
+    ret = tp_cond_init(&w->cond);
     if (ret)
         return AVERROR(ret);
 
@@ -366,11 +377,28 @@ static int waiter_init(SchWaiter *w)
 static void waiter_uninit(SchWaiter *w)
 {
     pthread_mutex_destroy(&w->lock);
-    pthread_cond_destroy(&w->cond);
+    tp_cond_destroy(&w->cond);
+}
+
+static void sq_lock(SchSyncQueue *sq)
+{
+    pthread_mutex_lock(&sq->lock);
+    while (sq->locked)
+        tp_cond_wait(&sq->cond, &sq->lock);
+    sq->locked = 1;
+    pthread_mutex_unlock(&sq->lock);
+}
+
+static void sq_unlock(SchSyncQueue *sq)
+{
+    pthread_mutex_lock(&sq->lock);
+    sq->locked = 0;
+    tp_cond_broadcast(&sq->cond);
+    pthread_mutex_unlock(&sq->lock);
 }
 
 static int queue_alloc(ThreadQueue **ptq, unsigned nb_streams, unsigned queue_size,
-                       enum QueueType type)
+                       enum QueueType type, unsigned flags)
 {
     ThreadQueue *tq;
 
@@ -391,7 +419,8 @@ static int queue_alloc(ThreadQueue **ptq, unsigned nb_streams, unsigned queue_si
     }
 
     tq = tq_alloc(nb_streams, queue_size,
-                  (type == QUEUE_PACKETS) ? THREAD_QUEUE_PACKETS : THREAD_QUEUE_FRAMES);
+                  (type == QUEUE_PACKETS) ? THREAD_QUEUE_PACKETS : THREAD_QUEUE_FRAMES,
+                  flags);
     if (!tq)
         return AVERROR(ENOMEM);
 
@@ -412,6 +441,17 @@ static int task_start(SchTask *task)
 
     av_assert0(!task->thread_running);
 
+    if (task->parent->pool) {
+        ret = tp_task_start(task->parent->pool, &task->pool_task, task_wrapper, task);
+        if (ret < 0) {
+            av_log(task->func_arg, AV_LOG_ERROR, "Could not start a pool task: %s\n",
+                   av_err2str(ret));
+            return ret;
+        }
+        task->thread_running = 1;
+        return 0;
+    }
+
     ret = pthread_create(&task->thread, NULL, task_wrapper, task);
     if (ret) {
         av_log(task->func_arg, AV_LOG_ERROR, "pthread_create() failed: %s\n",
@@ -547,7 +587,7 @@ void sch_free(Scheduler **psch)
 
         tq_free(&dec->queue);
 
-        av_thread_message_queue_free(&dec->queue_end_ts);
+        tq_free(&dec->queue_end_ts);
 
         for (unsigned j = 0; j < dec->nb_outputs; j++) {
             SchDecOutput *o = &dec->outputs[j];
@@ -579,6 +619,7 @@ void sch_free(Scheduler **psch)
         sq_free(&sq->sq);
         av_frame_free(&sq->frame);
         pthread_mutex_destroy(&sq->lock);
+        tp_cond_destroy(&sq->cond);
         av_freep(&sq->enc_idx);
     }
     av_freep(&sch->sq_enc);
@@ -604,6 +645,8 @@ void sch_free(Scheduler **psch)
     pthread_mutex_destroy(&sch->finish_lock);
     pthread_cond_destroy(&sch->finish_cond);
 
+    tp_free(&sch->pool);
+
     av_freep(psch);
 }
 
@@ -646,6 +689,24 @@ fail:
     return NULL;
 }
 
+int sch_set_mode(Scheduler *sch, enum SchedulerMode mode, unsigned nb_threads)
+{
+    av_assert0(sch->state == SCH_STATE_UNINIT);
+
+#if !HAVE_MAKECONTEXT
+    if (mode == SCH_MODE_POOL) {
+        av_log(sch, AV_LOG_ERROR, "The pool scheduling mode is not supported "
+               "on this system\n");
+        return AVERROR(ENOSYS);
+    }
+#endif
+
+    sch->mode         = mode;
+    sch->pool_threads = nb_threads;
+
+    return 0;
+}
+
 int sch_sdp_filename(Scheduler *sch, const char *sdp_filename)
 {
     av_freep(&sch->sdp_filename);
@@ -799,12 +860,15 @@ int sch_add_dec(Scheduler *sch, SchThreadFunc func, void *ctx, int send_end_ts)
     if (ret < 0)
         return ret;
 
-    ret = queue_alloc(&dec->queue, 1, 0, QUEUE_PACKETS);
+    // decoders have exactly one source; subtitle heartbeats add a second
+    // producer, see sch_mux_sub_heartbeat_add()
+    ret = queue_alloc(&dec->queue, 1, 0, QUEUE_PACKETS, THREAD_QUEUE_ALLOC_SPSC);
     if (ret < 0)
         return ret;
 
     if (send_end_ts) {
-        ret = av_thread_message_queue_alloc(&dec->queue_end_ts, 1, sizeof(Timestamp));
+        ret = queue_alloc(&dec->queue_end_ts, 1, 1, QUEUE_PACKETS,
+                          THREAD_QUEUE_ALLOC_SPSC);
         if (ret < 0)
             return ret;
     }
@@ -843,7 +907,9 @@ int sch_add_enc(Scheduler *sch, SchThreadFunc func, void *ctx,
     if (!enc->send_pkt)
         return AVERROR(ENOMEM);
 
-    ret = queue_alloc(&enc->queue, 1, 0, QUEUE_FRAMES);
+    // encoders have exactly one source; when it is a sync queue, the sending
+    // threads are serialized by its lock
+    ret = queue_alloc(&enc->queue, 1, 0, QUEUE_FRAMES, THREAD_QUEUE_ALLOC_SPSC);
     if (ret < 0)
         return ret;
 
@@ -891,7 +957,7 @@ int sch_add_filtergraph(Scheduler *sch, unsigned nb_inputs, unsigned nb_outputs,
     if (ret < 0)
         return ret;
 
-    ret = queue_alloc(&fg->queue, fg->nb_inputs + 1, 0, QUEUE_FRAMES);
+    ret = queue_alloc(&fg->queue, fg->nb_inputs + 1, 0, QUEUE_FRAMES, 0);
     if (ret < 0)
         return ret;
 
@@ -920,6 +986,10 @@ int sch_add_sq_enc(Scheduler *sch, uint64_t buf_size_us, void *logctx)
     if (ret)
         return AVERROR(ret);
 
+    ret = tp_cond_init(&sq->cond);
+    if (ret)
+        return AVERROR(ret);
+
     return sq - sch->sq_enc;
 }
 
@@ -1293,6 +1363,14 @@ int sch_mux_sub_heartbeat_add(Scheduler *sch, unsigned mux_idx, unsigned stream_
     av_assert0(dec_idx < sch->nb_dec);
     ms->sub_heartbeat_dst[ms->nb_sub_heartbeat_dst - 1] = dec_idx;
 
+    // heartbeat packets are sent from the muxer thread, concurrently with the
+    // decoder's regular source, so its queue cannot be single-producer;
+    // nothing can have been queued yet, since the scheduler is not running
+    tq_free(&sch->dec[dec_idx].queue);
+    ret = queue_alloc(&sch->dec[dec_idx].queue, 1, 0, QUEUE_PACKETS, 0);
+    if (ret < 0)
+        return ret;
+
     if (!mux->sub_heartbeat_pkt) {
         mux->sub_heartbeat_pkt = av_packet_alloc();
         if (!mux->sub_heartbeat_pkt)
@@ -1701,7 +1779,7 @@ static int start_prepare(Scheduler *sch)
         }
 
         ret = queue_alloc(&mux->queue, mux->nb_streams, mux->queue_size,
-                          QUEUE_PACKETS);
+                          QUEUE_PACKETS, 0);
         if (ret < 0)
             return ret;
     }
@@ -1749,6 +1827,15 @@ int sch_start(Scheduler *sch)
     av_assert0(sch->state == SCH_STATE_UNINIT);
     sch->state = SCH_STATE_STARTED;
 
+    if (sch->mode == SCH_MODE_POOL) {
+        ret = tp_alloc(&sch->pool, sch->pool_threads);
+        if (ret < 0) {
+            av_log(sch, AV_LOG_ERROR, "Could not create the task pool: %s\n",
+                   av_err2str(ret));
+            goto fail;
+        }
+    }
+
     for (unsigned i = 0; i < sch->nb_mux; i++) {
         SchMux *mux = &sch->mux[i];
 
@@ -1845,11 +1932,11 @@ static int enc_open(Scheduler *sch, SchEnc *enc, const AVFrame *frame)
         av_assert0(enc->sq_idx[0] >= 0);
         sq = &sch->sq_enc[enc->sq_idx[0]];
 
-        pthread_mutex_lock(&sq->lock);
+        sq_lock(sq);
 
         sq_frame_samples(sq->sq, enc->sq_idx[1], ret);
 
-        pthread_mutex_unlock(&sq->lock);
+        sq_unlock(sq);
     }
 
     return 0;
@@ -1904,7 +1991,7 @@ static int send_to_enc_sq(Scheduler *sch, SchEnc *enc, AVFrame *frame)
         }
     }
 
-    pthread_mutex_lock(&sq->lock);
+    sq_lock(sq);
 
     ret = sq_send(sq->sq, enc->sq_idx[1], SQFRAME(frame));
     if (ret < 0)
@@ -1945,7 +2032,7 @@ static int send_to_enc_sq(Scheduler *sch, SchEnc *enc, AVFrame *frame)
     }
 
 finish:
-    pthread_mutex_unlock(&sq->lock);
+    sq_unlock(sq);
 
     return ret;
 }
@@ -2157,10 +2244,15 @@ static int demux_flush(Scheduler *sch, SchDemux *d, AVPacket *pkt)
 
             if (dec->queue_end_ts) {
                 Timestamp ts;
-                ret = av_thread_message_queue_recv(dec->queue_end_ts, &ts, 0);
+                int dummy;
+
+                ret = tq_receive(dec->queue_end_ts, &dummy, pkt, 0);
                 if (ret < 0)
                     return ret;
 
+                ts = (Timestamp){ .ts = pkt->pts, .tb = pkt->time_base };
+                av_packet_unref(pkt);
+
                 if (max_end_ts.ts == AV_NOPTS_VALUE ||
                     (ts.ts != AV_NOPTS_VALUE &&
                      av_compare_ts(max_end_ts.ts, max_end_ts.tb, ts.ts, ts.tb) < 0))
@@ -2314,8 +2406,7 @@ int sch_dec_receive(Scheduler *sch, unsigned dec_idx, AVPacket *pkt)
 
     // the decoder should have given us post-flush end timestamp in pkt
     if (dec->expect_end_ts) {
-        Timestamp ts = (Timestamp){ .ts = pkt->pts, .tb = pkt->time_base };
-        ret = av_thread_message_queue_send(dec->queue_end_ts, &ts, 0);
+        ret = tq_send(dec->queue_end_ts, 0, pkt);
         if (ret < 0)
             return ret;
 
@@ -2440,7 +2531,7 @@ static int dec_done(Scheduler *sch, unsigned dec_idx)
     // make sure our source does not get stuck waiting for end timestamps
     // that will never arrive
     if (dec->queue_end_ts)
-        av_thread_message_queue_set_err_recv(dec->queue_end_ts, AVERROR_EOF);
+        tq_send_finish(dec->queue_end_ts, 0);
 
     for (unsigned i = 0; i < dec->nb_outputs; i++) {
         SchDecOutput *o = &dec->outputs[i];
@@ -2759,8 +2850,12 @@ static int task_stop(Scheduler *sch, SchTask *task)
     if (!task->thread_running)
         return task_cleanup(sch, task->node);
 
-    ret = pthread_join(task->thread, &thread_ret);
-    av_assert0(ret == 0);
+    if (task->pool_task) {
+        thread_ret = tp_task_join(&task->pool_task);
+    } else {
+        ret = pthread_join(task->thread, &thread_ret);
+        av_assert0(ret == 0);
+    }
 
     task->thread_running = 0;
 
@@ -2825,6 +2920,8 @@ int sch_stop(Scheduler *sch, int64_t *finish_ts)
         ret = err_merge(ret, err);
     }
 
+    tp_free(&sch->pool);
+
     if (finish_ts)
         *finish_ts = progressing_dts(sch, 1);
 
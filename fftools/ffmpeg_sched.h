@@ -130,9 +130,30 @@ typedef int (*SchThreadFunc)(void *arg);
     (SchedulerNode){ .type = SCH_NODE_TYPE_FILTER_OUT,      \
                      .idx = filter, .idx_stream = output }
 
+enum SchedulerMode {
+    /**
+     * Every task runs in its own thread.
+     */
+    SCH_MODE_THREAD,
+    /**
+     * Tasks run on a bounded pool of worker threads. A task waiting for its
+     * input or output queues, or for being unchoked, is suspended and its
+     * worker runs another task.
+     */
+    SCH_MODE_POOL,
+};
+
 Scheduler *sch_alloc(void);
 void sch_free(Scheduler **sch);
 
+/**
+ * Select how the tasks are run, must be called before sch_start().
+ *
+ * @param nb_threads number of worker threads for SCH_MODE_POOL, 0 for the
+ *                   number of CPUs
+ */
+int sch_set_mode(Scheduler *sch, enum SchedulerMode mode, unsigned nb_threads);
+
 int sch_start(Scheduler *sch);
 int sch_stop(Scheduler *sch, int64_t *finish_ts);
 
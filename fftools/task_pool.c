@@ -0,0 +1,614 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+/* The feature macros must come before any system header is included */
+#if HAVE_MMAP && HAVE_MPROTECT && HAVE_SYSCONF
+#   define _DEFAULT_SOURCE
+#   define _SVID_SOURCE // needed for MAP_ANONYMOUS
+#   define _DARWIN_C_SOURCE // needed for MAP_ANON
+#   include <sys/mman.h>
+#   include <unistd.h>
+#   if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
+#       define MAP_ANONYMOUS MAP_ANON
+#   endif
+#endif
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#if HAVE_MAKECONTEXT
+#include <ucontext.h>
+#endif
+
+#include "libavutil/avassert.h"
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+
+#include "task_pool.h"
+
+// used when the default thread stack size cannot be queried
+#define DEFAULT_STACK_SIZE (8 << 20)
+
+#if HAVE_MAKECONTEXT
+
+typedef struct PoolWorker {
+    TaskPool       *pool;
+    pthread_t       thread;
+
+    // scheduling loop of the worker, resumed when the running task suspends
+    ucontext_t      ctx;
+    // task currently running on this worker
+    PoolTask       *cur;
+
+    // run queue, tasks are taken from the head by the worker; tasks that
+    // have not started yet may also be taken by the other workers
+    pthread_mutex_t lock;
+    PoolTask       *head;
+    PoolTask       *tail;
+    // number of tasks in the run queue
+    atomic_int      nb_queued;
+
+    // signalled when a task is queued on this worker,
+    // waited on and protected by TaskPool.lock
+    pthread_cond_t  cond;
+    int             idle;
+} PoolWorker;
+
+struct PoolTask {
+    TaskPool       *pool;
+    // next task in a run queue or in the waiters of a TaskPoolCond
+    PoolTask       *next;
+
+    void         *(*func)(void *arg);
+    void           *arg;
+    void           *ret;
+
+    // worker the task is bound to once it has started, it never runs on
+    // another one, so that thread-local storage stays valid across suspensions
+    PoolWorker     *worker;
+
+    ucontext_t      ctx;
+    void           *stack;
+    void           *stack_map;
+    size_t          stack_map_size;
+
+    // mutex to unlock on behalf of the task once it is suspended
+    pthread_mutex_t *unlock;
+    // the task function returned, the task will not run again
+    int             exiting;
+    // the task is not running anymore and can be freed,
+    // protected by TaskPool.lock
+    int             finished;
+};
+
+struct TaskPool {
+    PoolWorker     *workers;
+    unsigned     nb_workers;
+    unsigned     nb_locks;
+    unsigned     nb_threads;
+
+    size_t          stack_size;
+
+    // number of tasks that have not started yet in the run queues
+    atomic_int      nb_unstarted;
+    // used to spread the new tasks started outside of the pool over the workers
+    atomic_uint     next_worker;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  done_cond;
+    unsigned        nb_idle;
+    int             die;
+};
+
+static pthread_key_t worker_key;
+static AVOnce        worker_key_once = AV_ONCE_INIT;
+static int           worker_key_err;
+
+static void worker_key_init(void)
+{
+    worker_key_err = pthread_key_create(&worker_key, NULL);
+}
+
+static PoolWorker *current_worker(void)
+{
+    if (ff_thread_once(&worker_key_once, worker_key_init) || worker_key_err)
+        return NULL;
+    return pthread_getspecific(worker_key);
+}
+
+static void task_schedule(PoolTask *t)
+{
+    TaskPool *tp  = t->pool;
+    PoolWorker *w = t->worker;
+    const int unstarted = !w;
+
+    // a new task started by a worker is queued on it, as it is likely to
+    // consume the data that was just produced there
+    if (unstarted) {
+        w = current_worker();
+        if (!w || w->pool != tp)
+            w = &tp->workers[atomic_fetch_add(&tp->next_worker, 1) % tp->nb_workers];
+        atomic_fetch_add(&tp->nb_unstarted, 1);
+    }
+
+    t->next = NULL;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->tail)
+        w->tail->next = t;
+    else
+        w->head = t;
+    w->tail = t;
+    atomic_fetch_add(&w->nb_queued, 1);
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_mutex_lock(&tp->lock);
+    if (w->idle) {
+        pthread_cond_signal(&w->cond);
+    } else if (unstarted && tp->nb_idle) {
+        for (unsigned i = 0; i < tp->nb_workers; i++) {
+            if (tp->workers[i].idle) {
+                pthread_cond_signal(&tp->workers[i].cond);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&tp->lock);
+}
+
+static void task_dequeued(PoolWorker *w, PoolTask *t)
+{
+    atomic_fetch_sub(&w->nb_queued, 1);
+    if (!t->worker)
+        atomic_fetch_sub(&w->pool->nb_unstarted, 1);
+}
+
+static PoolTask *queue_pop(PoolWorker *w)
+{
+    PoolTask *t;
+
+    pthread_mutex_lock(&w->lock);
+    t = w->head;
+    if (t) {
+        w->head = t->next;
+        if (!w->head)
+            w->tail = NULL;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    if (t)
+        task_dequeued(w, t);
+
+    return t;
+}
+
+/* Take the first task of another worker's queue that has not started yet. */
+static PoolTask *queue_steal(PoolWorker *w)
+{
+    PoolTask *t, *prev = NULL;
+
+    pthread_mutex_lock(&w->lock);
+    for (t = w->head; t && t->worker; t = t->next)
+        prev = t;
+    if (t) {
+        if (prev)
+            prev->next = t->next;
+        else
+            w->head = t->next;
+        if (w->tail == t)
+            w->tail = prev;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    if (t)
+        task_dequeued(w, t);
+
+    return t;
+}
+
+/* Take a task from our own queue, or a new one from the other workers.
+ * Sleep when there is none, return NULL when the pool is being freed. */
+static PoolTask *next_task(PoolWorker *w)
+{
+    TaskPool *tp = w->pool;
+    const unsigned idx = w - tp->workers;
+
+    while (1) {
+        int die;
+
+        PoolTask *t = queue_pop(w);
+        if (t)
+            return t;
+
+        for (unsigned i = 1; i < tp->nb_workers; i++) {
+            t = queue_steal(&tp->workers[(idx + i) % tp->nb_workers]);
+            if (t)
+                return t;
+        }
+
+        pthread_mutex_lock(&tp->lock);
+        if (!tp->die && !atomic_load(&w->nb_queued) &&
+            !atomic_load(&tp->nb_unstarted)) {
+            w->idle = 1;
+            tp->nb_idle++;
+            pthread_cond_wait(&w->cond, &tp->lock);
+            tp->nb_idle--;
+            w->idle = 0;
+        }
+        die = tp->die;
+        pthread_mutex_unlock(&tp->lock);
+
+        if (die)
+            return NULL;
+    }
+}
+
+static void task_entry(void)
+{
+    PoolTask *t = current_worker()->cur;
+
+    t->ret     = t->func(t->arg);
+    t->exiting = 1;
+
+    setcontext(&t->worker->ctx);
+    av_assert0(0);
+}
+
+static void *worker_thread(void *arg)
+{
+    PoolWorker *w = arg;
+    TaskPool  *tp = w->pool;
+    PoolTask   *t;
+
+    pthread_setspecific(worker_key, w);
+
+    while ((t = next_task(w))) {
+        pthread_mutex_t *unlock;
+
+        if (!t->worker)
+            t->worker = w;
+        av_assert1(t->worker == w);
+
+        w->cur = t;
+        swapcontext(&w->ctx, &t->ctx);
+        w->cur = NULL;
+
+        // the task is suspended in tp_cond_wait(); it may be woken up and
+        // queued again as soon as the mutex is unlocked, so it must not be
+        // touched afterwards
+        unlock    = t->unlock;
+        t->unlock = NULL;
+        if (unlock) {
+            pthread_mutex_unlock(unlock);
+            continue;
+        }
+
+        av_assert0(t->exiting);
+
+        pthread_mutex_lock(&tp->lock);
+        t->finished = 1;
+        pthread_cond_broadcast(&tp->done_cond);
+        pthread_mutex_unlock(&tp->lock);
+    }
+
+    return NULL;
+}
+
+void tp_cond_wait(TaskPoolCond *c, pthread_mutex_t *mutex)
+{
+    PoolWorker *w = current_worker();
+
+    if (w && w->cur) {
+        PoolTask *t = w->cur;
+
+        t->next    = c->waiters;
+        c->waiters = t;
+
+        // the worker unlocks the mutex after switching away from the task,
+        // so that a wakeup cannot resume it before its context is saved
+        t->unlock  = mutex;
+        swapcontext(&t->ctx, &w->ctx);
+
+        pthread_mutex_lock(mutex);
+        return;
+    }
+
+    pthread_cond_wait(&c->cond, mutex);
+}
+
+void tp_cond_broadcast(TaskPoolCond *c)
+{
+    pthread_cond_broadcast(&c->cond);
+
+    while (c->waiters) {
+        PoolTask *t = c->waiters;
+        c->waiters  = t->next;
+        task_schedule(t);
+    }
+}
+
+void tp_free(TaskPool **ptp)
+{
+    TaskPool *tp = *ptp;
+
+    if (!tp)
+        return;
+
+    pthread_mutex_lock(&tp->lock);
+    tp->die = 1;
+    for (unsigned i = 0; i < tp->nb_locks; i++)
+        pthread_cond_signal(&tp->workers[i].cond);
+    pthread_mutex_unlock(&tp->lock);
+
+    for (unsigned i = 0; i < tp->nb_threads; i++)
+        pthread_join(tp->workers[i].thread, NULL);
+
+    for (unsigned i = 0; i < tp->nb_locks; i++) {
+        av_assert0(!tp->workers[i].head);
+        pthread_cond_destroy(&tp->workers[i].cond);
+        pthread_mutex_destroy(&tp->workers[i].lock);
+    }
+    av_freep(&tp->workers);
+
+    pthread_cond_destroy(&tp->done_cond);
+    pthread_mutex_destroy(&tp->lock);
+
+    av_freep(ptp);
+}
+
+int tp_alloc(TaskPool **ptp, unsigned nb_workers)
+{
+    TaskPool *tp;
+    pthread_attr_t attr;
+    int ret;
+
+    ret = ff_thread_once(&worker_key_once, worker_key_init);
+    if (ret || worker_key_err)
+        return AVERROR(ret ? ret : worker_key_err);
+
+    if (!nb_workers)
+        nb_workers = av_cpu_count();
+
+    tp = av_mallocz(sizeof(*tp));
+    if (!tp)
+        return AVERROR(ENOMEM);
+
+    // give the tasks as much stack as they get as threads
+    tp->stack_size = DEFAULT_STACK_SIZE;
+    if (!pthread_attr_init(&attr)) {
+        size_t size;
+        if (!pthread_attr_getstacksize(&attr, &size) && size)
+            tp->stack_size = size;
+        pthread_attr_destroy(&attr);
+    }
+
+    atomic_init(&tp->nb_unstarted, 0);
+    atomic_init(&tp->next_worker,  0);
+
+    ret = pthread_mutex_init(&tp->lock, NULL);
+    if (ret) {
+        av_freep(&tp);
+        return AVERROR(ret);
+    }
+    ret = pthread_cond_init(&tp->done_cond, NULL);
+    if (ret) {
+        pthread_mutex_destroy(&tp->lock);
+        av_freep(&tp);
+        return AVERROR(ret);
+    }
+
+    tp->workers = av_calloc(nb_workers, sizeof(*tp->workers));
+    if (!tp->workers) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    tp->nb_workers = nb_workers;
+
+    // all the run queues must exist before any worker starts stealing
+    for (; tp->nb_locks < nb_workers; tp->nb_locks++) {
+        PoolWorker *w = &tp->workers[tp->nb_locks];
+
+        w->pool = tp;
+        atomic_init(&w->nb_queued, 0);
+        ret = pthread_mutex_init(&w->lock, NULL);
+        if (ret) {
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        ret = pthread_cond_init(&w->cond, NULL);
+        if (ret) {
+            pthread_mutex_destroy(&w->lock);
+            ret = AVERROR(ret);
+            goto fail;
+        }
+    }
+
+    for (; tp->nb_threads < nb_workers; tp->nb_threads++) {
+        PoolWorker *w = &tp->workers[tp->nb_threads];
+
+        ret = pthread_create(&w->thread, NULL, worker_thread, w);
+        if (ret) {
+            ret = AVERROR(ret);
+            goto fail;
+        }
+    }
+
+    *ptp = tp;
+    return 0;
+fail:
+    tp_free(&tp);
+    return ret;
+}
+
+#if HAVE_MMAP && HAVE_MPROTECT && HAVE_SYSCONF && defined(MAP_ANONYMOUS)
+
+/* Map the stack with an inaccessible guard page below it, so that an overflow
+ * faults instead of corrupting other memory. */
+static int stack_alloc(PoolTask *t, size_t size)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    uint8_t *map;
+
+    if (page <= 0)
+        return AVERROR(EINVAL);
+
+    t->stack_map_size = FFALIGN(size, page) + page;
+    map = mmap(NULL, t->stack_map_size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        return AVERROR(ENOMEM);
+    if (mprotect(map, page, PROT_NONE) < 0) {
+        int err = AVERROR(errno);
+        munmap(map, t->stack_map_size);
+        return err;
+    }
+
+    t->stack_map = map;
+    t->stack     = map + page;
+    return 0;
+}
+
+static void stack_free(PoolTask *t)
+{
+    if (t->stack_map)
+        munmap(t->stack_map, t->stack_map_size);
+    t->stack_map = t->stack = NULL;
+}
+
+#else
+
+static int stack_alloc(PoolTask *t, size_t size)
+{
+    t->stack_map_size = size;
+    t->stack_map = t->stack = av_malloc(size);
+    return t->stack ? 0 : AVERROR(ENOMEM);
+}
+
+static void stack_free(PoolTask *t)
+{
+    av_freep(&t->stack_map);
+    t->stack = NULL;
+}
+
+#endif
+
+int tp_task_start(TaskPool *tp, PoolTask **ptask, void *(*func)(void *arg), void *arg)
+{
+    PoolTask *t;
+    int ret;
+
+    t = av_mallocz(sizeof(*t));
+    if (!t)
+        return AVERROR(ENOMEM);
+
+    ret = stack_alloc(t, tp->stack_size);
+    if (ret < 0)
+        goto fail;
+
+    if (getcontext(&t->ctx) < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    t->ctx.uc_stack.ss_sp   = t->stack;
+    t->ctx.uc_stack.ss_size = tp->stack_size;
+    t->ctx.uc_link          = NULL;
+    makecontext(&t->ctx, task_entry, 0);
+
+    t->pool = tp;
+    t->func = func;
+    t->arg  = arg;
+
+    *ptask = t;
+    task_schedule(t);
+
+    return 0;
+fail:
+    stack_free(t);
+    av_freep(&t);
+    return ret;
+}
+
+void *tp_task_join(PoolTask **ptask)
+{
+    PoolTask *t  = *ptask;
+    TaskPool *tp = t->pool;
+    void *ret;
+
+    pthread_mutex_lock(&tp->lock);
+    while (!t->finished)
+        pthread_cond_wait(&tp->done_cond, &tp->lock);
+    pthread_mutex_unlock(&tp->lock);
+
+    ret = t->ret;
+
+    stack_free(t);
+    av_freep(ptask);
+
+    return ret;
+}
+
+#else
+
+void tp_cond_wait(TaskPoolCond *c, pthread_mutex_t *mutex)
+{
+    pthread_cond_wait(&c->cond, mutex);
+}
+
+void tp_cond_broadcast(TaskPoolCond *c)
+{
+    pthread_cond_broadcast(&c->cond);
+}
+
+int tp_alloc(TaskPool **ptp, unsigned nb_workers)
+{
+    return AVERROR(ENOSYS);
+}
+
+void tp_free(TaskPool **ptp)
+{
+}
+
+int tp_task_start(TaskPool *tp, PoolTask **ptask, void *(*func)(void *arg), void *arg)
+{
+    return AVERROR(ENOSYS);
+}
+
+void *tp_task_join(PoolTask **ptask)
+{
+    return NULL;
+}
+
+#endif
+
+int tp_cond_init(TaskPoolCond *c)
+{
+    c->waiters = NULL;
+    return pthread_cond_init(&c->cond, NULL);
+}
+
+void tp_cond_destroy(TaskPoolCond *c)
+{
+    av_assert0(!c->waiters);
+    pthread_cond_destroy(&c->cond);
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef FFTOOLS_TASK_POOL_H
+#define FFTOOLS_TASK_POOL_H
+
+#include "libavutil/thread.h"
+
+/**
+ * A bounded pool of worker threads running tasks as coroutines. A task that
+ * waits on a TaskPoolCond is suspended and its worker picks another runnable
+ * task; idle workers take the tasks that have not started yet from the other
+ * workers' queues.
+ *
+ * Once started, a task always runs on the same worker thread, so thread-local
+ * storage and errno stay valid across suspensions. Tasks must not be suspended
+ * while holding a mutex other than the one passed to tp_cond_wait(), as the
+ * other tasks of their worker would then block on it.
+ *
+ * The stacks of the tasks have the default thread stack size and, where
+ * supported, an inaccessible guard page to catch overflows.
+ */
+typedef struct TaskPool TaskPool;
+typedef struct PoolTask PoolTask;
+
+/**
+ * Condition variable that suspends pool tasks instead of blocking their
+ * worker thread. Threads that are not pool tasks wait on it as on a regular
+ * condition variable.
+ */
+typedef struct TaskPoolCond {
+    pthread_cond_t  cond;
+    // pool tasks waiting on this condition, protected by the mutex
+    // associated with it
+    PoolTask       *waiters;
+} TaskPoolCond;
+
+int  tp_cond_init(TaskPoolCond *c);
+void tp_cond_destroy(TaskPoolCond *c);
+
+/**
+ * Wait on the condition, the mutex must be locked by the caller. Spurious
+ * wakeups may happen, as with pthread_cond_wait().
+ */
+void tp_cond_wait(TaskPoolCond *c, pthread_mutex_t *mutex);
+
+/**
+ * Wake up all waiters, the associated mutex must be locked by the caller.
+ */
+void tp_cond_broadcast(TaskPoolCond *c);
+
+/**
+ * Allocate a pool and start its worker threads.
+ *
+ * @param nb_workers number of worker threads, 0 for the number of CPUs
+ * @return AVERROR(ENOSYS) when coroutines are not supported on this system
+ */
+int  tp_alloc(TaskPool **ptp, unsigned nb_workers);
+
+/**
+ * Stop the worker threads and free the pool. All tasks must have been joined.
+ */
+void tp_free(TaskPool **ptp);
+
+/**
+ * Start running func(arg) as a task of the pool.
+ */
+int  tp_task_start(TaskPool *tp, PoolTask **ptask, void *(*func)(void *arg), void *arg);
+
+/**
+ * Wait for the task to finish, free it and return the value returned by its
+ * function.
+ */
+void *tp_task_join(PoolTask **ptask);
+
+#endif // FFTOOLS_TASK_POOL_H
@@ -16,11 +16,14 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <limits.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <string.h>
 
 #include "libavutil/avassert.h"
 #include "libavutil/container_fifo.h"
+#include "libavutil/cpu.h"
 #include "libavutil/error.h"
 #include "libavutil/fifo.h"
 #include "libavutil/frame.h"
@@ -30,6 +33,7 @@
 
 #include "libavcodec/packet.h"
 
+#include "task_pool.h"
 #include "thread_queue.h"
 
 enum {
@@ -37,6 +41,36 @@ enum {
     FINISHED_RECV = (1 << 1),
 };
 
+/* number of times a lock-free queue re-checks its state before going to sleep */
+#define SPSC_SPIN_COUNT 256
+
+/**
+ * Lock-free ring used for single-producer/single-consumer queues with exactly
+ * one stream. The slots own preallocated AVFrames/AVPackets, data is moved in
+ * and out of them, so the steady state performs no allocations and takes no
+ * locks. The mutex/condition variable of the parent queue are only used for
+ * sleeping, when a side has to block.
+ */
+typedef struct SPSCRing {
+    void          **slots;
+    unsigned int    nb_slots;
+
+    // number of items read/written so far, the difference is the fill level
+    atomic_uint     head;   // written by the consumer only
+    atomic_uint     tail;   // written by the producer only
+
+    // slot indices of the next read/write, private to the respective side
+    unsigned int    read_idx;
+    unsigned int    write_idx;
+
+    atomic_int      finished;
+    atomic_int      choked;
+
+    // number of threads sleeping (or about to sleep) on the condition variable
+    atomic_int      nb_waiters;
+    int             spin_count;
+} SPSCRing;
+
 struct ThreadQueue {
     int             choked;
     int              *finished;
@@ -47,10 +81,88 @@ struct ThreadQueue {
     AVContainerFifo *fifo;
     AVFifo          *fifo_stream_index;
 
+    SPSCRing       *ring;
+
     pthread_mutex_t lock;
-    pthread_cond_t  cond;
+    TaskPoolCond    cond;
 };
 
+static void obj_free(enum ThreadQueueType type, void **obj)
+{
+    if (type == THREAD_QUEUE_FRAMES)
+        av_frame_free((AVFrame**)obj);
+    else
+        av_packet_free((AVPacket**)obj);
+}
+
+static void obj_move_ref(enum ThreadQueueType type, void *dst, void *src)
+{
+    if (type == THREAD_QUEUE_FRAMES)
+        av_frame_move_ref(dst, src);
+    else
+        av_packet_move_ref(dst, src);
+}
+
+static void obj_unref(enum ThreadQueueType type, void *obj)
+{
+    if (type == THREAD_QUEUE_FRAMES)
+        av_frame_unref(obj);
+    else
+        av_packet_unref(obj);
+}
+
+static void ring_free(SPSCRing **pring, enum ThreadQueueType type)
+{
+    SPSCRing *ring = *pring;
+
+    if (!ring)
+        return;
+
+    for (unsigned int i = 0; i < ring->nb_slots; i++)
+        obj_free(type, &ring->slots[i]);
+    av_freep(&ring->slots);
+
+    av_freep(pring);
+}
+
+static SPSCRing *ring_alloc(size_t queue_size, enum ThreadQueueType type)
+{
+    SPSCRing *ring;
+
+    if (!queue_size || queue_size > INT_MAX)
+        return NULL;
+
+    ring = av_mallocz(sizeof(*ring));
+    if (!ring)
+        return NULL;
+
+    ring->slots = av_calloc(queue_size, sizeof(*ring->slots));
+    if (!ring->slots)
+        goto fail;
+    ring->nb_slots = queue_size;
+
+    for (unsigned int i = 0; i < ring->nb_slots; i++) {
+        ring->slots[i] = (type == THREAD_QUEUE_FRAMES) ?
+                         (void*)av_frame_alloc() : (void*)av_packet_alloc();
+        if (!ring->slots[i])
+            goto fail;
+    }
+
+    atomic_init(&ring->head,       0);
+    atomic_init(&ring->tail,       0);
+    atomic_init(&ring->finished,   0);
+    atomic_init(&ring->choked,     0);
+    atomic_init(&ring->nb_waiters, 0);
+
+    // spinning only makes sense when the other side can run concurrently
+    ring->spin_count = av_cpu_count() > 1 ? SPSC_SPIN_COUNT : 0;
+
+    return ring;
+fail:
+    ring_free(&ring, type);
+    return NULL;
+}
+
 void tq_free(ThreadQueue **ptq)
 {
     ThreadQueue *tq = *ptq;
@@ -60,17 +172,18 @@ void tq_free(ThreadQueue **ptq)
 
     av_container_fifo_free(&tq->fifo);
     av_fifo_freep2(&tq->fifo_stream_index);
+    ring_free(&tq->ring, tq->type);
 
     av_freep(&tq->finished);
 
-    pthread_cond_destroy(&tq->cond);
+    tp_cond_destroy(&tq->cond);
     pthread_mutex_destroy(&tq->lock);
 
     av_freep(ptq);
 }
 
 ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
-                      enum ThreadQueueType type)
+                      enum ThreadQueueType type, unsigned flags)
 {
     ThreadQueue *tq;
     int ret;
@@ -79,7 +192,7 @@ ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
     if (!tq)
         return NULL;
 
-    ret = pthread_cond_init(&tq->cond, NULL);
+    ret = tp_cond_init(&tq->cond);
     if (ret) {
         av_freep(&tq);
         return NULL;
@@ -87,7 +200,7 @@ ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
 
     ret = pthread_mutex_init(&tq->lock, NULL);
     if (ret) {
-        pthread_cond_destroy(&tq->cond);
+        tp_cond_destroy(&tq->cond);
         av_freep(&tq);
         return NULL;
     }
@@ -99,6 +212,16 @@ ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
 
     tq->type = type;
 
+    if (flags & THREAD_QUEUE_ALLOC_SPSC) {
+        av_assert0(nb_streams == 1);
+
+        tq->ring = ring_alloc(queue_size, type);
+        if (!tq->ring)
+            goto fail;
+
+        return tq;
+    }
+
     tq->fifo = (type == THREAD_QUEUE_FRAMES) ?
                av_container_fifo_alloc_avframe(0) : av_container_fifo_alloc_avpacket(0);
     if (!tq->fifo)
@@ -114,12 +237,146 @@ fail:
     return NULL;
 }
 
+/* Wake up the other side if it is sleeping; must be called after the state
+ * change that the other side may be waiting for has been published. */
+static void ring_wake(ThreadQueue *tq)
+{
+    if (!atomic_load(&tq->ring->nb_waiters))
+        return;
+
+    pthread_mutex_lock(&tq->lock);
+    tp_cond_broadcast(&tq->cond);
+    pthread_mutex_unlock(&tq->lock);
+}
+
+static int ring_can_send(SPSCRing *ring)
+{
+    return (atomic_load(&ring->finished) & FINISHED_RECV) ||
+           atomic_load_explicit(&ring->tail, memory_order_relaxed) -
+           atomic_load(&ring->head) < ring->nb_slots;
+}
+
+static int ring_can_receive(SPSCRing *ring)
+{
+    return !atomic_load(&ring->choked) &&
+           (atomic_load(&ring->tail) != atomic_load_explicit(&ring->head, memory_order_relaxed) ||
+            atomic_load(&ring->finished));
+}
+
+/* Spin for a while and then sleep on the condition variable until cond()
+ * becomes true. The waiter count is raised before the final check under the
+ * lock, so a state change published by the other side either is seen by that
+ * check or is followed by a broadcast from ring_wake(). */
+static void ring_wait(ThreadQueue *tq, int (*cond)(SPSCRing *ring))
+{
+    SPSCRing *ring = tq->ring;
+
+    for (int i = 0; i < ring->spin_count; i++)
+        if (cond(ring))
+            return;
+
+    atomic_fetch_add(&ring->nb_waiters, 1);
+
+    pthread_mutex_lock(&tq->lock);
+    while (!cond(ring))
+        tp_cond_wait(&tq->cond, &tq->lock);
+    pthread_mutex_unlock(&tq->lock);
+
+    atomic_fetch_sub(&ring->nb_waiters, 1);
+}
+
+static int ring_send(ThreadQueue *tq, void *data)
+{
+    SPSCRing *ring = tq->ring;
+    unsigned int tail;
+
+    if (atomic_load(&ring->finished) & FINISHED_SEND)
+        return AVERROR(EINVAL);
+
+    if (!ring_can_send(ring))
+        ring_wait(tq, ring_can_send);
+
+    if (atomic_load(&ring->finished) & FINISHED_RECV) {
+        atomic_fetch_or(&ring->finished, FINISHED_SEND);
+        return AVERROR_EOF;
+    }
+
+    obj_move_ref(tq->type, ring->slots[ring->write_idx], data);
+    if (++ring->write_idx == ring->nb_slots)
+        ring->write_idx = 0;
+
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store(&ring->tail, tail + 1);
+
+    ring_wake(tq);
+
+    return 0;
+}
+
+static int ring_receive(ThreadQueue *tq, int *stream_idx, void *data, int flags)
+{
+    SPSCRing *ring = tq->ring;
+
+    while (1) {
+        unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        int finished;
+
+        if (!atomic_load(&ring->choked)) {
+            while (atomic_load(&ring->tail) != head) {
+                void *slot = ring->slots[ring->read_idx];
+                int drop   = atomic_load(&ring->finished) & FINISHED_RECV;
+
+                if (++ring->read_idx == ring->nb_slots)
+                    ring->read_idx = 0;
+
+                if (!drop)
+                    obj_move_ref(tq->type, data, slot);
+                else
+                    obj_unref(tq->type, slot);
+
+                atomic_store(&ring->head, ++head);
+                ring_wake(tq);
+
+                if (!drop) {
+                    *stream_idx = 0;
+                    return 0;
+                }
+            }
+
+            finished = atomic_load(&ring->finished);
+            if (finished) {
+                // an item may have been sent right before the stream was
+                // finished, it must be delivered before the EOF
+                if (atomic_load(&ring->tail) != head)
+                    continue;
+
+                /* return EOF to the consumer at most once */
+                if (!(finished & FINISHED_RECV)) {
+                    atomic_fetch_or(&ring->finished, FINISHED_RECV);
+                    ring_wake(tq);
+                    *stream_idx = 0;
+                }
+                return AVERROR_EOF;
+            }
+        }
+
+        if (flags & THREAD_QUEUE_FLAG_NO_BLOCK)
+            return AVERROR(EAGAIN);
+
+        ring_wait(tq, ring_can_receive);
+    }
+}
+
 int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
 {
     int *finished;
     int ret;
 
     av_assert0(stream_idx < tq->nb_streams);
+
+    if (tq->ring)
+        return ring_send(tq, data);
+
     finished = &tq->finished[stream_idx];
 
     pthread_mutex_lock(&tq->lock);
@@ -130,7 +387,7 @@ int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
     }
 
     while (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo_stream_index))
-        pthread_cond_wait(&tq->cond, &tq->lock);
+        tp_cond_wait(&tq->cond, &tq->lock);
 
     if (*finished & FINISHED_RECV) {
         ret = AVERROR_EOF;
@@ -144,7 +401,7 @@ int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
         if (ret < 0)
             goto finish;
 
-        pthread_cond_broadcast(&tq->cond);
+        tp_cond_broadcast(&tq->cond);
     }
 
 finish:
@@ -200,6 +457,9 @@ int tq_receive(ThreadQueue *tq, int *stream_idx, void *data, int flags)
 
     *stream_idx = -1;
 
+    if (tq->ring)
+        return ring_receive(tq, stream_idx, data, flags);
+
     pthread_mutex_lock(&tq->lock);
 
     while (1) {
@@ -209,10 +469,10 @@ int tq_receive(ThreadQueue *tq, int *stream_idx, void *data, int flags)
 
         // signal other threads if the fifo state changed
         if (can_read != av_container_fifo_can_read(tq->fifo))
-            pthread_cond_broadcast(&tq->cond);
+            tp_cond_broadcast(&tq->cond);
 
         if (ret == AVERROR(EAGAIN) && !(flags & THREAD_QUEUE_FLAG_NO_BLOCK)) {
-            pthread_cond_wait(&tq->cond, &tq->lock);
+            tp_cond_wait(&tq->cond, &tq->lock);
             continue;
         }
 
@@ -228,6 +488,13 @@ void tq_send_finish(ThreadQueue *tq, unsigned int stream_idx)
 {
     av_assert0(stream_idx < tq->nb_streams);
 
+    if (tq->ring) {
+        atomic_fetch_or(&tq->ring->finished, FINISHED_SEND);
+        atomic_store(&tq->ring->choked, 0);
+        ring_wake(tq);
+        return;
+    }
+
     pthread_mutex_lock(&tq->lock);
 
     /* mark the stream as send-finished;
@@ -235,7 +502,7 @@ void tq_send_finish(ThreadQueue *tq, unsigned int stream_idx)
      * an EOF and recv-finished flag will be set */
     tq->finished[stream_idx] |= FINISHED_SEND;
     tq->choked = 0;
-    pthread_cond_broadcast(&tq->cond);
+    tp_cond_broadcast(&tq->cond);
 
     pthread_mutex_unlock(&tq->lock);
 }
@@ -244,25 +511,37 @@ void tq_receive_finish(ThreadQueue *tq, unsigned int stream_idx)
 {
     av_assert0(stream_idx < tq->nb_streams);
 
+    if (tq->ring) {
+        atomic_fetch_or(&tq->ring->finished, FINISHED_RECV);
+        ring_wake(tq);
+        return;
+    }
+
     pthread_mutex_lock(&tq->lock);
 
     /* mark the stream as recv-finished;
      * next time the producer thread tries to send for this stream, it will
      * get an EOF and send-finished flag will be set */
     tq->finished[stream_idx] |= FINISHED_RECV;
-    pthread_cond_broadcast(&tq->cond);
+    tp_cond_broadcast(&tq->cond);
 
     pthread_mutex_unlock(&tq->lock);
 }
 
 void tq_choke(ThreadQueue *tq, int choked)
 {
+    if (tq->ring) {
+        if (atomic_exchange(&tq->ring->choked, choked) != choked)
+            ring_wake(tq);
+        return;
+    }
+
     pthread_mutex_lock(&tq->lock);
 
     int prev_choked = tq->choked;
     tq->choked = choked;
     if (choked != prev_choked)
-        pthread_cond_broadcast(&tq->cond);
+        tp_cond_broadcast(&tq->cond);
 
     pthread_mutex_unlock(&tq->lock);
 }
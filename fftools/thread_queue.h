@@ -32,6 +32,14 @@ enum ThreadQueueFlags {
     THREAD_QUEUE_FLAG_NO_BLOCK = (1 << 0),
 };
 
+enum ThreadQueueAllocFlags {
+    /* The queue has exactly one stream, and tq_send()/tq_send_finish() resp.
+     * tq_receive()/tq_receive_finish() are never called concurrently with
+     * each other. Such queues use a lock-free ring buffer, and only fall
+     * back to sleeping on a condition variable when they have to block. */
+    THREAD_QUEUE_ALLOC_SPSC = (1 << 0),
+};
+
 typedef struct ThreadQueue ThreadQueue;
 
 /**
@@ -41,9 +49,10 @@ typedef struct ThreadQueue ThreadQueue;
  *                   maintained
  * @param queue_size number of items that can be stored in the queue without
  *                   blocking
+ * @param flags      combination of THREAD_QUEUE_ALLOC_*
  */
 ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
-                      enum ThreadQueueType type);
+                      enum ThreadQueueType type, unsigned flags);
 void         tq_free(ThreadQueue **tq);
 
 /**
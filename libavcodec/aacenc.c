@@ -445,7 +445,7 @@ static void (*const apply_window[4])(AVFloatDSPContext *fdsp,
 };
 
 static void apply_window_and_mdct(AACEncContext *s, SingleChannelElement *sce,
-                                  float *audio)
+                                  float *audio, int thread)
 {
     int i;
     float *output = sce->ret_buf;
@@ -453,10 +453,10 @@ static void apply_window_and_mdct(AACEncContext *s, SingleChannelElement *sce,
     apply_window[sce->ics.window_sequence[0]](s->fdsp, sce, audio);
 
     if (sce->ics.window_sequence[0] != EIGHT_SHORT_SEQUENCE)
-        s->mdct1024_fn(s->mdct1024, sce->coeffs, output, sizeof(float));
+        s->mdct1024_fn(s->mdct1024[thread], sce->coeffs, output, sizeof(float));
     else
         for (i = 0; i < 1024; i += 128)
-            s->mdct128_fn(s->mdct128, &sce->coeffs[i], output + i*2, sizeof(float));
+            s->mdct128_fn(s->mdct128[thread], &sce->coeffs[i], output + i*2, sizeof(float));
     memcpy(audio, audio + 1024, sizeof(audio[0]) * 1024);
     memcpy(sce->pcoeffs, sce->coeffs, sizeof(sce->pcoeffs));
 }
@@ -1063,19 +1063,145 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+typedef struct AACEncAnalysisArgs {
+    FFPsyWindowInfo *windows;
+    int have_la;                                 ///< lookahead samples are available
+} AACEncAnalysisArgs;
+
+/**
+ * Decide the windows of one channel element and transform its channels.
+ * The elements only touch their own channels here, so this runs as one
+ * slice thread job per element.
+ */
+static int analyze_channel_element(AVCodecContext *avctx, void *arg,
+                                   int el, int thread)
+{
+    AACEncContext *s = avctx->priv_data;
+    const AACEncAnalysisArgs *args = arg;
+    float **samples = s->planar_samples, *samples2, *la, *overlap;
+    int tag      = s->chan_map[el + 1];
+    int chans    = tag == TYPE_CPE ? 2 : 1;
+    ChannelElement *cpe = &s->cpe[el];
+    SingleChannelElement *sce;
+    IndividualChannelStream *ics;
+    FFPsyWindowInfo *wi;
+    int start_ch = 0, wi_paired = 0;
+    int ch, w;
+
+    for (int i = 0; i < el; i++)
+        start_ch += s->chan_map[i + 1] == TYPE_CPE ? 2 : 1;
+    wi = args->windows + start_ch;
+
+    /* Synced pair windows: decide both channels of a CPE together so
+     * their block switching never diverges (see psy window_pair). */
+    if (chans == 2 && tag != TYPE_LFE && s->psy.model->window_pair && args->have_la) {
+        const float *ov0 = &samples[start_ch][0],     *ov1 = &samples[start_ch + 1][0];
+        s->psy.model->window_pair(&s->psy,
+                                  ov0 + 1024, ov0 + 1024 + 448 + 64,
+                                  ov1 + 1024, ov1 + 1024 + 448 + 64,
+                                  start_ch, start_ch + 1,
+                                  cpe->ch[0].ics.window_sequence[0],
+                                  cpe->ch[1].ics.window_sequence[0],
+                                  wi);
+        wi_paired = 1;
+    }
+    for (ch = 0; ch < chans; ch++) {
+        int k, channel = start_ch + ch;
+        float clip_avoidance_factor;
+        sce = &cpe->ch[ch];
+        ics = &sce->ics;
+        overlap  = &samples[channel][0];
+        samples2 = overlap + 1024;
+        la       = samples2 + (448+64);
+        if (!args->have_la)
+            la = NULL;
+        if (tag == TYPE_LFE) {
+            wi[ch].window_type[0] = wi[ch].window_type[1] = ONLY_LONG_SEQUENCE;
+            wi[ch].window_shape   = 0;
+            wi[ch].num_windows    = 1;
+            wi[ch].grouping[0]    = 1;
+            wi[ch].clipping[0]    = 0;
+
+            /* Only the lowest 12 coefficients are used in a LFE channel.
+             * The expression below results in only the bottom 8 coefficients
+             * being used for 11.025kHz to 16kHz sample rates.
+             */
+            ics->num_swb = s->samplerate_index >= 8 ? 1 : 3;
+        } else if (!wi_paired) {
+            wi[ch] = s->psy.model->window(&s->psy, samples2, la, channel,
+                                          ics->window_sequence[0]);
+        }
+        ics->window_sequence[1] = ics->window_sequence[0];
+        ics->window_sequence[0] = wi[ch].window_type[0];
+        ics->use_kb_window[1]   = ics->use_kb_window[0];
+        ics->use_kb_window[0]   = wi[ch].window_shape;
+        ics->num_windows        = wi[ch].num_windows;
+        ics->swb_sizes          = s->psy.bands    [ics->num_windows == 8];
+        ics->num_swb            = tag == TYPE_LFE ? ics->num_swb : s->psy.num_bands[ics->num_windows == 8];
+        ics->max_sfb            = FFMIN(ics->max_sfb, ics->num_swb);
+        ics->swb_offset         = wi[ch].window_type[0] == EIGHT_SHORT_SEQUENCE ?
+                                    ff_swb_offset_128 [s->samplerate_index]:
+                                    ff_swb_offset_1024[s->samplerate_index];
+        ics->tns_max_bands      = wi[ch].window_type[0] == EIGHT_SHORT_SEQUENCE ?
+                                    ff_tns_max_bands_128 [s->samplerate_index]:
+                                    ff_tns_max_bands_1024[s->samplerate_index];
+
+        for (w = 0; w < ics->num_windows; w++)
+            ics->group_len[w] = wi[ch].grouping[w];
+
+        /* Calculate input sample maximums and evaluate clipping risk */
+        clip_avoidance_factor = 0.0f;
+        for (w = 0; w < ics->num_windows; w++) {
+            const float *wbuf = overlap + w * 128;
+            const int wlen = 2048 / ics->num_windows;
+            float max = 0;
+            int j;
+            /* mdct input is 2 * output */
+            for (j = 0; j < wlen; j++)
+                max = FFMAX(max, fabsf(wbuf[j]));
+            wi[ch].clipping[w] = max;
+        }
+        for (w = 0; w < ics->num_windows; w++) {
+            if (wi[ch].clipping[w] > CLIP_AVOIDANCE_FACTOR) {
+                ics->window_clipping[w] = 1;
+                clip_avoidance_factor = FFMAX(clip_avoidance_factor, wi[ch].clipping[w]);
+            } else {
+                ics->window_clipping[w] = 0;
+            }
+        }
+        if (clip_avoidance_factor > CLIP_AVOIDANCE_FACTOR) {
+            ics->clip_avoidance_factor = CLIP_AVOIDANCE_FACTOR / clip_avoidance_factor;
+        } else {
+            ics->clip_avoidance_factor = 1.0f;
+        }
+
+        apply_window_and_mdct(s, sce, overlap, thread);
+
+        for (k = 0; k < 1024; k++) {
+            if (!(fabs(cpe->ch[ch].coeffs[k]) < 1E16)) { // Ensure headroom for energy calculation
+                av_log(avctx, AV_LOG_ERROR, "Input contains (near) NaN/+-Inf\n");
+                return AVERROR(EINVAL);
+            }
+        }
+        avoid_clipping(s, sce);
+    }
+
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
     AACEncContext *s = avctx->priv_data;
-    float **samples = s->planar_samples, *samples2, *la, *overlap;
     ChannelElement *cpe;
     SingleChannelElement *sce;
-    IndividualChannelStream *ics;
     int i, its, ch, w, chans, tag, start_ch, ret, frame_bits;
     int target_bits, rate_bits, too_many_bits, too_few_bits;
     int ms_mode = 0, is_mode = 0, tns_mode = 0, pred_mode = 0;
     int chan_el_counter[4];
+    int el_ret[AAC_MAX_CHANNELS];
     FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
+    AACEncAnalysisArgs args = { windows, !!frame };
 
     /* add current frame to queue */
     if (frame) {
@@ -1091,111 +1217,11 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     if (!avctx->frame_num)
         return 0;
 
-    start_ch = 0;
-    for (i = 0; i < s->chan_map[0]; i++) {
-        FFPsyWindowInfo* wi = windows + start_ch;
-        tag      = s->chan_map[i+1];
-        chans    = tag == TYPE_CPE ? 2 : 1;
-        cpe      = &s->cpe[i];
-        {
-            int wi_paired = 0;
-            /* Synced pair windows: decide both channels of a CPE together so
-             * their block switching never diverges (see psy window_pair). */
-            if (chans == 2 && tag != TYPE_LFE && s->psy.model->window_pair && frame) {
-                const float *ov0 = &samples[start_ch][0],     *ov1 = &samples[start_ch + 1][0];
-                s->psy.model->window_pair(&s->psy,
-                                          ov0 + 1024, ov0 + 1024 + 448 + 64,
-                                          ov1 + 1024, ov1 + 1024 + 448 + 64,
-                                          start_ch, start_ch + 1,
-                                          cpe->ch[0].ics.window_sequence[0],
-                                          cpe->ch[1].ics.window_sequence[0],
-                                          wi);
-                wi_paired = 1;
-            }
-            for (ch = 0; ch < chans; ch++) {
-            int k;
-            float clip_avoidance_factor;
-            sce = &cpe->ch[ch];
-            ics = &sce->ics;
-            s->cur_channel = start_ch + ch;
-            overlap  = &samples[s->cur_channel][0];
-            samples2 = overlap + 1024;
-            la       = samples2 + (448+64);
-            if (!frame)
-                la = NULL;
-            if (tag == TYPE_LFE) {
-                wi[ch].window_type[0] = wi[ch].window_type[1] = ONLY_LONG_SEQUENCE;
-                wi[ch].window_shape   = 0;
-                wi[ch].num_windows    = 1;
-                wi[ch].grouping[0]    = 1;
-                wi[ch].clipping[0]    = 0;
-
-                /* Only the lowest 12 coefficients are used in a LFE channel.
-                 * The expression below results in only the bottom 8 coefficients
-                 * being used for 11.025kHz to 16kHz sample rates.
-                 */
-                ics->num_swb = s->samplerate_index >= 8 ? 1 : 3;
-            } else if (!wi_paired) {
-                wi[ch] = s->psy.model->window(&s->psy, samples2, la, s->cur_channel,
-                                              ics->window_sequence[0]);
-            }
-            ics->window_sequence[1] = ics->window_sequence[0];
-            ics->window_sequence[0] = wi[ch].window_type[0];
-            ics->use_kb_window[1]   = ics->use_kb_window[0];
-            ics->use_kb_window[0]   = wi[ch].window_shape;
-            ics->num_windows        = wi[ch].num_windows;
-            ics->swb_sizes          = s->psy.bands    [ics->num_windows == 8];
-            ics->num_swb            = tag == TYPE_LFE ? ics->num_swb : s->psy.num_bands[ics->num_windows == 8];
-            ics->max_sfb            = FFMIN(ics->max_sfb, ics->num_swb);
-            ics->swb_offset         = wi[ch].window_type[0] == EIGHT_SHORT_SEQUENCE ?
-                                        ff_swb_offset_128 [s->samplerate_index]:
-                                        ff_swb_offset_1024[s->samplerate_index];
-            ics->tns_max_bands      = wi[ch].window_type[0] == EIGHT_SHORT_SEQUENCE ?
-                                        ff_tns_max_bands_128 [s->samplerate_index]:
-                                        ff_tns_max_bands_1024[s->samplerate_index];
-
-            for (w = 0; w < ics->num_windows; w++)
-                ics->group_len[w] = wi[ch].grouping[w];
-
-            /* Calculate input sample maximums and evaluate clipping risk */
-            clip_avoidance_factor = 0.0f;
-            for (w = 0; w < ics->num_windows; w++) {
-                const float *wbuf = overlap + w * 128;
-                const int wlen = 2048 / ics->num_windows;
-                float max = 0;
-                int j;
-                /* mdct input is 2 * output */
-                for (j = 0; j < wlen; j++)
-                    max = FFMAX(max, fabsf(wbuf[j]));
-                wi[ch].clipping[w] = max;
-            }
-            for (w = 0; w < ics->num_windows; w++) {
-                if (wi[ch].clipping[w] > CLIP_AVOIDANCE_FACTOR) {
-                    ics->window_clipping[w] = 1;
-                    clip_avoidance_factor = FFMAX(clip_avoidance_factor, wi[ch].clipping[w]);
-                } else {
-                    ics->window_clipping[w] = 0;
-                }
-            }
-            if (clip_avoidance_factor > CLIP_AVOIDANCE_FACTOR) {
-                ics->clip_avoidance_factor = CLIP_AVOIDANCE_FACTOR / clip_avoidance_factor;
-            } else {
-                ics->clip_avoidance_factor = 1.0f;
-            }
-
-            apply_window_and_mdct(s, sce, overlap);
+    avctx->execute2(avctx, analyze_channel_element, &args, el_ret, s->chan_map[0]);
+    for (i = 0; i < s->chan_map[0]; i++)
+        if (el_ret[i] < 0)
+            return el_ret[i];
 
-            for (k = 0; k < 1024; k++) {
-                if (!(fabs(cpe->ch[ch].coeffs[k]) < 1E16)) { // Ensure headroom for energy calculation
-                    av_log(avctx, AV_LOG_ERROR, "Input contains (near) NaN/+-Inf\n");
-                    return AVERROR(EINVAL);
-                }
-            }
-            avoid_clipping(s, sce);
-        }
-        }
-        start_ch += chans;
-    }
     if ((ret = ff_alloc_packet(avctx, avpkt, 8192 * s->channels)) < 0)
         return ret;
     frame_bits = its = 0;
@@ -1510,8 +1536,12 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
            s->stat_cpe_bands ? 100.0 * s->stat_is         / s->stat_cpe_bands           : 0.0,
            s->stat_ch_bands  ? 100.0 * s->stat_pns        / s->stat_ch_bands            : 0.0);
 
-    av_tx_uninit(&s->mdct1024);
-    av_tx_uninit(&s->mdct128);
+    for (int i = 0; i < s->nb_mdct; i++) {
+        av_tx_uninit(&s->mdct1024[i]);
+        av_tx_uninit(&s->mdct128[i]);
+    }
+    av_freep(&s->mdct1024);
+    av_freep(&s->mdct128);
     ff_psy_end(&s->psy);
     ff_lpc_end(&s->lpc);
     av_freep(&s->buffer.samples);
@@ -1531,12 +1561,20 @@ static av_cold int dsp_init(AVCodecContext *avctx, AACEncContext *s)
     if (!s->fdsp)
         return AVERROR(ENOMEM);
 
-    if ((ret = av_tx_init(&s->mdct1024, &s->mdct1024_fn, AV_TX_FLOAT_MDCT, 0,
-                          1024, &scale, 0)) < 0)
-        return ret;
-    if ((ret = av_tx_init(&s->mdct128, &s->mdct128_fn,   AV_TX_FLOAT_MDCT, 0,
-                          128, &scale, 0)) < 0)
-        return ret;
+    /* The transforms keep scratch buffers, so every slice thread needs its own */
+    s->nb_mdct = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+    if (!FF_ALLOCZ_TYPED_ARRAY(s->mdct1024, s->nb_mdct) ||
+        !FF_ALLOCZ_TYPED_ARRAY(s->mdct128,  s->nb_mdct))
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < s->nb_mdct; i++) {
+        if ((ret = av_tx_init(&s->mdct1024[i], &s->mdct1024_fn, AV_TX_FLOAT_MDCT, 0,
+                              1024, &scale, 0)) < 0)
+            return ret;
+        if ((ret = av_tx_init(&s->mdct128[i], &s->mdct128_fn,   AV_TX_FLOAT_MDCT, 0,
+                              128, &scale, 0)) < 0)
+            return ret;
+    }
 
     return 0;
 }
@@ -1753,7 +1791,8 @@ const FFCodec ff_aac_encoder = {
     .p.type         = AVMEDIA_TYPE_AUDIO,
     .p.id           = AV_CODEC_ID_AAC,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_SMALL_LAST_FRAME,
+                      AV_CODEC_CAP_SMALL_LAST_FRAME |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .priv_data_size = sizeof(AACEncContext),
     .init           = aac_encode_init,
     FF_CODEC_ENCODE_CB(aac_encode_frame),
@@ -259,10 +259,11 @@ typedef struct AACEncContext {
     AVClass *av_class;
     AACEncOptions options;                       ///< encoding options
     PutBitContext pb;
-    AVTXContext *mdct1024;                       ///< long (1024 samples) frame transform context
+    AVTXContext **mdct1024;                      ///< long (1024 samples) frame transform contexts, one per slice thread
     av_tx_fn mdct1024_fn;
-    AVTXContext *mdct128;                        ///< short (128 samples) frame transform context
+    AVTXContext **mdct128;                       ///< short (128 samples) frame transform contexts, one per slice thread
     av_tx_fn mdct128_fn;
+    int nb_mdct;                                 ///< number of transform contexts
     AVFloatDSPContext *fdsp;
     AACPCEInfo pce;                              ///< PCE data, if needed
     float *planar_samples[16];                   ///< saved preprocessed input
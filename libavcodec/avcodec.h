@@ -2413,6 +2413,64 @@ int avcodec_receive_frame_flags(AVCodecContext *avctx, AVFrame *frame, unsigned
  */
 int avcodec_receive_frame(AVCodecContext *avctx, AVFrame *frame);
 
+/**
+ * The frame contained in the packet is not wanted by the caller of
+ * avcodec_decode_batch(). It is still decoded if later frames may depend on
+ * it, but it is not returned. Decoders which can tell that the frame is not
+ * used for reference skip decoding it entirely, as with
+ * AVCodecContext.skip_frame set to AVDISCARD_NONREF.
+ *
+ * The hint is carried by the packet as AV_PKT_FLAG_DISCARD, so it follows it
+ * through the decoder's bitstream filters and applies when that packet is
+ * decoded. Packets which already have AV_PKT_FLAG_DISCARD set are treated the
+ * same. A packet which is only decoded after avcodec_decode_batch() returned,
+ * e.g. by a later avcodec_receive_frame() call, is not skipped, but its frame
+ * is still not returned.
+ */
+#define AV_CODEC_BATCH_HINT_DISCARD (1 << 0)
+
+/**
+ * Decode a batch of packets, e.g. to extract every Nth frame of a stream.
+ *
+ * This is equivalent to calling avcodec_send_packet() for every packet, each
+ * time followed by avcodec_receive_frame() until it returns AVERROR(EAGAIN),
+ * but is done in a single call, and allows skipping the decoding of unwanted
+ * frames with per-packet hints.
+ *
+ * The call stops early when the frames array is full. The frames which are
+ * still buffered in the decoder at this point are returned by the next call,
+ * which must then be passed the packets which were not consumed.
+ *
+ * @param avctx     codec context of an opened audio or video decoder
+ * @param pkts      packets to decode. They are not modified, except that their
+ *                  flags are temporarily changed during the call. A NULL entry
+ *                  (or a packet with data set to NULL and size set to 0) is a
+ *                  flush packet, as with avcodec_send_packet().
+ * @param hints     combination of AV_CODEC_BATCH_HINT_* flags for each packet,
+ *                  may be NULL
+ * @param[in,out] nb_pkts   on input the number of packets, on output the
+ *                          number of packets sent to the decoder
+ * @param frames    array of allocated frames receiving the decoded output
+ * @param[in,out] nb_frames on input the number of entries in frames, which
+ *                          must be positive, on output the number of frames
+ *                          returned; the other entries are unreferenced
+ *
+ * *nb_pkts and *nb_frames are set on all return values, and the returned
+ * frames are valid even if an error is returned. Decoding can be resumed with
+ * the packets following the ones which were consumed.
+ *
+ * @retval 0                success; all packets were consumed unless the
+ *                          frames array is full
+ * @retval AVERROR_EOF      the decoder has been fully flushed, and there will
+ *                          be no more output frames
+ * @retval AVERROR(EINVAL)  codec not opened, not an audio or video decoder,
+ *                          or invalid arguments
+ * @retval "other negative error code" legitimate decoding errors
+ */
+int avcodec_decode_batch(AVCodecContext *avctx, AVPacket *const *pkts,
+                         const unsigned *hints, int *nb_pkts,
+                         AVFrame **frames, int *nb_frames);
+
 /**
  * Supply a raw video or audio frame to the encoder. Use avcodec_receive_packet()
  * to retrieve buffered output packets.
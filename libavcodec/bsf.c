@@ -18,14 +18,17 @@
 
 #include <string.h>
 
+#include "config.h"
 #include "config_components.h"
 
 #include "libavutil/avassert.h"
+#include "libavutil/fifo.h"
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
+#include "libavutil/thread.h"
 
 #include "bsf.h"
 #include "bsf_internal.h"
@@ -266,6 +269,25 @@ int ff_bsf_get_packet_ref(AVBSFContext *ctx, AVPacket *pkt)
     return 0;
 }
 
+/* maximum number of messages waiting in front of each stage of a pipeline */
+#define PIPELINE_QUEUE_SIZE 8
+
+typedef struct BSFListMsg {
+    AVPacket *pkt;
+    /* 0 for a packet, PIPELINE_FLUSH, AVERROR_EOF or a filtering error */
+    int ret;
+} BSFListMsg;
+
+#define PIPELINE_FLUSH 1
+
+#if HAVE_THREADS
+typedef struct BSFListStage {
+    struct BSFListContext *lst;
+    int idx;
+    pthread_t thread;
+} BSFListStage;
+#endif
+
 typedef struct BSFListContext {
     const AVClass *class;
 
@@ -275,8 +297,316 @@ typedef struct BSFListContext {
     unsigned idx;           // index of currently processed BSF
 
     char * item_name;
+
+    int pipeline;
+
+#if HAVE_THREADS
+    /* Pipelined filtering: each filter runs in its own thread, reading from
+     * queues[i] and writing to queues[i + 1]. The caller thread writes to the
+     * first queue and reads the filtered packets from the last one. All the
+     * queues are protected by lock. */
+    BSFListStage *stages;
+    int nb_stages;
+    AVFifo **queues;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int exit;
+    int err;                // allocation failure in a stage
+    BSFListMsg pending;     // input waiting for room in the first queue
+    int has_pending;
+    int eof_in;             // EOF was received from the caller
+    int eof_out;            // EOF was returned to the caller
+#endif
 } BSFListContext;
 
+#if HAVE_THREADS
+static void pipeline_output(BSFListContext *lst, AVFifo *out, AVPacket *pkt, int ret)
+{
+    BSFListMsg msg = { .pkt = pkt, .ret = ret };
+
+    pthread_mutex_lock(&lst->lock);
+    if (av_fifo_write(out, &msg, 1) < 0) {
+        av_packet_free(&pkt);
+        lst->err = AVERROR(ENOMEM);
+    }
+    pthread_cond_broadcast(&lst->cond);
+    pthread_mutex_unlock(&lst->lock);
+}
+
+static void pipeline_process(BSFListContext *lst, AVBSFContext *bsf,
+                             AVFifo *out, BSFListMsg *msg)
+{
+    int ret;
+
+    if (msg->ret == PIPELINE_FLUSH) {
+        av_bsf_flush(bsf);
+        pipeline_output(lst, out, NULL, msg->ret);
+        return;
+    }
+    /* errors of the previous filters are passed on in order */
+    if (msg->ret < 0 && msg->ret != AVERROR_EOF) {
+        pipeline_output(lst, out, NULL, msg->ret);
+        return;
+    }
+
+    ret = av_bsf_send_packet(bsf, msg->pkt);
+    av_packet_free(&msg->pkt);
+    if (ret < 0) {
+        pipeline_output(lst, out, NULL, ret);
+        return;
+    }
+
+    while (1) {
+        AVPacket *pkt = av_packet_alloc();
+
+        if (!pkt) {
+            pipeline_output(lst, out, NULL, AVERROR(ENOMEM));
+            return;
+        }
+
+        ret = av_bsf_receive_packet(bsf, pkt);
+        if (ret < 0)
+            av_packet_free(&pkt);
+        if (ret == AVERROR(EAGAIN))
+            return;
+
+        pipeline_output(lst, out, pkt, ret);
+        if (ret < 0)
+            return;
+    }
+}
+
+static void *pipeline_stage_thread(void *arg)
+{
+    BSFListStage *stage = arg;
+    BSFListContext  *lst = stage->lst;
+    AVBSFContext    *bsf = lst->bsfs[stage->idx];
+    AVFifo           *in = lst->queues[stage->idx];
+    AVFifo          *out = lst->queues[stage->idx + 1];
+
+    ff_thread_setname("bsf-pipeline");
+
+    pthread_mutex_lock(&lst->lock);
+    while (1) {
+        BSFListMsg msg;
+
+        while (!lst->exit && (!av_fifo_can_read(in) ||
+                              av_fifo_can_read(out) >= PIPELINE_QUEUE_SIZE))
+            pthread_cond_wait(&lst->cond, &lst->lock);
+        if (lst->exit)
+            break;
+
+        av_fifo_read(in, &msg, 1);
+        pthread_cond_broadcast(&lst->cond);
+        pthread_mutex_unlock(&lst->lock);
+
+        pipeline_process(lst, bsf, out, &msg);
+
+        pthread_mutex_lock(&lst->lock);
+    }
+    pthread_mutex_unlock(&lst->lock);
+
+    return NULL;
+}
+
+static void pipeline_discard_queue(AVFifo *fifo)
+{
+    BSFListMsg msg;
+
+    while (av_fifo_read(fifo, &msg, 1) >= 0)
+        av_packet_free(&msg.pkt);
+}
+
+static void pipeline_uninit(BSFListContext *lst)
+{
+    if (!lst->queues)
+        return;
+
+    if (lst->nb_stages) {
+        pthread_mutex_lock(&lst->lock);
+        lst->exit = 1;
+        pthread_cond_broadcast(&lst->cond);
+        pthread_mutex_unlock(&lst->lock);
+
+        for (int i = 0; i < lst->nb_stages; i++)
+            pthread_join(lst->stages[i].thread, NULL);
+    }
+    av_freep(&lst->stages);
+    lst->nb_stages = 0;
+
+    for (int i = 0; i <= lst->nb_bsfs; i++) {
+        if (lst->queues[i])
+            pipeline_discard_queue(lst->queues[i]);
+        av_fifo_freep2(&lst->queues[i]);
+    }
+    av_freep(&lst->queues);
+    av_packet_free(&lst->pending.pkt);
+
+    pthread_cond_destroy(&lst->cond);
+    pthread_mutex_destroy(&lst->lock);
+}
+
+static int pipeline_init(AVBSFContext *bsf)
+{
+    BSFListContext *lst = bsf->priv_data;
+    int ret;
+
+    lst->queues = av_calloc(lst->nb_bsfs + 1, sizeof(*lst->queues));
+    lst->stages = av_calloc(lst->nb_bsfs,     sizeof(*lst->stages));
+    if (!lst->queues || !lst->stages) {
+        av_freep(&lst->queues);
+        av_freep(&lst->stages);
+        return AVERROR(ENOMEM);
+    }
+
+    ret = pthread_mutex_init(&lst->lock, NULL);
+    if (ret) {
+        av_freep(&lst->queues);
+        av_freep(&lst->stages);
+        return AVERROR(ret);
+    }
+    ret = pthread_cond_init(&lst->cond, NULL);
+    if (ret) {
+        pthread_mutex_destroy(&lst->lock);
+        av_freep(&lst->queues);
+        av_freep(&lst->stages);
+        return AVERROR(ret);
+    }
+
+    for (int i = 0; i <= lst->nb_bsfs; i++) {
+        lst->queues[i] = av_fifo_alloc2(PIPELINE_QUEUE_SIZE, sizeof(BSFListMsg),
+                                        AV_FIFO_FLAG_AUTO_GROW);
+        if (!lst->queues[i]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
+    for (int i = 0; i < lst->nb_bsfs; i++) {
+        BSFListStage *stage = &lst->stages[i];
+
+        stage->lst = lst;
+        stage->idx = i;
+        ret = pthread_create(&stage->thread, NULL, pipeline_stage_thread, stage);
+        if (ret) {
+            ret = AVERROR(ret);
+            goto fail;
+        }
+        lst->nb_stages++;
+    }
+
+    return 0;
+fail:
+    pipeline_uninit(lst);
+    return ret;
+}
+
+static int pipeline_filter(AVBSFContext *bsf, AVPacket *out)
+{
+    BSFListContext *lst = bsf->priv_data;
+    AVFifo *in_q  = lst->queues[0];
+    AVFifo *out_q = lst->queues[lst->nb_bsfs];
+    BSFListMsg msg;
+    int ret;
+
+    if (lst->eof_out)
+        return AVERROR_EOF;
+
+    if (!lst->has_pending && !lst->eof_in) {
+        ret = ff_bsf_get_packet(bsf, &lst->pending.pkt);
+        if (ret == AVERROR_EOF) {
+            lst->pending.ret = AVERROR_EOF;
+            lst->eof_in = 1;
+        } else if (ret < 0 && ret != AVERROR(EAGAIN))
+            return ret;
+        lst->has_pending = ret != AVERROR(EAGAIN);
+    }
+
+    pthread_mutex_lock(&lst->lock);
+    while (1) {
+        if (lst->has_pending && av_fifo_can_read(in_q) < PIPELINE_QUEUE_SIZE) {
+            av_fifo_write(in_q, &lst->pending, 1);
+            memset(&lst->pending, 0, sizeof(lst->pending));
+            lst->has_pending = 0;
+            pthread_cond_broadcast(&lst->cond);
+        }
+
+        if (av_fifo_read(out_q, &msg, 1) >= 0) {
+            pthread_cond_broadcast(&lst->cond);
+            break;
+        }
+
+        if (lst->err) {
+            ret = lst->err;
+            lst->err = 0;
+            pthread_mutex_unlock(&lst->lock);
+            return ret;
+        }
+
+        /* the input was queued, the output of the packets in flight is
+         * returned on the following calls */
+        if (!lst->has_pending && !lst->eof_in) {
+            pthread_mutex_unlock(&lst->lock);
+            return AVERROR(EAGAIN);
+        }
+
+        pthread_cond_wait(&lst->cond, &lst->lock);
+    }
+    pthread_mutex_unlock(&lst->lock);
+
+    if (msg.ret == AVERROR_EOF)
+        lst->eof_out = 1;
+    if (msg.ret < 0)
+        return msg.ret;
+
+    av_packet_move_ref(out, msg.pkt);
+    av_packet_free(&msg.pkt);
+
+    return 0;
+}
+
+static void pipeline_flush(BSFListContext *lst)
+{
+    AVFifo *in_q  = lst->queues[0];
+    AVFifo *out_q = lst->queues[lst->nb_bsfs];
+    BSFListMsg msg = { .ret = PIPELINE_FLUSH };
+    int flush_sent = 0;
+
+    av_packet_free(&lst->pending.pkt);
+    lst->has_pending = 0;
+
+    /* Pass a flush marker through all the filters, dropping everything that
+     * comes out of the pipeline in front of it. As with filters which delay
+     * their output, the packets in flight are lost unless the caller drains
+     * the list before flushing it. */
+    pthread_mutex_lock(&lst->lock);
+    while (1) {
+        BSFListMsg out;
+
+        if (!flush_sent && av_fifo_can_read(in_q) < PIPELINE_QUEUE_SIZE) {
+            av_fifo_write(in_q, &msg, 1);
+            flush_sent = 1;
+            pthread_cond_broadcast(&lst->cond);
+        }
+
+        if (av_fifo_read(out_q, &out, 1) >= 0) {
+            pthread_cond_broadcast(&lst->cond);
+            av_packet_free(&out.pkt);
+            if (out.ret == PIPELINE_FLUSH)
+                break;
+            continue;
+        }
+
+        pthread_cond_wait(&lst->cond, &lst->lock);
+    }
+    lst->err = 0;
+    pthread_mutex_unlock(&lst->lock);
+
+    lst->eof_in  = 0;
+    lst->eof_out = 0;
+}
+#endif
+
 
 static int bsf_list_init(AVBSFContext *bsf)
 {
@@ -302,6 +632,13 @@ static int bsf_list_init(AVBSFContext *bsf)
 
     bsf->time_base_out = tb;
     ret = avcodec_parameters_copy(bsf->par_out, cod_par);
+    if (ret < 0)
+        goto fail;
+
+#if HAVE_THREADS
+    if (lst->pipeline && lst->nb_bsfs)
+        ret = pipeline_init(bsf);
+#endif
 
 fail:
     return ret;
@@ -315,6 +652,11 @@ static int bsf_list_filter(AVBSFContext *bsf, AVPacket *out)
     if (!lst->nb_bsfs)
         return ff_bsf_get_packet_ref(bsf, out);
 
+#if HAVE_THREADS
+    if (lst->nb_stages)
+        return pipeline_filter(bsf, out);
+#endif
+
     while (1) {
         /* get a packet from the previous filter up the chain */
         if (lst->idx)
@@ -353,6 +695,13 @@ static void bsf_list_flush(AVBSFContext *bsf)
 {
     BSFListContext *lst = bsf->priv_data;
 
+#if HAVE_THREADS
+    if (lst->nb_stages) {
+        pipeline_flush(lst);
+        return;
+    }
+#endif
+
     for (int i = 0; i < lst->nb_bsfs; i++)
         av_bsf_flush(lst->bsfs[i]);
     lst->idx = 0;
@@ -363,6 +712,10 @@ static void bsf_list_close(AVBSFContext *bsf)
     BSFListContext *lst = bsf->priv_data;
     int i;
 
+#if HAVE_THREADS
+    pipeline_uninit(lst);
+#endif
+
     for (i = 0; i < lst->nb_bsfs; ++i)
         av_bsf_free(&lst->bsfs[i]);
     av_freep(&lst->bsfs);
@@ -394,9 +747,17 @@ static const char *bsf_list_item_name(void *ctx)
     return lst->item_name;
 }
 
+#define OFFSET(x) offsetof(BSFListContext, x)
+#define FLAGS (AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_SUBTITLE_PARAM|AV_OPT_FLAG_BSF_PARAM)
+static const AVOption bsf_list_options[] = {
+    { "pipeline", "run each filter of the list in its own thread", OFFSET(pipeline), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
+    { NULL },
+};
+
 static const AVClass bsf_list_class = {
         .class_name = "bsf_list",
         .item_name  = bsf_list_item_name,
+        .option     = bsf_list_options,
         .version    = LIBAVUTIL_VERSION_INT,
 };
 
@@ -31,6 +31,7 @@
 #include <stdint.h>
 
 #include "libavutil/attributes.h"
+#include "libavutil/common.h"
 #include "libavutil/intmath.h"
 #include "cabac.h"
 #include "config.h"
@@ -180,6 +181,82 @@ static av_always_inline int get_cabac_bypass_sign(CABACContext *c, int val){
 }
 #endif
 
+#ifndef get_cabac_bypass_bits
+/**
+ * Decode n <= 16 bypass bins at once, MSB first.
+ * A run of bypass bins is the quotient of the offset by range << 17.
+ */
+av_unused static int get_cabac_bypass_bits(CABACContext *c, int n)
+{
+    int avail = CABAC_BITS - ff_ctz(c->low);
+    uint64_t x, r = (uint64_t)c->range << (CABAC_BITS + 1);
+    const uint8_t *bytestream = c->bytestream;
+
+    if (n < avail) {
+        x = (uint64_t)c->low << n;
+    } else {
+        int fill = (bytestream[0] << 9) + (bytestream[1] << 1) - CABAC_MASK;
+
+        x = (uint64_t)((((int64_t)c->low << avail) + fill)) << (n - avail);
+#if !UNCHECKED_BITSTREAM_READER
+        if (bytestream < c->bytestream_end)
+#endif
+            bytestream += CABAC_BITS / 8;
+    }
+
+    if (x < r << n) {
+        c->low = x % r;
+        c->bytestream = bytestream;
+        return x / r;
+    } else {
+        int ret = 0;
+
+        for (int i = 0; i < n; i++)
+            ret = (ret << 1) | get_cabac_bypass(c);
+        return ret;
+    }
+}
+#endif
+
+#ifndef get_cabac_bypass_unary
+/**
+ * Decode a unary code of bypass bins: count the 1 bins up to max, and consume
+ * the terminating 0 bin if fewer than max were found.
+ */
+av_unused static int get_cabac_bypass_unary(CABACContext *c, int max)
+{
+    int prefix = 0;
+
+    while (prefix < max) {
+        int avail = CABAC_BITS - ff_ctz(c->low);
+        int n = FFMIN(avail - 1, max - prefix);
+        uint64_t r = (uint64_t)c->range << (CABAC_BITS + 1);
+        uint64_t x = (uint64_t)c->low << n;
+        int q, t;
+
+        if (n < 1 || x >= r << n) {
+            if (!get_cabac_bypass(c))
+                return prefix;
+            prefix++;
+            continue;
+        }
+
+        q = x / r;
+        t = ~q & ((1 << n) - 1);
+        if (t) {
+            int p = n - 1 - av_log2(t);
+            int k = n - (p + 1);
+
+            c->low = (x >> k) - ((uint64_t)(q >> k) * r);
+            return prefix + p;
+        }
+        c->low = x - (uint64_t)q * r;
+        prefix += n;
+    }
+    return prefix;
+}
+#endif
+
 /**
  * @return the number of bytes read or 0 if no end
  */
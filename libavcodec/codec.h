@@ -161,6 +161,17 @@
  */
 #define AV_CODEC_CAP_ENCODER_RECON_FRAME (1 << 22)
 
+/**
+ * The encoder can output packets referencing the input frame data instead of
+ * copying it, if all planes of the frame are stored back to back in
+ * frame->buf[0] with the layout produced by av_image_fill_arrays() with an
+ * alignment of 1, and at least AV_INPUT_BUFFER_PADDING_SIZE zeroed bytes
+ * follow the last plane. Frames with any other layout are copied as usual.
+ *
+ * Callers that control frame allocation may use this to avoid a copy.
+ */
+#define AV_CODEC_CAP_ENCODER_PACKED_FRAMES (1 << 23)
+
 /**
  * AVProfile.
  */
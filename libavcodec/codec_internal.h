@@ -88,6 +88,12 @@
  * encoders do.
  */
 #define FF_CODEC_CAP_EOF_FLUSH              (1 << 10)
+/**
+ * The encoder supports frame and slice threading at the same time. If both
+ * are requested, the frame thread encoder gives each of its worker contexts
+ * slice threads of their own, so that fewer frames need to be in flight.
+ */
+#define FF_CODEC_CAP_FRAME_AND_SLICE_THREADS (1 << 11)
 
 /**
  * FFCodec.codec_tags termination value
@@ -179,6 +185,18 @@ typedef struct FFCodec {
      * Copy variables back to the user-facing context
      */
     int (*update_thread_context_for_user)(struct AVCodecContext *dst, const struct AVCodecContext *src);
+
+    /**
+     * Frame-threaded encoders only: called on the user-facing context for
+     * every packet returned by a worker thread, in output order, together
+     * with the frame it was encoded from. This allows keeping state that
+     * depends on the whole stream, which the worker threads only see parts of.
+     * With AV_CODEC_CAP_DELAY, the encode callback is then called once with a
+     * NULL frame on the user-facing context after all frames are done.
+     */
+    int (*update_encoder_context)(struct AVCodecContext *avctx,
+                                  const struct AVFrame *frame,
+                                  const struct AVPacket *pkt);
     /** @} */
 
     /**
@@ -364,11 +382,15 @@ int ff_default_get_supported_config(const struct AVCodecContext *avctx,
         .update_thread_context          = (func)
 #define UPDATE_THREAD_CONTEXT_FOR_USER(func) \
         .update_thread_context_for_user = (func)
+#define UPDATE_ENCODER_CONTEXT(func) \
+        .update_encoder_context         = (func)
 #else
 #define UPDATE_THREAD_CONTEXT(func) \
         .update_thread_context          = NULL
 #define UPDATE_THREAD_CONTEXT_FOR_USER(func) \
         .update_thread_context_for_user = NULL
+#define UPDATE_ENCODER_CONTEXT(func) \
+        .update_encoder_context         = NULL
 #endif
 
 #define FF_CODEC_DECODE_CB(func)                          \
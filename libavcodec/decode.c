@@ -96,6 +96,14 @@ typedef struct DecodeContext {
      */
     uint64_t side_data_pref_mask;
 
+    /**
+     * Set during avcodec_decode_batch(). skip_frame is then set for each
+     * packet leaving the bitstream filters, from its AV_PKT_FLAG_DISCARD flag
+     * and batch_skip_frame, the value set by the caller.
+     */
+    int batch;
+    enum AVDiscard batch_skip_frame;
+
 #if CONFIG_LIBLCEVC_DEC
     struct {
         FFLCEVCContext *ctx;
@@ -229,6 +237,7 @@ fail:
 static int decode_get_packet(AVCodecContext *avctx, AVPacket *pkt)
 {
     AVCodecInternal *avci = avctx->internal;
+    DecodeContext     *dc = decode_ctx(avci);
     int ret;
 
     ret = av_bsf_receive_packet(avci->bsf, pkt);
@@ -245,6 +254,13 @@ static int decode_get_packet(AVCodecContext *avctx, AVPacket *pkt)
     if (ret < 0)
         goto finish;
 
+    /* The decoder reads skip_frame when it decodes the packet, which is now
+     * or, with frame threading, when it is submitted to a worker. */
+    if (dc->batch)
+        avctx->skip_frame = (pkt->flags & AV_PKT_FLAG_DISCARD) ?
+                            FFMAX(dc->batch_skip_frame, AVDISCARD_NONREF) :
+                            dc->batch_skip_frame;
+
     return 0;
 finish:
     av_packet_unref(pkt);
@@ -845,6 +861,83 @@ fail:
     return ret;
 }
 
+/* returns 0 when the frames array is full */
+static int batch_receive_frames(AVCodecContext *avctx, AVFrame **frames,
+                                int max_frames, int *nb_frames)
+{
+    while (*nb_frames < max_frames) {
+        int ret = ff_decode_receive_frame(avctx, frames[*nb_frames], 0);
+        if (ret < 0)
+            return ret;
+        (*nb_frames)++;
+    }
+    return 0;
+}
+
+int attribute_align_arg avcodec_decode_batch(AVCodecContext *avctx, AVPacket *const *pkts,
+                                             const unsigned *hints, int *nb_pkts,
+                                             AVFrame **frames, int *nb_frames)
+{
+    DecodeContext *dc;
+    const int max_pkts   = *nb_pkts;
+    const int max_frames = *nb_frames;
+    int i, ret;
+
+    *nb_pkts   = 0;
+    *nb_frames = 0;
+
+    if (!avcodec_is_open(avctx) || !av_codec_is_decoder(avctx->codec) ||
+        (avctx->codec_type != AVMEDIA_TYPE_VIDEO &&
+         avctx->codec_type != AVMEDIA_TYPE_AUDIO) ||
+        max_pkts < 0 || max_frames <= 0)
+        return AVERROR(EINVAL);
+
+    for (int j = 0; j < max_frames; j++)
+        av_frame_unref(frames[j]);
+
+    dc = decode_ctx(avctx->internal);
+    dc->batch            = 1;
+    dc->batch_skip_frame = avctx->skip_frame;
+
+    // output left over from the previous call
+    ret = batch_receive_frames(avctx, frames, max_frames, nb_frames);
+    if (ret != AVERROR(EAGAIN))
+        goto end;
+
+    ret = 0;
+    for (i = 0; i < max_pkts; i++) {
+        AVPacket *const pkt = pkts[i];
+        const int discard = hints && (hints[i] & AV_CODEC_BATCH_HINT_DISCARD);
+        int pkt_flags = 0;
+
+        /* the flag follows the packet through the bitstream filters and
+         * selects skip_frame when it is decoded, see decode_get_packet() */
+        if (discard && pkt) {
+            pkt_flags   = pkt->flags;
+            pkt->flags |= AV_PKT_FLAG_DISCARD;
+        }
+
+        ret = avcodec_send_packet(avctx, pkt);
+
+        if (discard && pkt)
+            pkt->flags = pkt_flags;
+        if (ret < 0)
+            break;
+        (*nb_pkts)++;
+
+        ret = batch_receive_frames(avctx, frames, max_frames, nb_frames);
+        if (ret != AVERROR(EAGAIN))
+            break;
+        ret = 0;
+    }
+
+end:
+    avctx->skip_frame = dc->batch_skip_frame;
+    dc->batch         = 0;
+
+    return ret;
+}
+
 static void get_subtitle_defaults(AVSubtitle *sub)
 {
     memset(sub, 0, sizeof(*sub));
@@ -104,6 +104,11 @@ typedef struct FFV1SliceContext {
         struct {
             uint64_t rc_stat[256][2];
             uint64_t (*rc_stat2[MAX_QUANT_TABLES])[32][2];
+            uint8_t *buf;                ///< coded slice, grown on demand
+            unsigned buf_size;           ///< usable size of buf, without the room for the slice trailer
+            unsigned buf_max_size;       ///< size buf is allowed to grow to
+            unsigned out_size;           ///< size of the coded slice, including the trailer
+            uint8_t *out;                ///< destination of the coded slice in the packet
         };
     };
     int remap_count[4];
@@ -261,6 +261,46 @@ static inline void put_vlc_symbol(PutBitContext *pb, VlcState *const state,
     update_vlc_state(state, v);
 }
 
+/* Room for the slice size and the error correction trailer */
+#define SLICE_TRAILER_SIZE 8
+
+/**
+ * Make sure at least size bytes are left in the slice buffer, growing it up
+ * to buf_max_size. The range coder, and with Golomb Rice coding the bit
+ * writer, are moved along with the data.
+ */
+static int grow_slice_buffer(FFV1SliceContext *sc, int ac, int64_t size)
+{
+    RangeCoder *const c = &sc->c;
+    int64_t left = ac == AC_GOLOMB_RICE ? put_bytes_left(&sc->pb, 0)
+                                        : c->bytestream_end - c->bytestream;
+    int64_t new_size;
+    uint8_t *buf;
+
+    if (left >= size)
+        return 0;
+
+    new_size = sc->buf_size + size - left;
+    new_size = FFMIN(FFMAX(new_size, 2LL * sc->buf_size), sc->buf_max_size);
+    if (left + new_size - sc->buf_size < size)
+        return AVERROR(ENOSPC);
+
+    buf = av_realloc(sc->buf, new_size + SLICE_TRAILER_SIZE);
+    if (!buf)
+        return AVERROR(ENOMEM);
+
+    c->bytestream       = buf + (c->bytestream - sc->buf);
+    c->bytestream_start = buf;
+    c->bytestream_end   = buf + new_size;
+    if (ac == AC_GOLOMB_RICE)
+        rebase_put_bits(&sc->pb, buf + sc->ac_byte_count,
+                        new_size - sc->ac_byte_count);
+
+    sc->buf      = buf;
+    sc->buf_size = new_size;
+    return 0;
+}
+
 #define TYPE int16_t
 #define RENAME(name) name
 #include "ffv1enc_template.c"
@@ -1743,7 +1783,7 @@ static int encode_slice(AVCodecContext *c, void *arg)
     int y            = sc->slice_y;
     const AVFrame *const p = f->cur_enc_frame;
     const int ps     = av_pix_fmt_desc_get(c->pix_fmt)->comp[0].step;
-    int ret;
+    int ret, bytes;
     RangeCoder c_bak = sc->c;
     const int chroma_width  = AV_CEIL_RSHIFT(width,  f->chroma_h_shift);
     const int chroma_height = AV_CEIL_RSHIFT(height, f->chroma_v_shift);
@@ -1854,9 +1894,67 @@ retry:
         ac = 1;
         sc->slice_coding_mode = 1;
         sc->c = c_bak;
+        /* The buffer may have been moved while growing */
+        sc->c.bytestream       = sc->buf + (c_bak.bytestream - c_bak.bytestream_start);
+        sc->c.bytestream_start = sc->buf;
+        sc->c.bytestream_end   = sc->buf + sc->buf_size;
         goto retry;
     }
 
+    /* Append the slice trailer here, so that the CRCs of all slices are
+     * computed in parallel. */
+    bytes = sc->ac_byte_count;
+    if (sc != f->slices || f->version > 2) {
+        av_assert0(bytes < sc->buf_max_size);
+        av_assert0(bytes < (1 << 24));
+        AV_WB24(sc->buf + bytes, bytes);
+        bytes += 3;
+    }
+    if (f->ec) {
+        unsigned v;
+        sc->buf[bytes++] = 0;
+        v = av_crc(av_crc_get_table(AV_CRC_32_IEEE), f->crcref, sc->buf, bytes) ^ (f->crcref ? 0x8CD88196 : 0);
+        AV_WL32(sc->buf + bytes, v);
+        bytes += 4;
+    }
+    sc->out_size = bytes;
+
+    return 0;
+}
+
+static int copy_slice(AVCodecContext *avctx, void *arg)
+{
+    const FFV1SliceContext *sc = arg;
+
+    memcpy(sc->out, sc->buf, sc->out_size);
+
+    return 0;
+}
+
+static int alloc_slice_buffer(const FFV1Context *f, FFV1SliceContext *sc,
+                              unsigned max_size)
+{
+    /* The frame and slice headers and the remap tables are written without
+     * checking for space, everything else grows the buffer as needed. */
+    size_t size = 800 + FF_INPUT_BUFFER_MIN_SIZE;
+    uint8_t *buf;
+
+    if (f->version > 3 && f->remap_mode)
+        size += 70000 * (1 + 2*f->chroma_planes + f->bayer + f->transparency);
+    size = FFMIN(FFMAX(size, max_size / 16), max_size);
+
+    sc->buf_max_size = max_size;
+    if (sc->buf && sc->buf_size >= size) {
+        sc->buf_size = FFMIN(sc->buf_size, max_size);
+        return 0;
+    }
+
+    buf = av_realloc(sc->buf, size + SLICE_TRAILER_SIZE);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    sc->buf      = buf;
+    sc->buf_size = size;
+
     return 0;
 }
 
@@ -1890,9 +1988,8 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     FFV1Context *f      = avctx->priv_data;
     RangeCoder *const c = &f->slices[0].c;
     uint8_t keystate    = 128;
-    uint8_t *buf_p;
     int i, ret;
-    int64_t maxsize;
+    int64_t maxsize, size;
 
     if(!pict) {
         if (avctx->flags & AV_CODEC_FLAG_PASS1) {
@@ -1952,10 +2049,15 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         maxsize = INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE - 32;
     }
 
-    if ((ret = ff_alloc_packet(avctx, pkt, maxsize)) < 0)
-        return ret;
+    /* Each slice is coded into its own buffer, which may grow up to an
+     * equal share of the worst case packet size. */
+    for (i = 0; i < f->slice_count; i++) {
+        ret = alloc_slice_buffer(f, &f->slices[i], maxsize / f->slice_count);
+        if (ret < 0)
+            return ret;
+    }
 
-    ff_init_range_encoder(c, pkt->data, pkt->size);
+    ff_init_range_encoder(c, f->slices[0].buf, f->slices[0].buf_size);
     ff_build_rac_states(c, 0.05 * (1LL << 32), 256 - 8);
 
     f->cur_enc_frame = pict;
@@ -1978,47 +2080,34 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         }
     }
 
-    for (i = 0; i < f->slice_count; i++) {
+    av_assert0(c->bytestream < c->bytestream_end);
+    for (i = 1; i < f->slice_count; i++) {
         FFV1SliceContext *sc = &f->slices[i];
-        uint8_t *start  = pkt->data + pkt->size * (int64_t)i / f->slice_count;
-        int len         = pkt->size / f->slice_count;
-        if (i) {
-            ff_init_range_encoder(&sc->c, start, len);
-        } else {
-            av_assert0(sc->c.bytestream_end >= sc->c.bytestream_start + len);
-            av_assert0(sc->c.bytestream < sc->c.bytestream_start + len);
-            sc->c.bytestream_end = sc->c.bytestream_start + len;
-        }
+        ff_init_range_encoder(&sc->c, sc->buf, sc->buf_size);
     }
     avctx->execute(avctx, encode_slice, f->slices, NULL,
                    f->slice_count, sizeof(*f->slices));
 
-    buf_p = pkt->data;
+    size = 0;
+    for (i = 0; i < f->slice_count; i++)
+        size += f->slices[i].out_size;
+
+    if ((ret = ff_get_encode_buffer(avctx, pkt, size, 0)) < 0)
+        return ret;
+
+    size = 0;
     for (i = 0; i < f->slice_count; i++) {
         FFV1SliceContext *sc = &f->slices[i];
-        int bytes = sc->ac_byte_count;
-        if (i > 0 || f->version > 2) {
-            av_assert0(bytes < pkt->size / f->slice_count);
-            memmove(buf_p, sc->c.bytestream_start, bytes);
-            av_assert0(bytes < (1 << 24));
-            AV_WB24(buf_p + bytes, bytes);
-            bytes += 3;
-        }
-        if (f->ec) {
-            unsigned v;
-            buf_p[bytes++] = 0;
-            v = av_crc(av_crc_get_table(AV_CRC_32_IEEE), f->crcref, buf_p, bytes) ^ (f->crcref ? 0x8CD88196 : 0);
-            AV_WL32(buf_p + bytes, v);
-            bytes += 4;
-        }
-        buf_p += bytes;
+        sc->out = pkt->data + size;
+        size   += sc->out_size;
     }
+    avctx->execute(avctx, copy_slice, f->slices, NULL,
+                   f->slice_count, sizeof(*f->slices));
 
     if (avctx->flags & AV_CODEC_FLAG_PASS1)
         avctx->stats_out[0] = '\0';
 
     f->picture_number++;
-    pkt->size   = buf_p - pkt->data;
     pkt->flags |= AV_PKT_FLAG_KEY * f->key_frame;
     *got_packet = 1;
 
@@ -2036,6 +2125,7 @@ static av_cold int encode_close(AVCodecContext *avctx)
             av_freep(&sc->unit[p]);
             av_freep(&sc->bitmap[p]);
         }
+        av_freep(&sc->buf);
     }
 
     av_freep(&avctx->stats_out);
@@ -2095,7 +2185,7 @@ const FFCodec ff_ffv1_encoder = {
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_FFV1,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_SLICE_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS |
                       AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
     .priv_data_size = sizeof(FFV1Context),
     .init           = encode_init_internal,
@@ -2128,5 +2218,6 @@ const FFCodec ff_ffv1_encoder = {
         AV_PIX_FMT_BAYER_RGGB16),
     .color_ranges   = AVCOL_RANGE_MPEG,
     .p.priv_class   = &ffv1_class,
-    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP | FF_CODEC_CAP_EOF_FLUSH,
+    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP | FF_CODEC_CAP_EOF_FLUSH |
+                      FF_CODEC_CAP_FRAME_AND_SLICE_THREADS,
 };
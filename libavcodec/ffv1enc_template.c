@@ -40,7 +40,7 @@ RENAME(encode_line)(FFV1Context *f, FFV1SliceContext *sc,
 
     if (sc->slice_coding_mode == 1) {
         av_assert0(ac != AC_GOLOMB_RICE);
-        if (c->bytestream_end - c->bytestream < (w * bits + 7LL)>>3) {
+        if (grow_slice_buffer(sc, ac, (w * bits + 7LL) >> 3) < 0) {
             av_log(logctx, AV_LOG_ERROR, "encoded Range Coder frame too large\n");
             return AVERROR_INVALIDDATA;
         }
@@ -57,12 +57,12 @@ RENAME(encode_line)(FFV1Context *f, FFV1SliceContext *sc,
     }
 
     if (ac != AC_GOLOMB_RICE) {
-        if (c->bytestream_end - c->bytestream < w * 35) {
+        if (grow_slice_buffer(sc, ac, w * 35) < 0) {
             av_log(logctx, AV_LOG_ERROR, "encoded Range Coder frame too large\n");
             return AVERROR_INVALIDDATA;
         }
     } else {
-        if (put_bytes_left(&sc->pb, 0) < w * 4) {
+        if (grow_slice_buffer(sc, ac, w * 4) < 0) {
             av_log(logctx, AV_LOG_ERROR, "encoded Golomb Rice frame too large\n");
             return AVERROR_INVALIDDATA;
         }
@@ -31,6 +31,7 @@
 #include "bswapdsp.h"
 #include "codec_internal.h"
 #include "encode.h"
+#include "internal.h"
 #include "put_bits.h"
 #include "lpc.h"
 #include "flac.h"
@@ -1571,10 +1572,11 @@ static int write_frame(FlacEncodeContext *s, AVPacket *avpkt)
 }
 
 
-static int update_md5_sum(FlacEncodeContext *s, const void *samples)
+static int update_md5_sum(FlacEncodeContext *s, const void *samples,
+                          int nb_samples)
 {
     const uint8_t *buf;
-    int buf_size = s->frame.blocksize * s->channels *
+    int buf_size = nb_samples * s->channels *
                    ((s->avctx->bits_per_raw_sample + 7) / 8);
 
     if (s->avctx->bits_per_raw_sample > 16 || HAVE_BIGENDIAN) {
@@ -1595,7 +1597,7 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
         const int32_t *samples0 = samples;
         uint8_t *tmp            = s->md5_buffer;
 
-        for (i = 0; i < s->frame.blocksize * s->channels; i++) {
+        for (i = 0; i < nb_samples * s->channels; i++) {
             int32_t v = samples0[i] >> 8;
             AV_WL24(tmp + 3*i, v);
         }
@@ -1606,7 +1608,7 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
         const int32_t *samples0 = samples;
         uint8_t *tmp            = s->md5_buffer;
 
-        for (i = 0; i < s->frame.blocksize * s->channels; i++)
+        for (i = 0; i < nb_samples * s->channels; i++)
             AV_WL32(tmp + 4*i, samples0[i]);
         buf = s->md5_buffer;
     }
@@ -1616,6 +1618,31 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
 }
 
 
+/**
+ * Account for an encoded frame in the STREAMINFO header.
+ */
+static int update_stream_info(FlacEncodeContext *s, const AVFrame *frame,
+                              int frame_bytes)
+{
+    int ret;
+
+    s->frame_count++;
+    s->sample_count += frame->nb_samples;
+    if ((ret = update_md5_sum(s, frame->data[0], frame->nb_samples)) < 0) {
+        av_log(s->avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
+        return ret;
+    }
+    if (frame_bytes > s->max_encoded_framesize)
+        s->max_encoded_framesize = frame_bytes;
+    if (frame_bytes < s->min_framesize)
+        s->min_framesize = frame_bytes;
+
+    s->next_pts = frame->pts + ff_samples_to_time_base(s->avctx, frame->nb_samples);
+
+    return 0;
+}
+
+
 static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                              const AVFrame *frame, int *got_packet_ptr)
 {
@@ -1653,6 +1680,12 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                                                    avctx->bits_per_raw_sample);
     }
 
+    /* With frame threading, the frames are spread over several contexts and
+     * the STREAMINFO is kept by the user-facing one, see
+     * flac_update_encoder_context(). */
+    if (avctx->internal->frame_thread_encoder)
+        s->frame_count = avctx->frame_num;
+
     init_frame(s, frame->nb_samples);
 
     copy_samples(s, frame->data[0]);
@@ -1679,18 +1712,11 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
     out_bytes = write_frame(s, avpkt);
 
-    s->frame_count++;
-    s->sample_count += frame->nb_samples;
-    if ((ret = update_md5_sum(s, frame->data[0])) < 0) {
-        av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
-        return ret;
+    if (!avctx->internal->frame_thread_encoder) {
+        ret = update_stream_info(s, frame, out_bytes);
+        if (ret < 0)
+            return ret;
     }
-    if (out_bytes > s->max_encoded_framesize)
-        s->max_encoded_framesize = out_bytes;
-    if (out_bytes < s->min_framesize)
-        s->min_framesize = out_bytes;
-
-    s->next_pts = frame->pts + ff_samples_to_time_base(avctx, frame->nb_samples);
 
     av_shrink_packet(avpkt, out_bytes);
 
@@ -1698,6 +1724,14 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     return 0;
 }
 
+#if HAVE_THREADS
+static int flac_update_encoder_context(AVCodecContext *avctx,
+                                       const AVFrame *frame,
+                                       const AVPacket *pkt)
+{
+    return update_stream_info(avctx->priv_data, frame, pkt->size);
+}
+#endif
 
 static av_cold int flac_encode_close(AVCodecContext *avctx)
 {
@@ -1755,10 +1789,12 @@ const FFCodec ff_flac_encoder = {
     .p.id           = AV_CODEC_ID_FLAC,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
                       AV_CODEC_CAP_SMALL_LAST_FRAME |
+                      AV_CODEC_CAP_FRAME_THREADS |
                       AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
     .priv_data_size = sizeof(FlacEncodeContext),
     .init           = flac_encode_init,
     FF_CODEC_ENCODE_CB(flac_encode_frame),
+    UPDATE_ENCODER_CONTEXT(flac_update_encoder_context),
     .close          = flac_encode_close,
     CODEC_SAMPLEFMTS(AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32),
     .p.priv_class   = &flac_encoder_class,
@@ -29,6 +29,7 @@
 #include "libavutil/thread.h"
 #include "avcodec.h"
 #include "avcodec_internal.h"
+#include "codec_internal.h"
 #include "codec_par.h"
 #include "encode.h"
 #include "internal.h"
@@ -43,7 +44,9 @@
 
 typedef struct{
     AVFrame  *indata;
+    AVFrame  *inref;     ///< reference to indata for FFCodec.update_encoder_context
     AVPacket *outdata;
+    int64_t   frame_num;
     int       return_code;
     int       finished;
     int       got_packet;
@@ -64,6 +67,7 @@ typedef struct{
     unsigned next_task_index;
     unsigned task_index;
     unsigned finished_task_index;
+    int64_t  frame_num;
 
     pthread_t worker[MAX_THREADS];
     atomic_int exit;
@@ -105,6 +109,8 @@ static void * attribute_align_arg worker(void *v){
         frame = task->indata;
         pkt   = task->outdata;
 
+        /* Let the encoder know the position of the frame in the stream. */
+        avctx->frame_num = task->frame_num;
         ret = ff_encode_encode_cb(avctx, pkt, frame, &task->got_packet);
         pthread_mutex_lock(&c->finished_task_mutex);
         task->return_code = ret;
@@ -113,13 +119,16 @@ static void * attribute_align_arg worker(void *v){
         pthread_mutex_unlock(&c->finished_task_mutex);
     }
 end:
+    /* The thread context belongs to the parent; do not let closing a worker
+     * with slice threads of its own try to free it. */
+    avctx->internal->frame_thread_encoder = NULL;
     avcodec_free_context(&avctx);
     return NULL;
 }
 
 av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
 {
-    int i=0;
+    int i=0, slice_threads = 1;
     ThreadContext *c;
     AVCodecContext *thread_avctx = NULL;
     AVCodecParameters *par = NULL;
@@ -164,6 +173,16 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
         }
     }
 
+    if (avctx->codec_id == AV_CODEC_ID_FFV1 &&
+        (avctx->gop_size > 1 || avctx->flags & AV_CODEC_FLAG_PASS1)) {
+        // only intra-only FFV1 frames can be coded independently
+        av_log(avctx, AV_LOG_DEBUG,
+               "Using slice threads for FFV1 encoding with a GOP size above 1 "
+               "or first pass\n");
+        avctx->thread_type &= ~FF_THREAD_FRAME;
+        return 0;
+    }
+
     if(!avctx->thread_count) {
         avctx->thread_count = av_cpu_count();
         avctx->thread_count = FFMIN(avctx->thread_count, MAX_THREADS);
@@ -175,6 +194,19 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
     if(avctx->thread_count > MAX_THREADS)
         return AVERROR(EINVAL);
 
+    if ((avctx->thread_type & FF_THREAD_SLICE) &&
+        (avctx->codec->capabilities & AV_CODEC_CAP_SLICE_THREADS) &&
+        (ffcodec(avctx->codec)->caps_internal & FF_CODEC_CAP_FRAME_AND_SLICE_THREADS)) {
+        /* Split the threads evenly between frames and slices */
+        int frame_threads = 1;
+        while (frame_threads * frame_threads < avctx->thread_count)
+            frame_threads++;
+        slice_threads       = (avctx->thread_count + frame_threads - 1) / frame_threads;
+        avctx->thread_count = frame_threads;
+        av_log(avctx, AV_LOG_DEBUG, "Using %d frame threads with %d slice threads each\n",
+               frame_threads, slice_threads);
+    }
+
     av_assert0(!avctx->internal->frame_thread_encoder);
     c = avctx->internal->frame_thread_encoder = av_mallocz(sizeof(ThreadContext));
     if(!c)
@@ -194,6 +226,11 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
             ret = AVERROR(ENOMEM);
             goto fail;
         }
+        if (ffcodec(avctx->codec)->update_encoder_context &&
+            !(c->tasks[j].inref = av_frame_alloc())) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
     }
 
     par = avcodec_parameters_alloc();
@@ -225,7 +262,8 @@ av_cold int ff_frame_thread_encoder_init(AVCodecContext *avctx)
             if (ret < 0)
                 goto fail;
         }
-        thread_avctx->thread_count = 1;
+        thread_avctx->thread_count = slice_threads;
+        thread_avctx->thread_type  = FF_THREAD_SLICE;
         thread_avctx->active_thread_type &= ~FF_THREAD_FRAME;
 
 #define DUP_MATRIX(m)                                                       \
@@ -291,6 +329,7 @@ av_cold void ff_frame_thread_encoder_free(AVCodecContext *avctx)
 
     for (unsigned i = 0; i < c->max_tasks; i++) {
         av_frame_free(&c->tasks[i].indata);
+        av_frame_free(&c->tasks[i].inref);
         av_packet_free(&c->tasks[i].outdata);
     }
 
@@ -302,12 +341,22 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                                  AVFrame *frame, int *got_packet_ptr)
 {
     ThreadContext *c = avctx->internal->frame_thread_encoder;
+    const FFCodec *const codec = ffcodec(avctx->codec);
     Task *outtask;
+    int ret;
 
     av_assert1(!*got_packet_ptr);
 
     if(frame){
-        av_frame_move_ref(c->tasks[c->task_index].indata, frame);
+        Task *task = &c->tasks[c->task_index];
+
+        if (task->inref) {
+            ret = av_frame_ref(task->inref, frame);
+            if (ret < 0)
+                return ret;
+        }
+        av_frame_move_ref(task->indata, frame);
+        task->frame_num = c->frame_num++;
 
         pthread_mutex_lock(&c->task_fifo_mutex);
         c->task_index = (c->task_index + 1) % c->max_tasks;
@@ -323,6 +372,13 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         (frame && !outtask->finished &&
          (c->task_index - c->finished_task_index + c->max_tasks) % c->max_tasks <= avctx->thread_count)) {
             pthread_mutex_unlock(&c->finished_task_mutex);
+            /* All frames are done, give encoders keeping stream state in the
+             * user-facing context the chance to return their final packet.
+             * Other encoders never ran on that context, so it is not flushed. */
+            if (!frame && c->task_index == c->finished_task_index &&
+                codec->update_encoder_context &&
+                avctx->codec->capabilities & AV_CODEC_CAP_DELAY)
+                return ff_encode_encode_cb(avctx, pkt, NULL, got_packet_ptr);
             return 0;
         }
     while (!outtask->finished) {
@@ -336,5 +392,12 @@ int ff_thread_video_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     *got_packet_ptr = outtask->got_packet;
     c->finished_task_index = (c->finished_task_index + 1) % c->max_tasks;
 
-    return outtask->return_code;
+    ret = outtask->return_code;
+    if (ret >= 0 && *got_packet_ptr && codec->update_encoder_context)
+        ret = codec->update_encoder_context(avctx, outtask->inref, pkt);
+    av_frame_unref(outtask->inref);
+    if (ret < 0)
+        av_packet_unref(pkt);
+
+    return ret;
 }
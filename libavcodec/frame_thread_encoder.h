@@ -25,6 +25,13 @@
 
 /**
  * Initialize frame thread encoder.
+ *
+ * Every frame is encoded by one of the worker contexts, with
+ * AVCodecContext.frame_num set to the index of the frame in the stream.
+ * Encoders with AV_CODEC_CAP_DELAY that keep state in the user-facing context
+ * through FFCodec.update_encoder_context() are flushed on that context once
+ * all frames have been encoded.
+ *
  * @note hardware encoders are not supported
  */
 int ff_frame_thread_encoder_init(AVCodecContext *avctx);
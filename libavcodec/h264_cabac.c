@@ -1743,14 +1743,25 @@ decode_cabac_residual_internal(const H264Context *h, H264SliceContext *sl,
 \
             if( coeff_abs >= 15 ) { \
                 int j = 0; \
-                while (get_cabac_bypass(CC) && j < 16+7) { \
-                    j++; \
+                /* Most prefixes are 0 or 1 bins long, which single bin \
+                 * decoding handles faster than the multi-bin helpers. */ \
+                if (get_cabac_bypass(CC)) { \
+                    j = 1; \
+                    if (get_cabac_bypass(CC)) { \
+                        j = 2 + get_cabac_bypass_unary(CC, 16+7-2); \
+                        if (j == 16+7) \
+                            get_cabac_bypass(CC); \
+                    } \
                 } \
 \
-                coeff_abs=1; \
-                while( j-- ) { \
-                    coeff_abs += coeff_abs + get_cabac_bypass( CC ); \
-                } \
+                coeff_abs = 1U << j; \
+                if (j > 16) { \
+                    coeff_abs += get_cabac_bypass_bits(CC, 16) << (j - 16); \
+                    coeff_abs += get_cabac_bypass_bits(CC, j - 16); \
+                } else if (j > 1) \
+                    coeff_abs += get_cabac_bypass_bits(CC, j); \
+                else if (j) \
+                    coeff_abs += get_cabac_bypass(CC); \
                 coeff_abs+= 14U; \
             } \
 \
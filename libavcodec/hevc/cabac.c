@@ -938,72 +938,6 @@ static av_always_inline int coeff_abs_level_greater2_flag_decode(HEVCLocalContex
     return GET_CABAC(COEFF_ABS_LEVEL_GREATER2_FLAG_OFFSET + inc);
 }
 
-/* a run of bypass bins is the quotient of the offset by range << 17 */
-static int cabac_bypass_bits(CABACContext *c, int n)
-{
-    int avail = CABAC_BITS - ff_ctz(c->low);
-    uint64_t x, r = (uint64_t)c->range << (CABAC_BITS + 1);
-    const uint8_t *bytestream = c->bytestream;
-
-    if (n < avail) {
-        x = (uint64_t)c->low << n;
-    } else {
-        int fill = (bytestream[0] << 9) + (bytestream[1] << 1) - CABAC_MASK;
-
-        x = (uint64_t)((((int64_t)c->low << avail) + fill)) << (n - avail);
-#if !UNCHECKED_BITSTREAM_READER
-        if (bytestream < c->bytestream_end)
-#endif
-            bytestream += CABAC_BITS / 8;
-    }
-
-    if (x < r << n) {
-        c->low = x % r;
-        c->bytestream = bytestream;
-        return x / r;
-    } else {
-        int ret = 0;
-
-        for (int i = 0; i < n; i++)
-            ret = (ret << 1) | get_cabac_bypass(c);
-        return ret;
-    }
-}
-
-/* leading ones of the quotient, consumed only up to the first zero */
-static int cabac_unary_prefix(CABACContext *c, int max)
-{
-    int prefix = 0;
-
-    while (prefix < max) {
-        int avail = CABAC_BITS - ff_ctz(c->low);
-        int n = FFMIN(avail - 1, max - prefix);
-        uint64_t r = (uint64_t)c->range << (CABAC_BITS + 1);
-        uint64_t x = (uint64_t)c->low << n;
-        int q, t;
-
-        if (n < 1 || x >= r << n) {
-            if (!get_cabac_bypass(c))
-                return prefix;
-            prefix++;
-            continue;
-        }
-
-        q = x / r;
-        t = ~q & ((1 << n) - 1);
-        if (t) {
-            int p = n - 1 - av_log2(t);
-            int k = n - (p + 1);
-
-            c->low = (x >> k) - ((uint64_t)(q >> k) * r);
-            return prefix + p;
-        }
-        c->low = x - (uint64_t)q * r;
-        prefix += n;
-    }
-    return prefix;
-}
-
 static av_always_inline int coeff_abs_level_remaining_decode(HEVCLocalContext *lc, int rc_rice_param)
 {
     int prefix;
@@ -1011,11 +945,11 @@ static av_always_inline int coeff_abs_level_remaining_decode(HEVCLocalContext *l
     int last_coeff_abs_level_remaining;
     int i;
 
-    prefix = cabac_unary_prefix(&lc->cc, CABAC_MAX_BIN);
+    prefix = get_cabac_bypass_unary(&lc->cc, CABAC_MAX_BIN);
 
     if (prefix < 3) {
         if (rc_rice_param > 2)
-            suffix = cabac_bypass_bits(&lc->cc, rc_rice_param);
+            suffix = get_cabac_bypass_bits(&lc->cc, rc_rice_param);
         else
             for (i = 0; i < rc_rice_param; i++)
                 suffix = (suffix << 1) | get_cabac_bypass(&lc->cc);
@@ -1031,10 +965,10 @@ static av_always_inline int coeff_abs_level_remaining_decode(HEVCLocalContext *l
 
         k = prefix_minus3 + rc_rice_param;
         if (k > 16) {
-            suffix  = cabac_bypass_bits(&lc->cc, 16) << (k - 16);
-            suffix |= cabac_bypass_bits(&lc->cc, k - 16);
+            suffix  = get_cabac_bypass_bits(&lc->cc, 16) << (k - 16);
+            suffix |= get_cabac_bypass_bits(&lc->cc, k - 16);
         } else if (k > 2) {
-            suffix = cabac_bypass_bits(&lc->cc, k);
+            suffix = get_cabac_bypass_bits(&lc->cc, k);
         } else {
             for (i = 0; i < k; i++)
                 suffix = (suffix << 1) | get_cabac_bypass(&lc->cc);
@@ -1051,7 +985,7 @@ static av_always_inline int coeff_sign_flag_decode(HEVCLocalContext *lc, uint8_t
     int ret = 0;
 
     if (nb > 2)
-        return cabac_bypass_bits(&lc->cc, nb);
+        return get_cabac_bypass_bits(&lc->cc, nb);
 
     for (i = 0; i < nb; i++)
         ret = (ret << 1) | get_cabac_bypass(&lc->cc);
@@ -739,6 +739,72 @@ static int boundary_strength(const HEVCContext *s, const MvField *curr, const Mv
     return 1;
 }
 
+static void upper_edge_boundary_strengths(const HEVCContext *s, const HEVCLayerContext *l,
+                                          const HEVCSPS *sps, const RefPicList *rpl_top,
+                                          int x0, int y0, int width)
+{
+    const MvField *tab_mvf = s->cur_frame->tab_mvf;
+    int log2_min_pu_size = sps->log2_min_pu_size;
+    int log2_min_tu_size = sps->log2_min_tb_size;
+    int min_pu_width     = sps->min_pu_width;
+    int min_tu_width     = sps->min_tb_width;
+    int yp_pu = (y0 - 1) >> log2_min_pu_size;
+    int yq_pu =  y0      >> log2_min_pu_size;
+    int yp_tu = (y0 - 1) >> log2_min_tu_size;
+    int yq_tu =  y0      >> log2_min_tu_size;
+
+    for (int i = 0; i < width; i += 4) {
+        int x_pu = (x0 + i) >> log2_min_pu_size;
+        int x_tu = (x0 + i) >> log2_min_tu_size;
+        const MvField *top  = &tab_mvf[yp_pu * min_pu_width + x_pu];
+        const MvField *curr = &tab_mvf[yq_pu * min_pu_width + x_pu];
+        uint8_t top_cbf_luma  = l->cbf_luma[yp_tu * min_tu_width + x_tu];
+        uint8_t curr_cbf_luma = l->cbf_luma[yq_tu * min_tu_width + x_tu];
+        int bs;
+
+        if (curr->pred_flag == PF_INTRA || top->pred_flag == PF_INTRA)
+            bs = 2;
+        else if (curr_cbf_luma || top_cbf_luma)
+            bs = 1;
+        else
+            bs = boundary_strength(s, curr, top, rpl_top);
+        l->horizontal_bs[((x0 + i) + y0 * l->bs_width) >> 2] = bs;
+    }
+}
+
+static void left_edge_boundary_strengths(const HEVCContext *s, const HEVCLayerContext *l,
+                                         const HEVCSPS *sps, const RefPicList *rpl_left,
+                                         int x0, int y0, int height)
+{
+    const MvField *tab_mvf = s->cur_frame->tab_mvf;
+    int log2_min_pu_size = sps->log2_min_pu_size;
+    int log2_min_tu_size = sps->log2_min_tb_size;
+    int min_pu_width     = sps->min_pu_width;
+    int min_tu_width     = sps->min_tb_width;
+    int xp_pu = (x0 - 1) >> log2_min_pu_size;
+    int xq_pu =  x0      >> log2_min_pu_size;
+    int xp_tu = (x0 - 1) >> log2_min_tu_size;
+    int xq_tu =  x0      >> log2_min_tu_size;
+
+    for (int i = 0; i < height; i += 4) {
+        int y_pu      = (y0 + i) >> log2_min_pu_size;
+        int y_tu      = (y0 + i) >> log2_min_tu_size;
+        const MvField *left = &tab_mvf[y_pu * min_pu_width + xp_pu];
+        const MvField *curr = &tab_mvf[y_pu * min_pu_width + xq_pu];
+        uint8_t left_cbf_luma = l->cbf_luma[y_tu * min_tu_width + xp_tu];
+        uint8_t curr_cbf_luma = l->cbf_luma[y_tu * min_tu_width + xq_tu];
+        int bs;
+
+        if (curr->pred_flag == PF_INTRA || left->pred_flag == PF_INTRA)
+            bs = 2;
+        else if (curr_cbf_luma || left_cbf_luma)
+            bs = 1;
+        else
+            bs = boundary_strength(s, curr, left, rpl_left);
+        l->vertical_bs[(x0 + (y0 + i) * l->bs_width) >> 2] = bs;
+    }
+}
+
 void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, const HEVCLayerContext *l,
                                            const HEVCPPS *pps,
                                            int x0, int y0, int log2_trafo_size)
@@ -747,20 +813,20 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, const HEVCLayer
     const HEVCContext *s = lc->parent;
     const MvField *tab_mvf = s->cur_frame->tab_mvf;
     int log2_min_pu_size = sps->log2_min_pu_size;
-    int log2_min_tu_size = sps->log2_min_tb_size;
     int min_pu_width     = sps->min_pu_width;
-    int min_tu_width     = sps->min_tb_width;
     int is_intra = tab_mvf[(y0 >> log2_min_pu_size) * min_pu_width +
                            (x0 >> log2_min_pu_size)].pred_flag == PF_INTRA;
     int boundary_upper, boundary_left;
     int i, j, bs;
 
+    /* With tile threads, the neighbouring tile may not be decoded yet; its
+     * edges are handled by ff_hevc_tile_boundary_strengths() afterwards. */
     boundary_upper = y0 > 0 && !(y0 & 7);
     if (boundary_upper &&
         ((!s->sh.slice_loop_filter_across_slices_enabled_flag &&
           lc->boundary_flags & BOUNDARY_UPPER_SLICE &&
           (y0 % (1 << sps->log2_ctb_size)) == 0) ||
-         (!pps->loop_filter_across_tiles_enabled_flag &&
+         ((!pps->loop_filter_across_tiles_enabled_flag || s->tile_threads_active) &&
           lc->boundary_flags & BOUNDARY_UPPER_TILE &&
           (y0 % (1 << sps->log2_ctb_size)) == 0)))
         boundary_upper = 0;
@@ -769,27 +835,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, const HEVCLayer
         const RefPicList *rpl_top = (lc->boundary_flags & BOUNDARY_UPPER_SLICE) ?
                                     ff_hevc_get_ref_list(s->cur_frame, x0, y0 - 1) :
                                     s->cur_frame->refPicList;
-        int yp_pu = (y0 - 1) >> log2_min_pu_size;
-        int yq_pu =  y0      >> log2_min_pu_size;
-        int yp_tu = (y0 - 1) >> log2_min_tu_size;
-        int yq_tu =  y0      >> log2_min_tu_size;
-
-            for (i = 0; i < (1 << log2_trafo_size); i += 4) {
-                int x_pu = (x0 + i) >> log2_min_pu_size;
-                int x_tu = (x0 + i) >> log2_min_tu_size;
-                const MvField *top  = &tab_mvf[yp_pu * min_pu_width + x_pu];
-                const MvField *curr = &tab_mvf[yq_pu * min_pu_width + x_pu];
-                uint8_t top_cbf_luma  = l->cbf_luma[yp_tu * min_tu_width + x_tu];
-                uint8_t curr_cbf_luma = l->cbf_luma[yq_tu * min_tu_width + x_tu];
-
-                if (curr->pred_flag == PF_INTRA || top->pred_flag == PF_INTRA)
-                    bs = 2;
-                else if (curr_cbf_luma || top_cbf_luma)
-                    bs = 1;
-                else
-                    bs = boundary_strength(s, curr, top, rpl_top);
-                l->horizontal_bs[((x0 + i) + y0 * l->bs_width) >> 2] = bs;
-            }
+        upper_edge_boundary_strengths(s, l, sps, rpl_top, x0, y0, 1 << log2_trafo_size);
     }
 
     // bs for vertical TU boundaries
@@ -798,7 +844,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, const HEVCLayer
         ((!s->sh.slice_loop_filter_across_slices_enabled_flag &&
           lc->boundary_flags & BOUNDARY_LEFT_SLICE &&
           (x0 % (1 << sps->log2_ctb_size)) == 0) ||
-         (!pps->loop_filter_across_tiles_enabled_flag &&
+         ((!pps->loop_filter_across_tiles_enabled_flag || s->tile_threads_active) &&
           lc->boundary_flags & BOUNDARY_LEFT_TILE &&
           (x0 % (1 << sps->log2_ctb_size)) == 0)))
         boundary_left = 0;
@@ -807,27 +853,7 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, const HEVCLayer
         const RefPicList *rpl_left = (lc->boundary_flags & BOUNDARY_LEFT_SLICE) ?
                                      ff_hevc_get_ref_list(s->cur_frame, x0 - 1, y0) :
                                      s->cur_frame->refPicList;
-        int xp_pu = (x0 - 1) >> log2_min_pu_size;
-        int xq_pu =  x0      >> log2_min_pu_size;
-        int xp_tu = (x0 - 1) >> log2_min_tu_size;
-        int xq_tu =  x0      >> log2_min_tu_size;
-
-            for (i = 0; i < (1 << log2_trafo_size); i += 4) {
-                int y_pu      = (y0 + i) >> log2_min_pu_size;
-                int y_tu      = (y0 + i) >> log2_min_tu_size;
-                const MvField *left = &tab_mvf[y_pu * min_pu_width + xp_pu];
-                const MvField *curr = &tab_mvf[y_pu * min_pu_width + xq_pu];
-                uint8_t left_cbf_luma = l->cbf_luma[y_tu * min_tu_width + xp_tu];
-                uint8_t curr_cbf_luma = l->cbf_luma[y_tu * min_tu_width + xq_tu];
-
-                if (curr->pred_flag == PF_INTRA || left->pred_flag == PF_INTRA)
-                    bs = 2;
-                else if (curr_cbf_luma || left_cbf_luma)
-                    bs = 1;
-                else
-                    bs = boundary_strength(s, curr, left, rpl_left);
-                l->vertical_bs[(x0 + (y0 + i) * l->bs_width) >> 2] = bs;
-            }
+        left_edge_boundary_strengths(s, l, sps, rpl_left, x0, y0, 1 << log2_trafo_size);
     }
 
     if (log2_trafo_size > log2_min_pu_size && !is_intra) {
@@ -865,6 +891,42 @@ void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, const HEVCLayer
     }
 }
 
+void ff_hevc_tile_boundary_strengths(const HEVCContext *s, const HEVCLayerContext *l,
+                                     const HEVCPPS *pps, int x_ctb, int y_ctb)
+{
+    const HEVCSPS *const sps = pps->sps;
+    int ctb_size    = 1 << sps->log2_ctb_size;
+    int ctb_addr_rs = (y_ctb >> sps->log2_ctb_size) * sps->ctb_width +
+                      (x_ctb >> sps->log2_ctb_size);
+    int ctb_addr_ts = pps->ctb_addr_rs_to_ts[ctb_addr_rs];
+
+    if (s->sh.disable_deblocking_filter_flag ||
+        !pps->loop_filter_across_tiles_enabled_flag)
+        return;
+
+    if (y_ctb > 0 &&
+        pps->tile_id[ctb_addr_ts] != pps->tile_id[pps->ctb_addr_rs_to_ts[ctb_addr_rs - sps->ctb_width]]) {
+        int slice_edge = l->tab_slice_address[ctb_addr_rs] !=
+                         l->tab_slice_address[ctb_addr_rs - sps->ctb_width];
+        if (!slice_edge || s->sh.slice_loop_filter_across_slices_enabled_flag)
+            upper_edge_boundary_strengths(s, l, sps,
+                                          slice_edge ? ff_hevc_get_ref_list(s->cur_frame, x_ctb, y_ctb - 1) :
+                                                       s->cur_frame->refPicList,
+                                          x_ctb, y_ctb, FFMIN(ctb_size, sps->width - x_ctb));
+    }
+
+    if (x_ctb > 0 &&
+        pps->tile_id[ctb_addr_ts] != pps->tile_id[pps->ctb_addr_rs_to_ts[ctb_addr_rs - 1]]) {
+        int slice_edge = l->tab_slice_address[ctb_addr_rs] !=
+                         l->tab_slice_address[ctb_addr_rs - 1];
+        if (!slice_edge || s->sh.slice_loop_filter_across_slices_enabled_flag)
+            left_edge_boundary_strengths(s, l, sps,
+                                         slice_edge ? ff_hevc_get_ref_list(s->cur_frame, x_ctb - 1, y_ctb) :
+                                                      s->cur_frame->refPicList,
+                                         x_ctb, y_ctb, FFMIN(ctb_size, sps->height - y_ctb));
+    }
+}
+
 #undef LUMA
 #undef CB
 #undef CR
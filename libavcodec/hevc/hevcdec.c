@@ -2712,7 +2712,10 @@ static void hls_decode_neighbour(HEVCLocalContext *lc,
     int ctb_addr_rs       = pps->ctb_addr_ts_to_rs[ctb_addr_ts];
     int ctb_addr_in_slice = ctb_addr_rs - s->sh.slice_addr;
 
-    l->tab_slice_address[ctb_addr_rs] = s->sh.slice_addr;
+    /* Tile threads fill in the addresses of the whole slice segment up front,
+     * as they are read for the left and upper neighbours. */
+    if (l->tab_slice_address[ctb_addr_rs] != s->sh.slice_addr)
+        l->tab_slice_address[ctb_addr_rs] = s->sh.slice_addr;
 
     if (pps->entropy_coding_sync_enabled_flag) {
         if (x_ctb == 0 && (y_ctb & (ctb_size - 1)) == 0)
@@ -2902,6 +2905,118 @@ error:
     return ret;
 }
 
+static int hls_decode_entry_tile(AVCodecContext *avctx, void *hevc_lclist,
+                                 int job, int thread)
+{
+    HEVCLocalContext *lc = &((HEVCLocalContext*)hevc_lclist)[thread];
+    const HEVCContext *const s = lc->parent;
+    const HEVCLayerContext *const l = &s->layers[s->cur_layer];
+    const HEVCPPS   *const pps = s->pps;
+    const HEVCSPS   *const sps = pps->sps;
+    int tile        = pps->tile_id[pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs]] + job;
+    int tile_x      = tile % pps->num_tile_columns;
+    int tile_y      = tile / pps->num_tile_columns;
+    int ctb_addr_ts = pps->ctb_addr_rs_to_ts[pps->row_bd[tile_y] * sps->ctb_width +
+                                             pps->col_bd[tile_x]];
+    int ctb_addr_end = ctb_addr_ts + pps->column_width[tile_x] * pps->row_height[tile_y];
+    int ctb_addr_rs = 0;
+    int more_data   = 1;
+    int ret;
+
+    const uint8_t *data      = s->data + s->sh.offset[job];
+    const size_t   data_size = s->sh.size[job];
+
+    lc->end_of_tiles_x = (pps->col_bd[tile_x] + pps->column_width[tile_x]) << sps->log2_ctb_size;
+
+    while (more_data && ctb_addr_ts < ctb_addr_end) {
+        int x_ctb, y_ctb;
+
+        ctb_addr_rs = pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+        x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+        y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+
+        hls_decode_neighbour(lc, l, pps, sps, x_ctb, y_ctb, ctb_addr_ts);
+
+        /* Casting const away here is safe, because it is an atomic operation. */
+        if (atomic_load((atomic_int*)&s->wpp_err))
+            return 0;
+
+        ret = ff_hevc_cabac_init(lc, pps, ctb_addr_ts, data, data_size, 1);
+        if (ret < 0)
+            goto error;
+        hls_sao_param(lc, l, pps, sps,
+                      x_ctb >> sps->log2_ctb_size, y_ctb >> sps->log2_ctb_size);
+
+        l->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
+        l->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+        l->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
+
+        more_data = hls_coding_quadtree(lc, l, pps, sps, x_ctb, y_ctb, sps->log2_ctb_size, 0);
+        if (more_data < 0) {
+            ret = more_data;
+            goto error;
+        }
+
+        ctb_addr_ts++;
+    }
+
+    if (ctb_addr_ts < ctb_addr_end && job != s->sh.num_entry_point_offsets) {
+        av_log(avctx, AV_LOG_ERROR, "Slice segment ends inside tile %d\n", tile);
+        ret = AVERROR_INVALIDDATA;
+        goto error;
+    }
+
+    /* The in-loop filters run once all tiles are done, see hls_tile_filters() */
+    return ctb_addr_ts;
+error:
+    l->tab_slice_address[ctb_addr_rs] = -1;
+    /* Casting const away here is safe, because it is an atomic operation. */
+    atomic_store((atomic_int*)&s->wpp_err, 1);
+    return ret;
+}
+
+/**
+ * Run the in-loop filters over the tiles decoded by hls_decode_entry_tile(),
+ * in the same order as the serial decoder does.
+ */
+static void hls_tile_filters(HEVCContext *s, const int *ctb_addr_end)
+{
+    HEVCLocalContext *const lc = &s->local_ctx[0];
+    const HEVCLayerContext *const l = &s->layers[s->cur_layer];
+    const HEVCPPS   *const pps = s->pps;
+    const HEVCSPS   *const sps = pps->sps;
+    int ctb_size  = 1 << sps->log2_ctb_size;
+    int tile0     = pps->tile_id[pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs]];
+    int x_ctb = 0, y_ctb = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i <= s->sh.num_entry_point_offsets; i++) {
+            int tile_x = (tile0 + i) % pps->num_tile_columns;
+            int tile_y = (tile0 + i) / pps->num_tile_columns;
+            int ctb_addr_ts = pps->ctb_addr_rs_to_ts[pps->row_bd[tile_y] * sps->ctb_width +
+                                                     pps->col_bd[tile_x]];
+
+            for (; ctb_addr_ts < ctb_addr_end[i]; ctb_addr_ts++) {
+                int ctb_addr_rs = pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+
+                x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+                y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+                if (!pass) {
+                    if (x_ctb == pps->col_bd[tile_x] << sps->log2_ctb_size ||
+                        y_ctb == pps->row_bd[tile_y] << sps->log2_ctb_size)
+                        ff_hevc_tile_boundary_strengths(s, l, pps, x_ctb, y_ctb);
+                } else {
+                    ff_hevc_hls_filters(lc, l, pps, x_ctb, y_ctb, ctb_size);
+                }
+            }
+        }
+    }
+
+    if (x_ctb + ctb_size >= sps->width &&
+        y_ctb + ctb_size >= sps->height)
+        ff_hevc_hls_filter(lc, l, pps, x_ctb, y_ctb, ctb_size);
+}
+
 static int wpp_progress_init(HEVCContext *s, unsigned count)
 {
     if (s->nb_wpp_progress < count) {
@@ -2939,12 +3054,14 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     int64_t startheader, cmpt = 0;
     int j, res = 0;
 
-    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * (int64_t)sps->ctb_width >= sps->ctb_width * (int64_t)sps->ctb_height) {
-        av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
-            s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
-            sps->ctb_width, sps->ctb_height
-        );
-        return AVERROR_INVALIDDATA;
+    if (pps->entropy_coding_sync_enabled_flag) {
+        if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * (int64_t)sps->ctb_width >= sps->ctb_width * (int64_t)sps->ctb_height) {
+            av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
+                s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
+                sps->ctb_width, sps->ctb_height
+            );
+            return AVERROR_INVALIDDATA;
+        }
     }
 
     if (s->avctx->thread_count > s->nb_local_ctx) {
@@ -3020,16 +3137,55 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     if (!ret)
         return AVERROR(ENOMEM);
 
-    if (pps->entropy_coding_sync_enabled_flag)
+    if (pps->entropy_coding_sync_enabled_flag) {
         s->avctx->execute2(s->avctx, hls_decode_entry_wpp, s->local_ctx, ret, s->sh.num_entry_point_offsets + 1);
+    } else {
+        const HEVCLayerContext *const l = &s->layers[s->cur_layer];
+        int tile0 = pps->tile_id[pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs]];
+
+        for (int i = 0; i <= s->sh.num_entry_point_offsets; i++) {
+            int tile_x = (tile0 + i) % pps->num_tile_columns;
+            int tile_y = (tile0 + i) / pps->num_tile_columns;
+            for (int y = pps->row_bd[tile_y]; y < pps->row_bd[tile_y + 1]; y++)
+                for (int x = pps->col_bd[tile_x]; x < pps->col_bd[tile_x + 1]; x++)
+                    l->tab_slice_address[y * sps->ctb_width + x] = s->sh.slice_addr;
+        }
+
+        s->tile_threads_active = 1;
+        s->avctx->execute2(s->avctx, hls_decode_entry_tile, s->local_ctx, ret, s->sh.num_entry_point_offsets + 1);
+        s->tile_threads_active = 0;
+
+        for (int i = 0; i <= s->sh.num_entry_point_offsets; i++)
+            if (ret[i] < 0) {
+                res = ret[i];
+                goto end;
+            }
+        hls_tile_filters(s, ret);
+    }
 
     for (int i = 0; i <= s->sh.num_entry_point_offsets; i++)
         res += ret[i];
+end:
 
     av_free(ret);
     return res;
 }
 
+/**
+ * Check whether the entry points of the current slice segment are the starts
+ * of whole tiles, which can then be decoded independently.
+ */
+static int slice_has_whole_tiles(const HEVCContext *s)
+{
+    const HEVCPPS *const pps = s->pps;
+    int ctb_addr_ts = pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+    int tile        = pps->tile_id[ctb_addr_ts];
+
+    return pps->tiles_enabled_flag && !pps->entropy_coding_sync_enabled_flag &&
+           (!ctb_addr_ts || pps->tile_id[ctb_addr_ts - 1] != tile) &&
+           tile + (int64_t)s->sh.num_entry_point_offsets < pps->num_tile_columns * pps->num_tile_rows;
+}
+
 static int decode_slice_data(HEVCContext *s, const HEVCLayerContext *l,
                              const H2645NAL *nal, GetBitContext *gb)
 {
@@ -3078,7 +3234,8 @@ static int decode_slice_data(HEVCContext *s, const HEVCLayerContext *l,
 
     if (s->avctx->active_thread_type == FF_THREAD_SLICE  &&
         s->sh.num_entry_point_offsets > 0                &&
-        pps->num_tile_rows == 1 && pps->num_tile_columns == 1)
+        ((pps->num_tile_rows == 1 && pps->num_tile_columns == 1) ||
+         slice_has_whole_tiles(s)))
         return hls_slice_data_wpp(s, nal);
 
     return hls_decode_entry(s, gb);
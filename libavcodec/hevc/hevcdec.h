@@ -548,6 +548,9 @@ typedef struct HEVCContext {
 
     atomic_int wpp_err;
 
+    /** set while the tiles of a slice segment are decoded in parallel */
+    int tile_threads_active;
+
     const uint8_t *data;
 
     H2645Packet pkt;
@@ -706,6 +709,12 @@ void ff_hevc_set_qPy(HEVCLocalContext *lc,
 void ff_hevc_deblocking_boundary_strengths(HEVCLocalContext *lc, const HEVCLayerContext *l,
                                            const HEVCPPS *pps,
                                            int x0, int y0, int log2_trafo_size);
+/**
+ * Derive the boundary strengths of the tile edges of a CTB once its
+ * neighbouring tiles have been decoded.
+ */
+void ff_hevc_tile_boundary_strengths(const HEVCContext *s, const HEVCLayerContext *l,
+                                     const HEVCPPS *pps, int x_ctb, int y_ctb);
 int ff_hevc_cu_qp_delta_sign_flag(HEVCLocalContext *lc);
 int ff_hevc_cu_qp_delta_abs(HEVCLocalContext *lc);
 int ff_hevc_cu_chroma_qp_offset_flag(HEVCLocalContext *lc);
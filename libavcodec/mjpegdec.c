@@ -148,6 +148,13 @@ av_cold int ff_mjpeg_decode_init(AVCodecContext *avctx)
     if ((ret = init_default_huffman_tables(s)) < 0)
         return ret;
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        s->slice_ctx = av_calloc(avctx->thread_count, sizeof(*s->slice_ctx));
+        if (!s->slice_ctx)
+            return AVERROR(ENOMEM);
+        s->nb_slice_ctx = avctx->thread_count;
+    }
+
 #if FF_API_MJPEG_EXTERN_HUFF
     if (s->extern_huff && avctx->extradata) {
         av_log(avctx, AV_LOG_INFO, "using external huffman table\n");
@@ -837,41 +844,43 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index, int *val)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index, int *val)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0 || code > 16) {
         av_log(s->avctx, AV_LOG_ERROR,
                "mjpeg_decode_dc: bad vlc: %d\n", dc_index);
         return AVERROR_INVALIDDATA;
     }
 
-    *val = code ? get_xbits(&s->gb, code) : 0;
+    *val = code ? get_xbits(gb, code) : 0;
     return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb,
+                        int *last_dc, int16_t *block, int component,
                         int dc_index, int ac_index, uint16_t *quant_matrix)
 {
     int code, i, j, level, val;
 
     /* DC coef */
-    int ret = mjpeg_decode_dc(s, dc_index, &val);
+    int ret = mjpeg_decode_dc(s, gb, dc_index, &val);
     if (ret < 0)
         return ret;
 
-    val = val * (unsigned)quant_matrix[0] + s->last_dc[component];
-    s->last_dc[component] = val;
+    val = val * (unsigned)quant_matrix[0] + last_dc[component];
+    last_dc[component] = val;
     block[0] = av_clip_int16(val);
     /* AC coefs */
     i = 0;
     {
-        OPEN_READER(re, &s->gb);
+        OPEN_READER(re, gb);
         do {
-            UPDATE_CACHE(re, &s->gb);
-            GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+            UPDATE_CACHE(re, gb);
+            GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
 
             i += ((unsigned)code) >> 4;
             code &= 0xf;
@@ -880,12 +889,12 @@ static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
                 // So we have at least MIN_CACHE_BITS - 9 > 15 bits left here
                 // and don't need to refill the cache.
                 {
-                    int cache = GET_CACHE(re, &s->gb);
+                    int cache = GET_CACHE(re, gb);
                     int sign  = (~cache) >> 31;
                     level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
                 }
 
-                LAST_SKIP_BITS(re, &s->gb, code);
+                LAST_SKIP_BITS(re, gb, code);
 
                 if (i > 63) {
                     av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
@@ -895,7 +904,7 @@ static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
                 block[j] = level * quant_matrix[i];
             }
         } while (i < 63);
-        CLOSE_READER(re, &s->gb);
+        CLOSE_READER(re, gb);
     }
 
     return 0;
@@ -907,7 +916,7 @@ static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
 {
     unsigned val;
     s->bdsp.clear_block(block);
-    int ret = mjpeg_decode_dc(s, dc_index, &val);
+    int ret = mjpeg_decode_dc(s, &s->gb, dc_index, &val);
     if (ret < 0)
         return ret;
 
@@ -1160,7 +1169,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s)
 
                 PREDICT(pred, topleft[i], top[i], left[i], modified_predictor);
 
-                ret = mjpeg_decode_dc(s, s->dc_index[i], &dc);
+                ret = mjpeg_decode_dc(s, &s->gb, s->dc_index[i], &dc);
                 if (ret < 0)
                     return ret;
 
@@ -1289,7 +1298,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s)
                     for (j = 0; j < n; j++) {
                         int pred, dc;
 
-                        ret = mjpeg_decode_dc(s, s->dc_index[i], &dc);
+                        ret = mjpeg_decode_dc(s, &s->gb, s->dc_index[i], &dc);
                         if (ret < 0)
                             return ret;
 
@@ -1361,7 +1370,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s)
                     for (j = 0; j < n; j++) {
                         int pred;
 
-                        ret = mjpeg_decode_dc(s, s->dc_index[i], &dc);
+                        ret = mjpeg_decode_dc(s, &s->gb, s->dc_index[i], &dc);
                         if (ret < 0)
                             return ret;
 
@@ -1427,6 +1436,215 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
+typedef struct MJpegScanThreadData {
+    uint8_t *data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    int chroma_width, chroma_height;
+    int nb_segments;
+    int nb_jobs;
+} MJpegScanThreadData;
+
+/**
+ * Split the entropy coded data of a scan at its restart markers.
+ * Returns the number of restart intervals found or 0 if they do not match
+ * the restart interval signalled in DRI.
+ */
+static int mjpeg_find_restart_segments(MJpegDecodeContext *s,
+                                       const uint8_t **pscan_end)
+{
+    const uint8_t *buf_ptr = s->gB.buffer;
+    const uint8_t *buf_end = buf_ptr + bytestream2_get_bytes_left(&s->gB);
+    const uint8_t *ptr = buf_ptr, *seg_start = buf_ptr;
+    const uint8_t *data_end, *scan_end;
+    int max_segments = (s->mb_width * s->mb_height + s->restart_interval - 1) /
+                       s->restart_interval;
+    int nb_segments = 0;
+
+    av_fast_malloc(&s->restart_segments, &s->restart_segments_size,
+                   max_segments * sizeof(*s->restart_segments));
+    if (!s->restart_segments)
+        return AVERROR(ENOMEM);
+
+    while ((ptr = memchr(ptr, 0xff, buf_end - ptr))) {
+        const uint8_t *marker = ptr++;
+        if (ptr < buf_end) {
+            uint8_t x = *ptr++;
+            /* Discard multiple optional 0xFF fill bytes. */
+            while (x == 0xff && ptr < buf_end)
+                x = *ptr++;
+            if (!x)
+                continue;
+            if (x < RST0 || x > RST7) {
+                /* Non-restart marker */
+                data_end = marker;
+                scan_end = ptr - 2;
+                goto found;
+            }
+            if (nb_segments == max_segments - 1)
+                return 0;
+            s->restart_segments[nb_segments].data = seg_start;
+            s->restart_segments[nb_segments].size = marker - seg_start;
+            nb_segments++;
+            seg_start = ptr;
+        }
+    }
+    data_end = scan_end = buf_end;
+found:
+    if (nb_segments != max_segments - 1)
+        return 0;
+    s->restart_segments[nb_segments].data = seg_start;
+    s->restart_segments[nb_segments].size = data_end - seg_start;
+    *pscan_end = scan_end;
+
+    return max_segments;
+}
+
+static int mjpeg_unescape_segment(MJpegSliceContext *sl,
+                                  const MJpegRestartSegment *seg)
+{
+    const uint8_t *src = seg->data;
+    const uint8_t *end = src + seg->size;
+    uint8_t *dst;
+
+    av_fast_padded_malloc(&sl->buffer, &sl->buffer_size, seg->size);
+    if (!sl->buffer)
+        return AVERROR(ENOMEM);
+    dst = sl->buffer;
+
+    /* Markers have been split off already, so any 0xFF inside the
+     * interval is a stuffed zero byte, optionally preceded by fill bytes. */
+    while (src < end) {
+        const uint8_t *ptr = memchr(src, 0xff, end - src);
+        if (!ptr)
+            ptr = end;
+        memcpy(dst, src, ptr - src);
+        dst += ptr - src;
+        src  = ptr;
+        if (src < end) {
+            *dst++ = *src++;
+            while (src < end && *src == 0xff)
+                src++;
+            if (src < end)
+                src++;
+        }
+    }
+
+    return init_get_bits8(&sl->gb, sl->buffer, dst - sl->buffer);
+}
+
+static int mjpeg_decode_restart_intervals(AVCodecContext *avctx, void *arg,
+                                          int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    const MJpegScanThreadData *td = arg;
+    MJpegSliceContext *sl = &s->slice_ctx[threadnr];
+    const int seg_start = jobnr * td->nb_segments / td->nb_jobs;
+    const int seg_end   = (jobnr + 1) * td->nb_segments / td->nb_jobs;
+    const int nb_mcus   = s->mb_width * s->mb_height;
+    const int bytes_per_pixel = 1 + (s->bits > 8);
+    int ret;
+
+    for (int seg = seg_start; seg < seg_end; seg++) {
+        int mcu     = seg * s->restart_interval;
+        int mcu_end = FFMIN(mcu + s->restart_interval, nb_mcus);
+
+        ret = mjpeg_unescape_segment(sl, &s->restart_segments[seg]);
+        if (ret < 0)
+            goto fail;
+        for (int i = 0; i < s->nb_components_sos; i++)
+            sl->last_dc[i] = (4 << s->bits);
+
+        for (; mcu < mcu_end; mcu++) {
+            int mb_x = mcu % s->mb_width;
+            int mb_y = mcu / s->mb_width;
+
+            if (get_bits_left(&sl->gb) < 0) {
+                av_log(avctx, AV_LOG_ERROR, "overread %d\n",
+                       -get_bits_left(&sl->gb));
+                ret = AVERROR_INVALIDDATA;
+                goto fail;
+            }
+            for (int i = 0; i < s->nb_components_sos; i++) {
+                int c = s->comp_index[i];
+                int h = s->h_scount[i];
+                int v = s->v_scount[i];
+                int x = 0, y = 0;
+
+                for (int j = 0; j < s->nb_blocks[i]; j++) {
+                    int block_offset = (((td->linesize[c] * (v * mb_y + y) * 8) +
+                                         (h * mb_x + x) * 8 * bytes_per_pixel) >> avctx->lowres);
+                    uint8_t *ptr = NULL;
+
+                    if (s->interlaced && s->bottom_field)
+                        block_offset += td->linesize[c] >> 1;
+                    if (   8 * (h * mb_x + x) < ((c == 1) || (c == 2) ? td->chroma_width  : s->width)
+                        && 8 * (v * mb_y + y) < ((c == 1) || (c == 2) ? td->chroma_height : s->height))
+                        ptr = td->data[c] + block_offset;
+
+                    s->bdsp.clear_block(sl->block);
+                    if (decode_block(s, &sl->gb, sl->last_dc, sl->block, i,
+                                     s->dc_index[i], s->ac_index[i],
+                                     s->quant_matrixes[s->quant_sindex[i]]) < 0) {
+                        av_log(avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        ret = AVERROR_INVALIDDATA;
+                        goto fail;
+                    }
+                    if (ptr && td->linesize[c]) {
+                        s->idsp.idct_put(ptr, td->linesize[c], sl->block);
+                        if (s->bits & 7)
+                            shift_output(s, ptr, td->linesize[c]);
+                    }
+                    if (++x == h) {
+                        x = 0;
+                        y++;
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+fail:
+    sl->ret = ret;
+    return ret;
+}
+
+/**
+ * Decode the restart intervals of a sequential scan in parallel.
+ * Returns 1 if the scan was decoded, 0 if it has to be decoded serially.
+ */
+static int mjpeg_decode_scan_threaded(MJpegDecodeContext *s,
+                                      MJpegScanThreadData *td)
+{
+    const uint8_t *scan_end;
+    int ret;
+
+    /* Only the mjpeg decoder, which has no MXPEG bitmask or pre-unescaped
+     * THP data, sets up slice contexts. */
+    if (!s->restart_interval || s->progressive)
+        return 0;
+
+    ret = mjpeg_find_restart_segments(s, &scan_end);
+    if (ret < 2)
+        return FFMIN(ret, 0);
+
+    td->nb_segments = ret;
+    td->nb_jobs     = FFMIN(td->nb_segments, 4 * s->nb_slice_ctx);
+    for (int i = 0; i < s->nb_slice_ctx; i++)
+        s->slice_ctx[i].ret = 0;
+
+    s->avctx->execute2(s->avctx, mjpeg_decode_restart_intervals, td, NULL,
+                       td->nb_jobs);
+
+    bytestream2_skipu(&s->gB, scan_end - s->gB.buffer);
+    for (int i = 0; i < s->nb_slice_ctx; i++)
+        if (s->slice_ctx[i].ret < 0)
+            return s->slice_ctx[i].ret;
+
+    return 1;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s)
 {
     int nb_components = s->nb_components_sos;
@@ -1472,6 +1690,20 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s)
 next_field:
     s->restart_count = -1;
 
+    if (s->nb_slice_ctx > 1) {
+        MJpegScanThreadData td = {
+            .chroma_width  = chroma_width,
+            .chroma_height = chroma_height,
+        };
+        memcpy(td.data,     data,     sizeof(data));
+        memcpy(td.linesize, linesize, sizeof(linesize));
+        ret = mjpeg_decode_scan_threaded(s, &td);
+        if (ret < 0)
+            return ret;
+        if (ret)
+            goto scan_done;
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
@@ -1530,7 +1762,7 @@ next_field:
 
                         } else {
                             s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
+                            if (decode_block(s, &s->gb, s->last_dc, s->block, i,
                                              s->dc_index[i], s->ac_index[i],
                                              s->quant_matrixes[s->quant_sindex[i]]) < 0) {
                                 av_log(s->avctx, AV_LOG_ERROR,
@@ -1571,6 +1803,7 @@ next_field:
         }
     }
 
+scan_done:
     if (s->interlaced &&
         bytestream2_get_bytes_left(&s->gB) > 2 &&
         bytestream2_tell(&s->gB) > 2 &&
@@ -2912,6 +3145,12 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_frame_free(&s->smv_frame);
 
     av_freep(&s->buffer);
+    for (i = 0; i < s->nb_slice_ctx; i++)
+        av_freep(&s->slice_ctx[i].buffer);
+    av_freep(&s->slice_ctx);
+    s->nb_slice_ctx = 0;
+    av_freep(&s->restart_segments);
+    s->restart_segments_size = 0;
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
@@ -2973,7 +3212,7 @@ const FFCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     FF_CODEC_DECODE_CB(ff_mjpeg_decode_frame),
     .flush          = decode_flush,
-    .p.capabilities = AV_CODEC_CAP_DR1,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS,
     .p.max_lowres   = 3,
     .p.priv_class   = &mjpegdec_class,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_mjpeg_profiles),
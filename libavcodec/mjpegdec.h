@@ -53,6 +53,23 @@ typedef struct ICCEntry {
 
 struct JLSState;
 
+/**
+ * Per-thread state for decoding restart intervals in parallel.
+ */
+typedef struct MJpegSliceContext {
+    GetBitContext gb;
+    int last_dc[MAX_COMPONENTS];
+    uint8_t *buffer;            ///< unescaped entropy coded data
+    unsigned int buffer_size;
+    int ret;                    ///< first error of the jobs run by this thread
+    DECLARE_ALIGNED(32, int16_t, block)[64];
+} MJpegSliceContext;
+
+typedef struct MJpegRestartSegment {
+    const uint8_t *data;        ///< escaped entropy coded data of one restart interval
+    int size;
+} MJpegRestartSegment;
+
 typedef struct MJpegDecodeContext {
     AVClass *class;
     AVCodecContext *avctx;
@@ -133,6 +150,11 @@ typedef struct MJpegDecodeContext {
     int restart_interval;
     int restart_count;
 
+    MJpegSliceContext *slice_ctx;
+    int nb_slice_ctx;
+    MJpegRestartSegment *restart_segments;
+    unsigned int restart_segments_size;
+
     int cs_itu601;
     int interlace_polarity;
     int multiscope;
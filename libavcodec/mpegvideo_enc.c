@@ -1055,6 +1055,19 @@ av_cold int ff_mpv_encode_init(AVCodecContext *avctx)
     if (ret < 0)
         return ret;
 
+    /* With -slices, the slice contexts do not depend on the number of
+     * threads, and each one estimates the motion of its own slice. */
+    if (s->c.slice_context_count > 1 && !avctx->slices) {
+        m->me_row_progress = av_calloc(s->c.mb_height, sizeof(*m->me_row_progress));
+        if (!m->me_row_progress)
+            return AVERROR(ENOMEM);
+        for (int i = 0; i < s->c.mb_height; i++) {
+            ret = ff_thread_progress_init(&m->me_row_progress[i], 1);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
     ret = ff_rate_control_init(m);
     if (ret < 0)
         return ret;
@@ -1093,6 +1106,12 @@ av_cold int ff_mpv_encode_end(AVCodecContext *avctx)
 
     ff_rate_control_uninit(&m->rc_context);
 
+    if (m->me_row_progress) {
+        for (int i = 0; i < s->c.mb_height; i++)
+            ff_thread_progress_destroy(&m->me_row_progress[i]);
+        av_freep(&m->me_row_progress);
+    }
+
     ff_mpv_common_end(&s->c);
     av_refstruct_pool_uninit(&s->c.picture_pool);
 
@@ -2786,28 +2805,93 @@ static int sse_mb(MPVEncContext *const s)
                     s->c.dest[2], w >> s->c.chroma_x_shift, h >> s->c.chroma_y_shift, s->c.uvlinesize);
 }
 
-static int pre_estimate_motion_thread(AVCodecContext *c, void *arg){
-    MPVEncContext *const s = *(void**)arg;
+/**
+ * Hand out the MB rows of the picture to the calling slice context until
+ * all are done. The rows are started in order and each MB waits until the
+ * neighbours of the previous row it takes predictors from are done, so the
+ * result is the same as for a single context spanning the whole picture.
+ * The pre-pass runs bottom-up and right to left.
+ */
+static void estimate_motion_rows(MPVMainEncContext *const m,
+                                 MPVEncContext *const s, int pre_pass)
+{
+    const int mb_width = s->c.mb_width, mb_height = s->c.mb_height;
+    const int end_mb_y = s->c.end_mb_y;
+    int row;
+
+    /* Allow the predictors from the row below the slice. */
+    s->c.end_mb_y = mb_height;
+    while ((row = atomic_fetch_add_explicit(&m->me_next_row, 1,
+                                            memory_order_relaxed)) < mb_height) {
+        ThreadProgress *const progress = &m->me_row_progress[row];
+
+        s->c.first_slice_line = !row;
+        s->c.mb_y = pre_pass ? mb_height - 1 - row : row;
+        if (!pre_pass) {
+            s->c.mb_x = 0; //for block init below
+            ff_init_block_index(&s->c);
+        }
+        for (int i = 0; i < mb_width; i++) {
+            if (row)
+                ff_thread_progress_await(&m->me_row_progress[row - 1],
+                                         FFMIN(i + 2, mb_width));
+            if (pre_pass) {
+                s->c.mb_x = mb_width - 1 - i;
+                ff_pre_estimate_p_frame_motion(s, s->c.mb_x, s->c.mb_y);
+            } else {
+                s->c.mb_x = i;
+                s->c.block_index[0] += 2;
+                s->c.block_index[1] += 2;
+                s->c.block_index[2] += 2;
+                s->c.block_index[3] += 2;
+
+                /* compute motion vector & mb_type and store in context */
+                if (s->c.pict_type == AV_PICTURE_TYPE_B)
+                    ff_estimate_b_frame_motion(s, s->c.mb_x, s->c.mb_y);
+                else
+                    ff_estimate_p_frame_motion(s, s->c.mb_x, s->c.mb_y);
+            }
+            ff_thread_progress_report(progress, i + 1);
+        }
+    }
+    s->c.end_mb_y = end_mb_y;
+}
 
+static int pre_estimate_motion_thread(AVCodecContext *c, void *arg,
+                                      int jobnr, int threadnr)
+{
+    MPVMainEncContext *const m = arg;
+    MPVEncContext *const s = m->s.c.enc_contexts[jobnr];
 
     s->me.pre_pass = 1;
     s->me.dia_size = s->c.avctx->pre_dia_size;
-    s->c.first_slice_line = 1;
-    for (s->c.mb_y = s->c.end_mb_y - 1; s->c.mb_y >= s->c.start_mb_y; s->c.mb_y--) {
-        for (s->c.mb_x = s->c.mb_width - 1; s->c.mb_x >=0 ; s->c.mb_x--)
-            ff_pre_estimate_p_frame_motion(s, s->c.mb_x, s->c.mb_y);
-        s->c.first_slice_line = 0;
+    if (m->me_row_progress) {
+        estimate_motion_rows(m, s, 1);
+    } else {
+        s->c.first_slice_line = 1;
+        for (s->c.mb_y = s->c.end_mb_y - 1; s->c.mb_y >= s->c.start_mb_y; s->c.mb_y--) {
+            for (s->c.mb_x = s->c.mb_width - 1; s->c.mb_x >=0 ; s->c.mb_x--)
+                ff_pre_estimate_p_frame_motion(s, s->c.mb_x, s->c.mb_y);
+            s->c.first_slice_line = 0;
+        }
     }
-
     s->me.pre_pass = 0;
 
     return 0;
 }
 
-static int estimate_motion_thread(AVCodecContext *c, void *arg){
-    MPVEncContext *const s = *(void**)arg;
+static int estimate_motion_thread(AVCodecContext *c, void *arg,
+                                  int jobnr, int threadnr)
+{
+    MPVMainEncContext *const m = arg;
+    MPVEncContext *const s = m->s.c.enc_contexts[jobnr];
 
     s->me.dia_size = s->c.avctx->dia_size;
+    if (m->me_row_progress) {
+        estimate_motion_rows(m, s, 0);
+        return 0;
+    }
+
     s->c.first_slice_line = 1;
     for (s->c.mb_y = s->c.start_mb_y; s->c.mb_y < s->c.end_mb_y; s->c.mb_y++) {
         s->c.mb_x = 0; //for block init below
@@ -2829,6 +2913,29 @@ static int estimate_motion_thread(AVCodecContext *c, void *arg){
     return 0;
 }
 
+/**
+ * Run one motion estimation pass over the whole picture.
+ */
+static void estimate_motion(MPVMainEncContext *const m, int context_count,
+                            int (*func)(AVCodecContext *c, void *arg,
+                                        int jobnr, int threadnr))
+{
+    MPVEncContext *const s = &m->s;
+
+    if (m->me_row_progress) {
+        for (int i = 0; i < s->c.mb_height; i++)
+            ff_thread_progress_reset(&m->me_row_progress[i]);
+        atomic_store_explicit(&m->me_next_row, 0, memory_order_relaxed);
+
+        /* The last predictors are taken from a square around the MB which
+         * is not covered by the row dependencies. */
+        if (s->c.avctx->last_predictor_count)
+            context_count = 1;
+    }
+
+    s->c.avctx->execute2(s->c.avctx, func, m, NULL, context_count);
+}
+
 static int mb_var_thread(AVCodecContext *c, void *arg){
     MPVEncContext *const s = *(void**)arg;
 
@@ -3730,17 +3837,19 @@ static int encode_picture(MPVMainEncContext *const m, const AVPacket *pkt)
     if (s->c.pict_type != AV_PICTURE_TYPE_I) {
         s->lambda  = (s->lambda  * m->me_penalty_compensation + 128) >> 8;
         s->lambda2 = (s->lambda2 * (int64_t) m->me_penalty_compensation + 128) >> 8;
+        /* Any context may estimate any row, so they all need the same lambda. */
+        for (int i = 1; m->me_row_progress && i < context_count; i++) {
+            s->c.enc_contexts[i]->lambda  = s->lambda;
+            s->c.enc_contexts[i]->lambda2 = s->lambda2;
+        }
         if (s->c.pict_type != AV_PICTURE_TYPE_B) {
             if ((m->me_pre && m->last_non_b_pict_type == AV_PICTURE_TYPE_I) ||
                 m->me_pre == 2) {
-                s->c.avctx->execute(s->c.avctx, pre_estimate_motion_thread,
-                                    &s->c.enc_contexts[0], NULL,
-                                    context_count, sizeof(void*));
+                estimate_motion(m, context_count, pre_estimate_motion_thread);
             }
         }
 
-        s->c.avctx->execute(s->c.avctx, estimate_motion_thread, &s->c.enc_contexts[0],
-                            NULL, context_count, sizeof(void*));
+        estimate_motion(m, context_count, estimate_motion_thread);
     }else /* if (s->c.pict_type == AV_PICTURE_TYPE_I) */{
         /* I-Frame */
         for (int i = 0; i < s->c.mb_stride * s->c.mb_height; i++)
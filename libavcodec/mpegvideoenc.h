@@ -29,6 +29,7 @@
 #define AVCODEC_MPEGVIDEOENC_H
 
 #include <float.h>
+#include <stdatomic.h>
 
 #include "libavutil/avassert.h"
 #include "libavutil/mem_internal.h"
@@ -40,6 +41,7 @@
 #include "pixblockdsp.h"
 #include "put_bits.h"
 #include "ratecontrol.h"
+#include "threadprogress.h"
 
 #define MPVENC_MAX_B_FRAMES 16
 
@@ -266,6 +268,15 @@ typedef struct MPVMainEncContext {
     int me_penalty_compensation;
     int me_pre;                          ///< prepass for motion estimation
 
+    /**
+     * Unless the slices are set by the user, motion estimation is done over
+     * the whole picture as a wavefront of MB rows instead of per slice
+     * context, so that the motion vectors do not depend on the number of
+     * threads. NULL when motion is estimated per slice context.
+     */
+    ThreadProgress *me_row_progress; ///< number of MBs of each row done in the current ME pass
+    atomic_int me_next_row;        ///< next row of the current ME pass to be handed out
+
     int64_t mb_var_sum;            ///< sum of MB variance for current frame
     int64_t mc_mb_var_sum;         ///< motion compensated MB variance for current frame
 
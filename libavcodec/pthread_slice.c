@@ -122,6 +122,9 @@ av_cold int ff_slice_thread_init(AVCodecContext *avctx)
         int nb_cpus = av_cpu_count();
         if  (avctx->height)
             nb_cpus = FFMIN(nb_cpus, (avctx->height+15)/16);
+        // audio codecs split their work by channel at most
+        else if (avctx->codec_type == AVMEDIA_TYPE_AUDIO && avctx->ch_layout.nb_channels)
+            nb_cpus = FFMIN(nb_cpus, avctx->ch_layout.nb_channels);
         // use number of cores + 1 as thread count if there is more than one
         if (nb_cpus > 1)
             thread_count = avctx->thread_count = FFMIN(nb_cpus + 1, MAX_AUTO_THREADS);
@@ -46,6 +46,35 @@ static av_cold int raw_encode_init(AVCodecContext *avctx)
     return 0;
 }
 
+/**
+ * Check whether the frame data is already laid out exactly as it would be
+ * stored in the packet, including the padding, so it can be referenced.
+ */
+static int frame_is_packed(const AVFrame *frame, int size)
+{
+    uint8_t *data[4];
+    int linesize[4];
+
+    if (!frame->buf[0] || frame->buf[1] ||
+        frame->data[0] < frame->buf[0]->data ||
+        frame->buf[0]->data + frame->buf[0]->size - frame->data[0] <
+            (ptrdiff_t)size + AV_INPUT_BUFFER_PADDING_SIZE)
+        return 0;
+
+    if (av_image_fill_arrays(data, linesize, frame->data[0], frame->format,
+                             frame->width, frame->height, 1) < 0)
+        return 0;
+
+    for (int i = 0; i < 4; i++) {
+        if (!data[i])
+            break;
+        if (data[i] != frame->data[i] || linesize[i] != frame->linesize[i])
+            return 0;
+    }
+
+    return 1;
+}
+
 static int raw_encode(AVCodecContext *avctx, AVPacket *pkt,
                       const AVFrame *frame, int *got_packet)
 {
@@ -55,6 +84,21 @@ static int raw_encode(AVCodecContext *avctx, AVPacket *pkt,
     if (ret < 0)
         return ret;
 
+    /* Reference the frame instead of copying it, unless the data has to be
+     * modified or the caller wants to provide its own packet buffers. */
+    if (avctx->codec_tag != AV_RL32("yuv2") &&
+        avctx->codec_tag != AV_RL32("b64a") &&
+        avctx->get_encode_buffer == avcodec_default_get_encode_buffer &&
+        frame_is_packed(frame, ret)) {
+        pkt->buf = av_buffer_ref(frame->buf[0]);
+        if (!pkt->buf)
+            return AVERROR(ENOMEM);
+        pkt->data = frame->data[0];
+        pkt->size = ret;
+        *got_packet = 1;
+        return 0;
+    }
+
     if ((ret = ff_get_encode_buffer(avctx, pkt, ret, 0)) < 0)
         return ret;
     if ((ret = av_image_copy_to_buffer(pkt->data, pkt->size,
@@ -87,7 +131,8 @@ const FFCodec ff_rawvideo_encoder = {
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_RAWVIDEO,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
-                      AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE,
+                      AV_CODEC_CAP_ENCODER_REORDERED_OPAQUE |
+                      AV_CODEC_CAP_ENCODER_PACKED_FRAMES,
     .init           = raw_encode_init,
     FF_CODEC_ENCODE_CB(raw_encode),
 };
@@ -136,22 +136,33 @@ static void init_cabac_encoder(CABACTestContext *c, uint8_t *buf, int buf_size)
     c->pb.bit_left++; //avoids firstBitFlag
 }
 
+#define NB_RUNS    1024
+#define UNARY_MAX  23
+
 int main(void){
     CABACTestContext c;
-    uint8_t b[9*SIZE];
+    uint8_t b[9*SIZE + 8*NB_RUNS];
     uint8_t r[9*SIZE];
+    uint8_t unary[NB_RUNS], nb_bits[NB_RUNS];
+    int bits[NB_RUNS];
     int i, ret = 0;
     uint8_t state[10]= {0};
     AVLFG prng;
 
     av_lfg_init(&prng, 1);
-    init_cabac_encoder(&c, b, SIZE);
+    init_cabac_encoder(&c, b, sizeof(b));
 
     for(i=0; i<SIZE; i++){
         if(2*i<SIZE) r[i] = av_lfg_get(&prng) % 7;
         else         r[i] = (i>>8)&1;
     }
 
+    for (i = 0; i < NB_RUNS; i++) {
+        unary[i]   = av_lfg_get(&prng) % (UNARY_MAX + 1);
+        nb_bits[i] = av_lfg_get(&prng) % 17;
+        bits[i]    = av_lfg_get(&prng) & ((1 << nb_bits[i]) - 1);
+    }
+
     for(i=0; i<SIZE; i++){
         put_cabac_bypass(&c, r[i]&1);
     }
@@ -160,11 +171,22 @@ int main(void){
         put_cabac(&c, state, r[i]&1);
     }
 
+    /* runs of bypass bins between context coded bins, as in residual coding */
+    for (i = 0; i < NB_RUNS; i++) {
+        put_cabac(&c, state + 1, r[i] & 1);
+        for (int j = 0; j < unary[i]; j++)
+            put_cabac_bypass(&c, 1);
+        if (unary[i] < UNARY_MAX)
+            put_cabac_bypass(&c, 0);
+        for (int j = nb_bits[i] - 1; j >= 0; j--)
+            put_cabac_bypass(&c, (bits[i] >> j) & 1);
+    }
+
     i= put_cabac_terminate(&c, 1);
     b[i++] = av_lfg_get(&prng);
     b[i  ] = av_lfg_get(&prng);
 
-    ff_init_cabac_decoder(&c.dec, b, SIZE);
+    ff_init_cabac_decoder(&c.dec, b, sizeof(b));
 
     memset(state, 0, sizeof(state));
 
@@ -181,6 +203,22 @@ int main(void){
             ret = 1;
         }
     }
+
+    for (i = 0; i < NB_RUNS; i++) {
+        int u, v;
+
+        if ((r[i] & 1) != get_cabac_noinline(&c.dec, state + 1)) {
+            av_log(NULL, AV_LOG_ERROR, "CABAC failure in run %d\n", i);
+            ret = 1;
+        }
+        u = get_cabac_bypass_unary(&c.dec, UNARY_MAX);
+        v = get_cabac_bypass_bits(&c.dec, nb_bits[i]);
+        if (u != unary[i] || v != bits[i]) {
+            av_log(NULL, AV_LOG_ERROR, "CABAC bypass run failure at %d: "
+                   "%d/%d bits %d/%d\n", i, u, unary[i], v, bits[i]);
+            ret = 1;
+        }
+    }
     if (!get_cabac_terminate(&c.dec)) {
         av_log(NULL, AV_LOG_ERROR, "where's the Terminator?\n");
         ret = 1;
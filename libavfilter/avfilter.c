@@ -623,7 +623,10 @@ int avfilter_process_command(AVFilterContext *filter, const char *cmd, const cha
     }else if(!strcmp(cmd, "enable")) {
         return set_enable_expr(fffilterctx(filter), arg);
     }else if (fffilter(filter->filter)->process_command) {
-        return fffilter(filter->filter)->process_command(filter, cmd, arg, res, res_len, flags);
+        int ret = fffilter(filter->filter)->process_command(filter, cmd, arg, res, res_len, flags);
+        if (HAVE_THREADS && ret >= 0 && filter->thread_type == AVFILTER_THREAD_FRAME)
+            ret = ff_filter_frame_thread_process_command(filter, cmd, arg, flags);
+        return ret;
     }
     return AVERROR(ENOSYS);
 }
@@ -663,8 +666,9 @@ static const AVClass *filter_child_class_iterate(void **iter)
 #define TFLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_RUNTIME_PARAM
 static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, .unit = "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME }, 0, INT_MAX, FLAGS, .unit = "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = FLAGS, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = TFLAGS },
     { "threads", "Allowed number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, FLAGS, .unit = "threads" },
@@ -806,6 +810,9 @@ void avfilter_free(AVFilterContext *filter)
         return;
     ctxi = fffilterctx(filter);
 
+    if (HAVE_THREADS)
+        ff_filter_frame_thread_free(filter);
+
     if (filter->graph)
         ff_filter_graph_remove_filter(filter->graph, filter);
 
@@ -932,7 +939,13 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         return ret;
     }
 
-    if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
+    if (fffilter(ctx->filter)->flags_internal & FF_FILTER_FLAG_FRAME_THREADS &&
+        ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_FRAME &&
+        fffiltergraph(ctx->graph)->thread && ff_filter_get_nb_threads(ctx) > 1) {
+        av_assert1(ctx->nb_inputs == 1 && ctx->nb_outputs == 1 &&
+                   !fffilter(ctx->filter)->activate);
+        ctx->thread_type = AVFILTER_THREAD_FRAME;
+    } else if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
         ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
         fffiltergraph(ctx->graph)->thread_execute) {
         ctx->thread_type       = AVFILTER_THREAD_SLICE;
@@ -1110,8 +1123,9 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
     filter_unblock(link->dst);
     ret = ff_framequeue_add(&li->fifo, frame);
     if (ret < 0) {
-        const FFFrameQueueGlobal *global = li->fifo.global;
-        if (ret == AVERROR(ENOMEM) && global->queued >= global->max_queued)
+        FFFrameQueueGlobal *global = li->fifo.global;
+        if (ret == AVERROR(ENOMEM) &&
+            atomic_load_explicit(&global->queued, memory_order_relaxed) >= global->max_queued)
             av_log(link->dst, AV_LOG_ERROR, "Exhausted frame queue capacity (%zu frames)\n", global->max_queued);
         av_frame_free(&frame);
         return ret;
@@ -1458,7 +1472,10 @@ int ff_filter_activate(AVFilterContext *filter)
     av_assert1(!(fi->p.flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  fi->activate));
     ctxi->ready = 0;
-    ret = fi->activate ? fi->activate(filter) : filter_activate_default(filter);
+    if (HAVE_THREADS && filter->thread_type == AVFILTER_THREAD_FRAME)
+        ret = ff_filter_frame_thread_activate(filter);
+    else
+        ret = fi->activate ? fi->activate(filter) : filter_activate_default(filter);
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
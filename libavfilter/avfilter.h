@@ -269,6 +269,28 @@ unsigned avfilter_filter_pad_count(const AVFilter *filter, int is_output);
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
 
+/**
+ * Activate filters of the graph that share neither a link nor a neighbouring
+ * filter concurrently, so that a chain or the branches of a graph are
+ * processed in a pipelined way.
+ *
+ * Filters which send commands to other filters while processing, like sendcmd
+ * and zmq, are activated alone.
+ *
+ * Only meaningful in AVFilterGraph.thread_type. The frames output by each
+ * sink and their order are not affected.
+ */
+#define AVFILTER_THREAD_PIPELINE (1 << 1)
+
+/**
+ * Filter several consecutive frames concurrently, each with its own instance
+ * of the filter. Only used by some filters that have no state carried from
+ * one frame to the next; it adds one frame of delay per thread and takes
+ * precedence over AVFILTER_THREAD_SLICE. Ignored when a custom execute
+ * callback is used.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 2)
+
 /** An instance of a filter */
 typedef struct AVFilterContext {
     const AVClass *av_class;        ///< needed for av_log() and filters common options
@@ -570,7 +592,10 @@ typedef struct AVFilterGraph {
      * of AVFILTER_THREAD_* flags.
      *
      * May be set by the caller at any point, the setting will apply to all
-     * filters initialized after that. The default is allowing everything.
+     * filters initialized after that. The default is allowing everything but
+     * AVFILTER_THREAD_FRAME and AVFILTER_THREAD_PIPELINE. The latter must be
+     * set before adding any filters to the graph to take effect and is ignored
+     * when a custom execute callback is used.
      *
      * When a filter in this graph is initialized, this field is combined using
      * bit AND with AVFilterContext.thread_type to get the final mask used for
@@ -27,6 +27,8 @@
 
 #include <stdint.h>
 
+#include "libavutil/thread.h"
+
 #include "avfilter.h"
 #include "filters.h"
 #include "framepool.h"
@@ -120,6 +122,12 @@ typedef struct FFFilterContext {
     double *var_values;
 
     struct AVFilterCommand *command_queue;
+
+    /**
+     * Clones of the filter and their threads, set up on the first activation
+     * when AVFILTER_THREAD_FRAME is in use.
+     */
+    struct FrameThreadContext *frame_thread;
 } FFFilterContext;
 
 static inline FFFilterContext *fffilterctx(AVFilterContext *ctx)
@@ -149,6 +157,21 @@ typedef struct FFFilterGraph {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Activate the filters in pipeline[0..nb_filters-1] concurrently and
+     * store their return values in pipeline_ret. Set when
+     * AVFILTER_THREAD_PIPELINE is in use.
+     */
+    void (*thread_activate)(struct FFFilterGraph *graph, int nb_filters);
+    AVFilterContext **pipeline;
+    int *pipeline_ret;
+
+    /**
+     * Set while thread_activate() runs. Slice jobs of the filters activated
+     * concurrently are then serialized.
+     */
+    int activating;
 } FFFilterGraph;
 
 static inline FFFilterGraph *fffiltergraph(AVFilterGraph *graph)
@@ -196,6 +219,20 @@ int ff_graph_thread_init(FFFilterGraph *graph);
 
 void ff_graph_thread_free(FFFilterGraph *graph);
 
+/**
+ * Activate a filter using AVFILTER_THREAD_FRAME, in place of its regular
+ * input processing.
+ */
+int ff_filter_frame_thread_activate(AVFilterContext *ctx);
+
+/**
+ * Apply a command, already processed by the filter itself, to its clones.
+ */
+int ff_filter_frame_thread_process_command(AVFilterContext *ctx, const char *cmd,
+                                           const char *arg, int flags);
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx);
+
 /**
  * Negotiate the media format, dimensions, etc of all inputs to a filter.
  *
@@ -49,6 +49,8 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, .unit = "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "pipeline", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_PIPELINE }, .flags = F|V|A, .unit = "thread_type" },
+        { "frame",    NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME    }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, F|V|A, .unit = "threads"},
         {"auto", "autodetect a suitable number of threads to use", 0, AV_OPT_TYPE_CONST, {.i64 = 0 }, .flags = F|V|A, .unit = "threads"},
@@ -1613,8 +1615,105 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+static int filters_linked(const AVFilterContext *a, const AVFilterContext *b)
+{
+    for (unsigned i = 0; i < a->nb_inputs; i++)
+        if (a->inputs[i]->src == b)
+            return 1;
+    for (unsigned i = 0; i < a->nb_outputs; i++)
+        if (a->outputs[i]->dst == b)
+            return 1;
+    return 0;
+}
+
+/*
+ * Whether the filters share a link or a neighbour. Activating a filter
+ * updates the state of its neighbours and of their links, e.g. the ready
+ * field and frame_blocked_in, so such filters cannot be activated at once.
+ */
+static int filters_near(const AVFilterContext *a, const AVFilterContext *b)
+{
+    if (filters_linked(a, b))
+        return 1;
+    for (unsigned i = 0; i < a->nb_inputs; i++)
+        if (filters_linked(a->inputs[i]->src, b))
+            return 1;
+    for (unsigned i = 0; i < a->nb_outputs; i++)
+        if (filters_linked(a->outputs[i]->dst, b))
+            return 1;
+    return 0;
+}
+
+/* Whether activating the filter may update the sink links age heap. */
+static int filter_updates_heap(AVFilterContext *filter)
+{
+    for (unsigned i = 0; i < filter->nb_inputs; i++)
+        if (ff_link_internal(filter->inputs[i])->age_index >= 0)
+            return 1;
+    for (unsigned i = 0; i < filter->nb_outputs; i++)
+        if (ff_link_internal(filter->outputs[i])->age_index >= 0)
+            return 1;
+    return 0;
+}
+
+/**
+ * Activate the most urgent filter together with other ready filters that
+ * share neither a link nor a neighbour with it or with each other. Each link
+ * and each filter's state is then only accessed by one of the activated
+ * filters, so the frames they exchange do not depend on the order the
+ * activations happen in. Filters which send commands to other filters are
+ * always activated alone.
+ */
+static int graph_run_pipeline(FFFilterGraph *graphi, AVFilterContext *first)
+{
+    AVFilterGraph *graph = &graphi->p;
+    int heap = filter_updates_heap(first);
+    int nb = 1, ret;
+
+    if (fffilter(first->filter)->flags_internal & FF_FILTER_FLAG_SENDS_COMMANDS)
+        return ff_filter_activate(first);
+
+    graphi->pipeline[0] = first;
+    for (unsigned i = 0; i < graph->nb_filters && nb < graph->nb_threads; i++) {
+        AVFilterContext *filter = graph->filters[i];
+        int j;
+
+        if (!fffilterctx(filter)->ready || filter == first ||
+            fffilter(filter->filter)->flags_internal & FF_FILTER_FLAG_SENDS_COMMANDS)
+            continue;
+        for (j = 0; j < nb; j++)
+            if (filters_near(filter, graphi->pipeline[j]))
+                break;
+        if (j < nb)
+            continue;
+        if (filter_updates_heap(filter)) {
+            if (heap)
+                continue;
+            heap = 1;
+        }
+        graphi->pipeline[nb++] = filter;
+    }
+
+    if (nb == 1)
+        return ff_filter_activate(first);
+
+    graphi->thread_activate(graphi, nb);
+
+    ret = graphi->pipeline_ret[0];
+    for (int j = 0; j < nb; j++) {
+        int r = graphi->pipeline_ret[j];
+
+        if (r < 0 && r != FFERROR_BUFFERSRC_EMPTY)
+            return r;
+        if (r == FFERROR_BUFFERSRC_EMPTY)
+            ret = r;
+    }
+    return ret;
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
+    FFFilterGraph *graphi = fffiltergraph(graph);
     FFFilterContext *ctxi;
     unsigned i;
 
@@ -1629,5 +1728,7 @@ int ff_filter_graph_run_once(AVFilterGraph *graph)
 
     if (!ctxi->ready)
         return AVERROR(EAGAIN);
+    if (graphi->thread_activate)
+        return graph_run_pipeline(graphi, &ctxi->p);
     return ff_filter_activate(&ctxi->p);
 }
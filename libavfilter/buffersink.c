@@ -58,6 +58,8 @@ typedef struct BufferSinkContext {
     int                *alphamodes;
     unsigned         nb_alphamodes;
 
+    int packed_frames;
+
     /* only used for audio */
     enum AVSampleFormat *sample_formats;
     unsigned          nb_sample_formats;
@@ -349,6 +351,14 @@ static int asink_query_formats(const AVFilterContext *ctx,
     return 0;
 }
 
+static AVFrame *get_video_buffer(AVFilterLink *inlink, int w, int h)
+{
+    BufferSinkContext *buf = inlink->dst->priv;
+
+    /* NULL makes the caller fall back to the default allocator */
+    return buf->packed_frames ? ff_get_packed_video_buffer(inlink, w, h) : NULL;
+}
+
 #define OFFSET(x) offsetof(BufferSinkContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM|AV_OPT_FLAG_VIDEO_PARAM
 static const AVOption buffersink_options[] = {
@@ -360,6 +370,8 @@ static const AVOption buffersink_options[] = {
         AV_OPT_TYPE_INT | AV_OPT_TYPE_FLAG_ARRAY, .max = INT_MAX, .flags = FLAGS },
     { "alphamodes",     "array of supported color ranges",  OFFSET(alphamodes),
         AV_OPT_TYPE_INT | AV_OPT_TYPE_FLAG_ARRAY, .max = INT_MAX, .flags = FLAGS },
+    { "packed_frames",  "allocate frames with all planes in one contiguous buffer",
+        OFFSET(packed_frames), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
 
     { NULL },
 };
@@ -379,6 +391,14 @@ static const AVOption abuffersink_options[] = {
 AVFILTER_DEFINE_CLASS(buffersink);
 AVFILTER_DEFINE_CLASS(abuffersink);
 
+static const AVFilterPad inputs_video[] = {
+    {
+        .name             = "default",
+        .type             = AVMEDIA_TYPE_VIDEO,
+        .get_buffer.video = get_video_buffer,
+    },
+};
+
 const FFFilter ff_vsink_buffer = {
     .p.name        = "buffersink",
     .p.description = NULL_IF_CONFIG_SMALL("Buffer video frames, and make them available to the end of the filter graph."),
@@ -388,7 +408,7 @@ const FFFilter ff_vsink_buffer = {
     .init          = init_video,
     .uninit        = uninit,
     .activate      = activate,
-    FILTER_INPUTS(ff_video_default_filterpad),
+    FILTER_INPUTS(inputs_video),
     FILTER_QUERY_FUNC2(vsink_query_formats),
 };
 
@@ -608,6 +608,7 @@ const FFFilter ff_vf_sendcmd = {
     .init        = init,
     .uninit      = uninit,
     .priv_size   = sizeof(SendCmdContext),
+    .flags_internal = FF_FILTER_FLAG_SENDS_COMMANDS,
     FILTER_INPUTS(sendcmd_inputs),
     FILTER_OUTPUTS(ff_video_default_filterpad),
 };
@@ -632,6 +633,7 @@ const FFFilter ff_af_asendcmd = {
     .init        = init,
     .uninit      = uninit,
     .priv_size   = sizeof(SendCmdContext),
+    .flags_internal = FF_FILTER_FLAG_SENDS_COMMANDS,
     FILTER_INPUTS(asendcmd_inputs),
     FILTER_OUTPUTS(ff_audio_default_filterpad),
 };
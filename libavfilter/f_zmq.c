@@ -224,6 +224,7 @@ const FFFilter ff_vf_zmq = {
     .init        = init,
     .uninit      = uninit,
     .priv_size   = sizeof(ZMQContext),
+    .flags_internal = FF_FILTER_FLAG_SENDS_COMMANDS,
     FILTER_INPUTS(zmq_inputs),
     FILTER_OUTPUTS(ff_video_default_filterpad),
 };
@@ -247,6 +248,7 @@ const FFFilter ff_af_azmq = {
     .init        = init,
     .uninit      = uninit,
     .priv_size   = sizeof(ZMQContext),
+    .flags_internal = FF_FILTER_FLAG_SENDS_COMMANDS,
     FILTER_INPUTS(azmq_inputs),
     FILTER_OUTPUTS(ff_audio_default_filterpad),
 };
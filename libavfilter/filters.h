@@ -207,6 +207,21 @@ static inline FilterLink* ff_filter_link(AVFilterLink *link)
  */
 #define FF_FILTER_FLAG_HWFRAME_AWARE (1 << 0)
 
+/**
+ * The filter has exactly one input and one output, no activate callback, and
+ * the output of its filter_frame() callback only depends on the input frame
+ * and on the options. Several instances of it can then filter consecutive
+ * frames concurrently, see AVFILTER_THREAD_FRAME.
+ */
+#define FF_FILTER_FLAG_FRAME_THREADS (1 << 1)
+
+/**
+ * The filter sends commands to other filters of the graph while it is
+ * activated. It is then never activated concurrently with other filters, see
+ * AVFILTER_THREAD_PIPELINE.
+ */
+#define FF_FILTER_FLAG_SENDS_COMMANDS (1 << 2)
+
 /**
  * Find the index of a link.
  *
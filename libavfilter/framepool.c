@@ -19,6 +19,7 @@
  */
 
 #include "framepool.h"
+#include "libavcodec/defs.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avutil.h"
 #include "libavutil/buffer.h"
@@ -30,7 +31,8 @@
 
 static av_cold int frame_pool_video_init(int width, int height,
                                          enum AVPixelFormat format,
-                                         int align, FFFramePool *pool)
+                                         int align, unsigned flags,
+                                         FFFramePool *pool)
 {
     int ret;
 
@@ -40,13 +42,16 @@ static av_cold int frame_pool_video_init(int width, int height,
         .height = height,
         .pix_fmt = format,
         .align = align,
+        .flags = flags,
     };
 
     if ((ret = av_image_check_size2(width, height, INT64_MAX, format, 0, NULL)) < 0)
         goto fail;
 
     ret = av_image_fill_linesizes(pool->linesize, pool->pix_fmt,
-                                  FFALIGN(pool->width, align));
+                                  flags & FF_FRAME_POOL_FLAG_PACKED
+                                      ? pool->width
+                                      : FFALIGN(pool->width, align));
     if (ret < 0)
         goto fail;
 
@@ -59,11 +64,33 @@ static av_cold int frame_pool_video_init(int width, int height,
 
     size_t sizes[4];
     ret = av_image_fill_plane_sizes(sizes, pool->pix_fmt,
-                                    FFALIGN(pool->height, align),
+                                    flags & FF_FRAME_POOL_FLAG_PACKED
+                                        ? pool->height
+                                        : FFALIGN(pool->height, align),
                                     linesizes);
     if (ret < 0)
         goto fail;
 
+    if (flags & FF_FRAME_POOL_FLAG_PACKED) {
+        /* One buffer holding all planes; the padding must be zeroed */
+        size_t total_size = align + AV_INPUT_BUFFER_PADDING_SIZE;
+        for (int i = 0; i < 4; i++) {
+            if (sizes[i] > SIZE_MAX - total_size) {
+                ret = AVERROR(EINVAL);
+                goto fail;
+            }
+            total_size += sizes[i];
+        }
+
+        pool->pools[0] = av_buffer_pool_init(total_size, av_buffer_allocz);
+        if (!pool->pools[0]) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+
+        return 0;
+    }
+
     for (int i = 0; i < 4 && sizes[i]; i++) {
         if (sizes[i] > SIZE_MAX - align)
             goto fail;
@@ -143,16 +170,28 @@ AVFrame *ff_frame_pool_get(FFFramePool *pool)
         frame->height = pool->height;
         frame->format = pool->pix_fmt;
 
-        for (int i = 0; i < 4; i++) {
-            frame->linesize[i] = pool->linesize[i];
-            if (!pool->pools[i])
-                break;
+        if (pool->flags & FF_FRAME_POOL_FLAG_PACKED) {
+            memcpy(frame->linesize, pool->linesize, sizeof(pool->linesize));
+            frame->buf[0] = av_buffer_pool_get(pool->pools[0]);
+            if (!frame->buf[0])
+                goto fail;
 
-            frame->buf[i] = av_buffer_pool_get(pool->pools[i]);
-            if (!frame->buf[i])
+            if (av_image_fill_pointers(frame->data, pool->pix_fmt, pool->height,
+                                       (uint8_t *)FFALIGN((uintptr_t)frame->buf[0]->data, pool->align),
+                                       frame->linesize) < 0)
                 goto fail;
+        } else {
+            for (int i = 0; i < 4; i++) {
+                frame->linesize[i] = pool->linesize[i];
+                if (!pool->pools[i])
+                    break;
 
-            frame->data[i] = (uint8_t *)FFALIGN((uintptr_t)frame->buf[i]->data, pool->align);
+                frame->buf[i] = av_buffer_pool_get(pool->pools[i]);
+                if (!frame->buf[i])
+                    goto fail;
+
+                frame->data[i] = (uint8_t *)FFALIGN((uintptr_t)frame->buf[i]->data, pool->align);
+            }
         }
 
         if (desc->flags & AV_PIX_FMT_FLAG_PAL) {
@@ -224,12 +263,17 @@ int ff_frame_pool_video_reinit(FFFramePool *pool,
                                int width,
                                int height,
                                enum AVPixelFormat format,
-                               int align)
+                               int align,
+                               unsigned flags)
 {
+    /* Packed frames have no slack between planes, so the size must match */
+    const int packed = flags & FF_FRAME_POOL_FLAG_PACKED;
     if (pool->type == AVMEDIA_TYPE_VIDEO &&
         pool->pix_fmt == format &&
-        FFALIGN(pool->width,  pool->align) == FFALIGN(width,  align) &&
-        FFALIGN(pool->height, pool->align) == FFALIGN(height, align) &&
+        pool->flags == flags &&
+        (packed ? pool->width == width && pool->height == height :
+         FFALIGN(pool->width,  pool->align) == FFALIGN(width,  align) &&
+         FFALIGN(pool->height, pool->align) == FFALIGN(height, align)) &&
         pool->align == align)
     {
         pool->width = width;
@@ -238,7 +282,7 @@ int ff_frame_pool_video_reinit(FFFramePool *pool,
     }
 
     ff_frame_pool_uninit(pool);
-    return frame_pool_video_init(width, height, format, align, pool);
+    return frame_pool_video_init(width, height, format, align, flags, pool);
 }
 
 int ff_frame_pool_audio_reinit(FFFramePool *pool,
@@ -25,6 +25,20 @@
 #include "libavutil/frame.h"
 #include "libavutil/internal.h"
 
+enum FFFramePoolFlags {
+    /**
+     * Store all planes of a video frame back to back in a single buffer, as
+     * laid out by av_image_fill_arrays(), followed by
+     * AV_INPUT_BUFFER_PADDING_SIZE zeroed bytes. The linesizes are derived
+     * from the unpadded width, so when they are all multiples of the
+     * alignment, this matches the layout written by av_image_copy_to_buffer()
+     * with an alignment of 1 and e.g. raw encoders can reference the frame
+     * data instead of copying it. Otherwise the lines are padded to the
+     * alignment as usual and the frame does not have that layout.
+     */
+    FF_FRAME_POOL_FLAG_PACKED = (1 << 0),
+};
+
 /**
  * Frame pool. This structure must be initialized with
  * ff_frame_pool_{video,audio}_reinit() and freed with ff_frame_pool_uninit().
@@ -48,6 +62,7 @@ typedef struct FFFramePool {
 
     /* common */
     int align;
+    unsigned flags; /* FFFramePoolFlags, video only */
     int linesize[4];
     AVBufferPool *pools[4]; /* for audio, only pools[0] is used */
 
@@ -63,13 +78,15 @@ typedef struct FFFramePool {
  * @param height height of each frame in this pool
  * @param format format of each frame in this pool
  * @param align buffers alignment of each frame in this pool
+ * @param flags a combination of FFFramePoolFlags
  * @return 0 on success, a negative AVERROR otherwise.
  */
 int ff_frame_pool_video_reinit(FFFramePool *pool,
                                int width,
                                int height,
                                enum AVPixelFormat format,
-                               int align);
+                               int align,
+                               unsigned flags);
 
 /**
  * Recreate the audio frame pool if its current configuration differs from the
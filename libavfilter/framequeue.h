@@ -27,8 +27,12 @@
  *
  * Note: this API is not thread-safe. Concurrent access to the same queue
  * must be protected by a mutex or any synchronization mechanism.
+ * Different queues attached to the same global structure may be used
+ * concurrently.
  */
 
+#include <stdatomic.h>
+
 #include "libavutil/frame.h"
 
 typedef struct FFFrameBucket {
@@ -51,7 +55,7 @@ typedef struct FFFrameQueueGlobal {
     /**
      * Total number of queued frames in the queues combined.
      */
-    size_t queued;
+    atomic_size_t queued;
 } FFFrameQueueGlobal;
 
 /**
@@ -23,6 +23,8 @@
 
 #include <stdint.h>
 
+#include "libavutil/pixelutils.h"
+
 #define AV_ME_METHOD_ESA        1
 #define AV_ME_METHOD_TSS        2
 #define AV_ME_METHOD_TDLS       3
@@ -57,6 +59,8 @@ typedef struct AVMotionEstContext {
     int pred_y;     ///< median predictor y
     AVMotionEstPredictor preds[2];
 
+    av_pixelutils_sad_fn sad[5]; ///< square block SAD, 2x2 to 32x32
+
     uint64_t (*get_cost)(struct AVMotionEstContext *me_ctx, int x_mb, int y_mb,
                          int mv_x, int mv_y);
 } AVMotionEstContext;
@@ -64,6 +68,13 @@ typedef struct AVMotionEstContext {
 void ff_me_init_context(AVMotionEstContext *me_ctx, int mb_size, int search_param,
                         int width, int height, int x_min, int x_max, int y_min, int y_max);
 
+/**
+ * Sum of absolute differences of two size x size blocks sharing the
+ * context linesize.
+ */
+uint64_t ff_me_block_sad(const AVMotionEstContext *me_ctx, const uint8_t *src1,
+                         const uint8_t *src2, int size);
+
 uint64_t ff_me_cmp_sad(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int x_mv, int y_mv);
 
 uint64_t ff_me_search_esa(AVMotionEstContext *me_ctx, int x_mb, int y_mb, int *mv);
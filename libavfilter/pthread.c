@@ -27,6 +27,7 @@
 #include "libavutil/macros.h"
 #include "libavutil/mem.h"
 #include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
 
 #include "avfilter.h"
 #include "avfilter_internal.h"
@@ -36,6 +37,12 @@ typedef struct ThreadContext {
     AVSliceThread *thread;
     avfilter_action_func *func;
 
+    /* filter activation, used with AVFILTER_THREAD_PIPELINE */
+    AVSliceThread *pipeline;
+    FFFilterGraph *graphi;
+    /* serializes slice jobs of concurrently activated filters */
+    AVMutex execute_lock;
+
     /* per-execute parameters */
     AVFilterContext *ctx;
     void *arg;
@@ -51,27 +58,97 @@ static int worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_
     return 0;
 }
 
+static int pipeline_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ThreadContext *c = priv;
+    FFFilterGraph *graphi = c->graphi;
+
+    graphi->pipeline_ret[jobnr] = ff_filter_activate(graphi->pipeline[jobnr]);
+    return 0;
+}
+
 static void slice_thread_uninit(ThreadContext *c)
 {
     avpriv_slicethread_free(&c->thread);
 }
 
+static void pipeline_uninit(FFFilterGraph *graphi)
+{
+    ThreadContext *c = graphi->thread;
+
+    if (!graphi->thread_activate)
+        return;
+    avpriv_slicethread_free(&c->pipeline);
+    ff_mutex_destroy(&c->execute_lock);
+    av_freep(&graphi->pipeline);
+    av_freep(&graphi->pipeline_ret);
+    graphi->thread_activate = NULL;
+}
+
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
                           void *arg, int *ret, int nb_jobs)
 {
-    ThreadContext *c = fffiltergraph(ctx->graph)->thread;
+    FFFilterGraph *graphi = fffiltergraph(ctx->graph);
+    ThreadContext *c = graphi->thread;
+    int activating = graphi->activating;
 
     if (nb_jobs <= 0)
         return 0;
+    if (activating)
+        ff_mutex_lock(&c->execute_lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute2(c->thread, nb_jobs, 0);
+    if (activating)
+        ff_mutex_unlock(&c->execute_lock);
     return 0;
 }
 
+static void thread_activate(FFFilterGraph *graphi, int nb_filters)
+{
+    ThreadContext *c = graphi->thread;
+
+    graphi->activating = 1;
+    avpriv_slicethread_execute2(c->pipeline, nb_filters, 0);
+    graphi->activating = 0;
+}
+
+static int pipeline_init(FFFilterGraph *graphi, int nb_threads)
+{
+    ThreadContext *c = graphi->thread;
+    int ret;
+
+    graphi->pipeline     = av_calloc(nb_threads, sizeof(*graphi->pipeline));
+    graphi->pipeline_ret = av_calloc(nb_threads, sizeof(*graphi->pipeline_ret));
+    if (!graphi->pipeline || !graphi->pipeline_ret)
+        goto fail;
+
+    ret = avpriv_slicethread_create2(&c->pipeline, c, pipeline_worker_func, NULL, nb_threads);
+    if (ret <= 1) {
+        avpriv_slicethread_free(&c->pipeline);
+        av_freep(&graphi->pipeline);
+        av_freep(&graphi->pipeline_ret);
+        return ret < 0 ? ret : 0;
+    }
+
+    ret = ff_mutex_init(&c->execute_lock, NULL);
+    if (ret) {
+        avpriv_slicethread_free(&c->pipeline);
+        goto fail;
+    }
+
+    c->graphi               = graphi;
+    graphi->thread_activate = thread_activate;
+    return 0;
+fail:
+    av_freep(&graphi->pipeline);
+    av_freep(&graphi->pipeline_ret);
+    return AVERROR(ENOMEM);
+}
+
 static int thread_init_internal(ThreadContext *c, int nb_threads)
 {
     nb_threads = avpriv_slicethread_create2(&c->thread, c, worker_func, NULL, nb_threads);
@@ -105,12 +182,20 @@ int ff_graph_thread_init(FFFilterGraph *graphi)
 
     graphi->thread_execute = thread_execute;
 
+    if (graph->thread_type & AVFILTER_THREAD_PIPELINE) {
+        ret = pipeline_init(graphi, graph->nb_threads);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
 void ff_graph_thread_free(FFFilterGraph *graph)
 {
-    if (graph->thread)
+    if (graph->thread) {
+        pipeline_uninit(graph);
         slice_thread_uninit(graph->thread);
+    }
     av_freep(&graph->thread);
 }
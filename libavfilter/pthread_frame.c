@@ -0,0 +1,514 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Frame-based multithreading for filters flagged with
+ * FF_FILTER_FLAG_FRAME_THREADS.
+ *
+ * Each worker thread owns a clone of the filter instance, with its own private
+ * context and private copies of the input and output links. Input frames are
+ * handed to the workers in a round-robin fashion and the frames each clone
+ * outputs are queued on its private output link, then forwarded in input
+ * order from the activate callback of the filter.
+ */
+
+#include <stddef.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/buffer.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/thread.h"
+
+#include "avfilter.h"
+#include "avfilter_internal.h"
+#include "filters.h"
+#include "framepool.h"
+#include "framequeue.h"
+
+enum {
+    STATE_IDLE,     ///< no frame submitted, or its output has been forwarded
+    STATE_BUSY,     ///< the worker is filtering a frame
+    STATE_DONE,     ///< the output of the clone is waiting to be forwarded
+};
+
+typedef struct FrameThread {
+    struct FrameThreadContext *parent;
+    AVFilterContext *ctx;   ///< clone of the filter owned by this thread
+    pthread_t thread;
+    int thread_init;
+
+    /* protected by FrameThreadContext.lock */
+    int state;
+    AVFrame *in;
+    int ret;
+} FrameThread;
+
+typedef struct FrameThreadContext {
+    FrameThread *threads;
+    int nb_threads;
+
+    /**
+     * Index of the thread the next input frame is submitted to and of the
+     * one whose output is forwarded next, and number of threads in between.
+     */
+    int next_submit, next_collect, nb_pending;
+
+    /* input status, once all queued frames have been consumed */
+    int status;
+    int64_t status_pts;
+
+    /**
+     * Input pad of the private output links of the clones, so that their
+     * frames are always allocated from the pool of the link.
+     */
+    AVFilterPad sink_pad;
+
+    AVMutex lock;
+    AVCond  work_cond;
+    AVCond  done_cond;
+    int die;
+} FrameThreadContext;
+
+static void *frame_worker(void *arg)
+{
+    FrameThread *t = arg;
+    FrameThreadContext *c = t->parent;
+    AVFilterContext *ctx = t->ctx;
+
+    ff_mutex_lock(&c->lock);
+    while (1) {
+        AVFrame *frame;
+        int ret;
+
+        while (t->state != STATE_BUSY && !c->die)
+            ff_cond_wait(&c->work_cond, &c->lock);
+        if (c->die)
+            break;
+
+        frame  = t->in;
+        t->in  = NULL;
+        ff_mutex_unlock(&c->lock);
+
+        ret = ctx->input_pads[0].filter_frame(ctx->inputs[0], frame);
+
+        ff_mutex_lock(&c->lock);
+        t->ret   = ret;
+        t->state = STATE_DONE;
+        ff_cond_broadcast(&c->done_cond);
+    }
+    ff_mutex_unlock(&c->lock);
+
+    return NULL;
+}
+
+/**
+ * Allocate a private copy of a configured link, outside of the graph.
+ */
+static int clone_link(AVFilterLink **dst, AVFilterLink *src)
+{
+    FilterLinkInternal *li_src = ff_link_internal(src);
+    FilterLinkInternal *li;
+    AVFilterLink *link;
+    int ret;
+
+    li = av_mallocz(sizeof(*li));
+    if (!li)
+        return AVERROR(ENOMEM);
+    link = &li->l.pub;
+
+    li->l = li_src->l;
+    li->l.graph         = NULL;
+    li->l.hw_frames_ctx = NULL;
+    link->src = link->dst = NULL;
+    link->srcpad = link->dstpad = NULL;
+    link->side_data    = NULL;
+    link->nb_side_data = 0;
+    link->ch_layout    = (AVChannelLayout){ 0 };
+    memset(&link->incfg,  0, sizeof(link->incfg));
+    memset(&link->outcfg, 0, sizeof(link->outcfg));
+    li->age_index  = -1;
+    li->init_state = AVLINK_INIT;
+    ff_framequeue_init(&li->fifo, li_src->fifo.global);
+    *dst = link;
+
+    if (li_src->l.hw_frames_ctx) {
+        li->l.hw_frames_ctx = av_buffer_ref(li_src->l.hw_frames_ctx);
+        if (!li->l.hw_frames_ctx)
+            return AVERROR(ENOMEM);
+    }
+    ret = av_channel_layout_copy(&link->ch_layout, &src->ch_layout);
+    if (ret < 0)
+        return ret;
+    for (int i = 0; i < src->nb_side_data; i++) {
+        ret = av_frame_side_data_clone(&link->side_data, &link->nb_side_data,
+                                       src->side_data[i], 0);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static void clone_free(AVFilterContext **pclone)
+{
+    AVFilterContext *clone = *pclone;
+
+    if (!clone)
+        return;
+
+    /* the clone is not part of the graph, and its output link is not
+     * connected to the input of any filter */
+    clone->graph = NULL;
+    if (clone->outputs[0])
+        clone->outputs[0]->dst = NULL;
+    avfilter_free(clone);
+    *pclone = NULL;
+}
+
+static int clone_init(FrameThreadContext *c, AVFilterContext *ctx,
+                      AVFilterContext **pclone)
+{
+    const FFFilter *const fi = fffilter(ctx->filter);
+    AVFilterContext *clone;
+    AVFilterLink *inlink, *outlink;
+    int ret;
+
+    clone = *pclone = ff_filter_alloc(ctx->filter, ctx->name);
+    if (!clone)
+        return AVERROR(ENOMEM);
+
+    /* not part of graph->filters, but needed for the thread count */
+    clone->graph       = ctx->graph;
+    clone->nb_threads  = ctx->nb_threads;
+    clone->thread_type = 0;
+    if (ctx->hw_device_ctx) {
+        clone->hw_device_ctx = av_buffer_ref(ctx->hw_device_ctx);
+        if (!clone->hw_device_ctx)
+            return AVERROR(ENOMEM);
+    }
+
+    if (ctx->filter->priv_class) {
+        ret = av_opt_copy(clone->priv, ctx->priv);
+        if (ret < 0)
+            return ret;
+    }
+    if (fi->init) {
+        ret = fi->init(clone);
+        if (ret < 0)
+            return ret;
+    }
+    fffilterctx(clone)->state_flags |= AV_CLASS_STATE_INITIALIZED;
+
+    ret = clone_link(&clone->inputs[0], ctx->inputs[0]);
+    if (ret < 0)
+        return ret;
+    inlink = clone->inputs[0];
+    inlink->dst    = clone;
+    inlink->dstpad = &clone->input_pads[0];
+
+    ret = clone_link(&clone->outputs[0], ctx->outputs[0]);
+    if (ret < 0)
+        return ret;
+    outlink = clone->outputs[0];
+    outlink->src    = clone;
+    outlink->srcpad = &clone->output_pads[0];
+    outlink->dst    = clone;
+    outlink->dstpad = &c->sink_pad;
+
+    /* same order as ff_filter_config_links() */
+    if (inlink->dstpad->config_props) {
+        ret = inlink->dstpad->config_props(inlink);
+        if (ret < 0)
+            return ret;
+    }
+    if (outlink->srcpad->config_props) {
+        ret = outlink->srcpad->config_props(outlink);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx)
+{
+    FFFilterContext *ctxi = fffilterctx(ctx);
+    FrameThreadContext *c = ctxi->frame_thread;
+
+    if (!c)
+        return;
+
+    ff_mutex_lock(&c->lock);
+    c->die = 1;
+    ff_cond_broadcast(&c->work_cond);
+    ff_mutex_unlock(&c->lock);
+
+    for (int i = 0; i < c->nb_threads; i++) {
+        FrameThread *t = &c->threads[i];
+
+        if (t->thread_init)
+            pthread_join(t->thread, NULL);
+        av_frame_free(&t->in);
+        clone_free(&t->ctx);
+    }
+    av_freep(&c->threads);
+
+    ff_cond_destroy(&c->done_cond);
+    ff_cond_destroy(&c->work_cond);
+    ff_mutex_destroy(&c->lock);
+    av_freep(&ctxi->frame_thread);
+}
+
+static int frame_thread_init(AVFilterContext *ctx)
+{
+    FFFilterContext *ctxi = fffilterctx(ctx);
+    FrameThreadContext *c;
+    int nb_threads = ff_filter_get_nb_threads(ctx);
+    int ret;
+
+    c = ctxi->frame_thread = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    c->sink_pad.name = "default";
+    c->sink_pad.type = ctx->outputs[0]->type;
+
+    ret = ff_mutex_init(&c->lock, NULL);
+    if (ret)
+        goto fail_lock;
+    ret = ff_cond_init(&c->work_cond, NULL);
+    if (ret)
+        goto fail_work_cond;
+    ret = ff_cond_init(&c->done_cond, NULL);
+    if (ret)
+        goto fail_done_cond;
+
+    c->threads = av_calloc(nb_threads, sizeof(*c->threads));
+    if (!c->threads) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    for (int i = 0; i < nb_threads; i++) {
+        FrameThread *t = &c->threads[i];
+
+        t->parent = c;
+        c->nb_threads++;
+
+        ret = clone_init(c, ctx, &t->ctx);
+        if (ret < 0)
+            goto fail;
+
+        ret = AVERROR(pthread_create(&t->thread, NULL, frame_worker, t));
+        if (ret < 0)
+            goto fail;
+        t->thread_init = 1;
+    }
+
+    return 0;
+fail:
+    av_log(ctx, AV_LOG_ERROR, "Error initializing frame threads: %s.\n",
+           av_err2str(ret));
+    ff_filter_frame_thread_free(ctx);
+    return ret;
+fail_done_cond:
+    ff_cond_destroy(&c->work_cond);
+fail_work_cond:
+    ff_mutex_destroy(&c->lock);
+fail_lock:
+    av_freep(&ctxi->frame_thread);
+    return AVERROR(ret);
+}
+
+/**
+ * Forward the output of the oldest submitted frames, as long as they are
+ * done. If wait is non-zero, wait for that many of them to be done.
+ */
+static int collect(AVFilterContext *ctx, FrameThreadContext *c, int wait)
+{
+    while (c->nb_pending) {
+        FrameThread *t = &c->threads[c->next_collect];
+        FilterLinkInternal *li = ff_link_internal(t->ctx->outputs[0]);
+        int state, thread_ret, ret;
+
+        ff_mutex_lock(&c->lock);
+        while (wait > 0 && t->state == STATE_BUSY)
+            ff_cond_wait(&c->done_cond, &c->lock);
+        state = t->state;
+        if (state == STATE_DONE)
+            t->state = STATE_IDLE;
+        thread_ret = t->ret;
+        ff_mutex_unlock(&c->lock);
+
+        if (state != STATE_DONE)
+            break;
+
+        c->next_collect = (c->next_collect + 1) % c->nb_threads;
+        c->nb_pending--;
+        wait--;
+
+        while (ff_framequeue_queued_frames(&li->fifo)) {
+            ret = ff_filter_frame(ctx->outputs[0], ff_framequeue_take(&li->fifo));
+            if (ret < 0)
+                return ret;
+        }
+        if (thread_ret < 0)
+            return thread_ret;
+    }
+
+    return 0;
+}
+
+static int submit(AVFilterContext *ctx, FrameThreadContext *c, AVFrame *frame)
+{
+    FrameThread *t = &c->threads[c->next_submit];
+    AVFilterContext *clone = t->ctx;
+    AVFilterLink *inlink = ctx->inputs[0];
+    int ret;
+
+    av_assert1(t->state == STATE_IDLE);
+
+    if (ctx->input_pads[0].flags & AVFILTERPAD_FLAG_NEEDS_WRITABLE) {
+        ret = ff_inlink_make_frame_writable(inlink, &frame);
+        if (ret < 0) {
+            av_frame_free(&frame);
+            return ret;
+        }
+    }
+
+    /* the frame was consumed, filter_frame() expects the count before it */
+    ff_filter_link(clone->inputs[0])->frame_count_out =
+        ff_filter_link(inlink)->frame_count_out - 1;
+    clone->is_disabled = ctx->is_disabled;
+
+    c->next_submit = (c->next_submit + 1) % c->nb_threads;
+    c->nb_pending++;
+
+    if (ctx->is_disabled &&
+        (ctx->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC)) {
+        /* pass the frame through, behind the ones still being filtered */
+        ff_mutex_lock(&c->lock);
+        t->ret   = ff_filter_frame(clone->outputs[0], frame);
+        t->state = STATE_DONE;
+        ff_mutex_unlock(&c->lock);
+        return 0;
+    }
+
+    ff_mutex_lock(&c->lock);
+    t->in    = frame;
+    t->ret   = 0;
+    t->state = STATE_BUSY;
+    ff_cond_broadcast(&c->work_cond);
+    ff_mutex_unlock(&c->lock);
+
+    return 0;
+}
+
+int ff_filter_frame_thread_activate(AVFilterContext *ctx)
+{
+    FrameThreadContext *c = fffilterctx(ctx)->frame_thread;
+    AVFilterLink *inlink  = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[0];
+    AVFrame *frame;
+    int ret;
+
+    if (!c) {
+        ret = frame_thread_init(ctx);
+        if (ret < 0)
+            return ret;
+        c = fffilterctx(ctx)->frame_thread;
+    }
+
+    FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
+
+    ret = collect(ctx, c, 0);
+    if (ret < 0)
+        return ret;
+
+    if (ff_inlink_check_available_frame(inlink)) {
+        /* all threads busy: the next one is also the oldest */
+        if (c->nb_pending == c->nb_threads) {
+            ret = collect(ctx, c, 1);
+            if (ret < 0)
+                return ret;
+        }
+
+        ret = ff_inlink_consume_frame(inlink, &frame);
+        if (ret < 0)
+            return ret;
+        ret = submit(ctx, c, frame);
+        if (ret < 0)
+            return ret;
+
+        ff_filter_set_ready(ctx, 100);
+        return 0;
+    }
+
+    if (!c->status)
+        ff_inlink_acknowledge_status(inlink, &c->status, &c->status_pts);
+    if (c->status) {
+        ret = collect(ctx, c, c->nb_pending);
+        if (ret < 0)
+            return ret;
+        ff_outlink_set_status(outlink, c->status, c->status_pts);
+        return 0;
+    }
+
+    if (ff_outlink_frame_wanted(outlink)) {
+        /* keep the threads fed, only block once they all are */
+        if (c->nb_pending < c->nb_threads) {
+            ff_inlink_request_frame(inlink);
+            return 0;
+        }
+        return collect(ctx, c, 1);
+    }
+
+    return FFERROR_NOT_READY;
+}
+
+int ff_filter_frame_thread_process_command(AVFilterContext *ctx, const char *cmd,
+                                           const char *arg, int flags)
+{
+    FrameThreadContext *c = fffilterctx(ctx)->frame_thread;
+    int ret;
+
+    if (!c)
+        return 0;
+
+    /* the frames already submitted are filtered with the previous settings */
+    ff_mutex_lock(&c->lock);
+    for (int i = 0; i < c->nb_threads; i++)
+        while (c->threads[i].state == STATE_BUSY)
+            ff_cond_wait(&c->done_cond, &c->lock);
+    ff_mutex_unlock(&c->lock);
+
+    for (int i = 0; i < c->nb_threads; i++) {
+        AVFilterContext *clone = c->threads[i].ctx;
+
+        ret = fffilter(ctx->filter)->process_command(clone, cmd, arg, NULL, 0, flags);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
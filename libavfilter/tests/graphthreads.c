@@ -0,0 +1,190 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Run a video filtergraph with the given thread type and number of threads,
+ * then without threading, and print the checksum of every frame output by
+ * each sink. Fails if the two runs do not output the same frames.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/bprint.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+
+#define MAX_SINKS 8
+
+static uint32_t frame_checksum(const AVFrame *frame)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    uint32_t checksum = 0;
+
+    for (int p = 0; p < 4 && frame->data[p]; p++) {
+        int bytes = av_image_get_linesize(frame->format, frame->width, p);
+        int h     = frame->height;
+
+        if (bytes <= 0)
+            break;
+        if (p == 1 || p == 2)
+            h = AV_CEIL_RSHIFT(h, desc->log2_chroma_h);
+
+        for (int y = 0; y < h; y++)
+            checksum = av_adler32_update(checksum, frame->data[p] + y * frame->linesize[p], bytes);
+    }
+    return checksum;
+}
+
+static int drain_sinks(AVFilterContext **sinks, int nb_sinks, AVBPrint *out,
+                       AVFrame *frame)
+{
+    for (int i = 0; i < nb_sinks; i++) {
+        int ret;
+        while ((ret = av_buffersink_get_frame_flags(sinks[i], frame,
+                                                    AV_BUFFERSINK_FLAG_NO_REQUEST)) >= 0) {
+            av_bprintf(&out[i], "%d, %10"PRId64", %dx%d, 0x%08"PRIx32"\n",
+                       i, frame->pts, frame->width, frame->height,
+                       frame_checksum(frame));
+            av_frame_unref(frame);
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            return ret;
+    }
+    return 0;
+}
+
+static int run_graph(const char *desc, const char *thread_type, int threads,
+                     AVBPrint *out, int *nb_sinks)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    AVFilterInOut *inputs = NULL, *outputs = NULL, *cur;
+    AVFilterContext *sinks[MAX_SINKS];
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    *nb_sinks = 0;
+    if (!graph || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    /* the thread type must be set before any filter is added */
+    ret = av_opt_set(graph, "thread_type", thread_type, 0);
+    if (ret < 0)
+        goto end;
+    graph->nb_threads = threads;
+
+    ret = avfilter_graph_parse2(graph, desc, &inputs, &outputs);
+    if (ret < 0)
+        goto end;
+    if (inputs) {
+        fprintf(stderr, "The graph must not have open inputs\n");
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    for (cur = outputs; cur; cur = cur->next) {
+        char name[32];
+
+        if (*nb_sinks == MAX_SINKS) {
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+        snprintf(name, sizeof(name), "sink%d", *nb_sinks);
+        ret = avfilter_graph_create_filter(&sinks[*nb_sinks],
+                                           avfilter_get_by_name("buffersink"),
+                                           name, NULL, NULL, graph);
+        if (ret < 0)
+            goto end;
+        ret = avfilter_link(cur->filter_ctx, cur->pad_idx, sinks[*nb_sinks], 0);
+        if (ret < 0)
+            goto end;
+        (*nb_sinks)++;
+    }
+
+    ret = avfilter_graph_config(graph, NULL);
+    if (ret < 0)
+        goto end;
+
+    while ((ret = avfilter_graph_request_oldest(graph)) >= 0 || ret == AVERROR(EAGAIN)) {
+        ret = drain_sinks(sinks, *nb_sinks, out, frame);
+        if (ret < 0)
+            goto end;
+    }
+    if (ret == AVERROR_EOF)
+        ret = drain_sinks(sinks, *nb_sinks, out, frame);
+
+end:
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    avfilter_graph_free(&graph);
+    av_frame_free(&frame);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVBPrint threaded[MAX_SINKS], serial[MAX_SINKS];
+    int nb_sinks, nb_serial_sinks, threads, ret, i;
+
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <graph> <thread_type> <threads>\n", argv[0]);
+        return 1;
+    }
+    threads = atoi(argv[3]);
+
+    for (i = 0; i < MAX_SINKS; i++) {
+        av_bprint_init(&threaded[i], 0, AV_BPRINT_SIZE_UNLIMITED);
+        av_bprint_init(&serial[i],   0, AV_BPRINT_SIZE_UNLIMITED);
+    }
+
+    ret = run_graph(argv[1], argv[2], threads, threaded, &nb_sinks);
+    if (ret < 0) {
+        fprintf(stderr, "Threaded run failed: %s\n", av_err2str(ret));
+        goto end;
+    }
+    ret = run_graph(argv[1], "slice", 1, serial, &nb_serial_sinks);
+    if (ret < 0) {
+        fprintf(stderr, "Serial run failed: %s\n", av_err2str(ret));
+        goto end;
+    }
+
+    for (i = 0; i < nb_sinks; i++) {
+        printf("%s", threaded[i].str);
+        if (strcmp(threaded[i].str, serial[i].str)) {
+            fprintf(stderr, "Sink %d output differs from the serial run\n", i);
+            ret = AVERROR_BUG;
+        }
+    }
+
+end:
+    for (i = 0; i < MAX_SINKS; i++) {
+        av_bprint_finalize(&threaded[i], NULL);
+        av_bprint_finalize(&serial[i],   NULL);
+    }
+    return ret < 0;
+}
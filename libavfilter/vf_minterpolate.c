@@ -19,12 +19,15 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stdatomic.h>
+
 #include "motion_estimation.h"
 #include "libavcodec/mathops.h"
 #include "libavutil/common.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "video.h"
@@ -195,8 +198,21 @@ typedef struct MIContext {
     int log2_chroma_w;
     int log2_chroma_h;
     int nb_planes;
+
+    atomic_int *mb_row_progress;    ///< number of searched blocks in each macroblock row
+    AVMutex progress_lock;
+    AVCond progress_cond;
 } MIContext;
 
+typedef struct ThreadData {
+    Block *blocks;
+    int dir;
+    atomic_int next_mb_row;
+    AVMotionEstContext me_ctx;      ///< state after searching the last block
+    AVFrame *avf_out;
+    int alpha;
+} ThreadData;
+
 #define OFFSET(x) offsetof(MIContext, x)
 #define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
 #define CONST(name, help, val, u) { name, help, 0, AV_OPT_TYPE_CONST, {.i64=val}, 0, 0, FLAGS, .unit = u }
@@ -254,20 +270,16 @@ static uint64_t get_sbad(AVMotionEstContext *me_ctx, int x, int y, int x_mv, int
     int linesize = me_ctx->linesize;
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
-    int mv_x, mv_y, i, j;
-    uint64_t sbad = 0;
+    int mv_x, mv_y;
+    uint64_t sbad;
 
     x = av_clip(x, me_ctx->x_min, me_ctx->x_max);
     y = av_clip(y, me_ctx->y_min, me_ctx->y_max);
     mv_x = av_clip(x_mv - x, -FFMIN(x - me_ctx->x_min, me_ctx->x_max - x), FFMIN(x - me_ctx->x_min, me_ctx->x_max - x));
     mv_y = av_clip(y_mv - y, -FFMIN(y - me_ctx->y_min, me_ctx->y_max - y), FFMIN(y - me_ctx->y_min, me_ctx->y_max - y));
 
-    data_cur += (y + mv_y) * linesize;
-    data_next += (y - mv_y) * linesize;
-
-    for (j = 0; j < me_ctx->mb_size; j++)
-        for (i = 0; i < me_ctx->mb_size; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + j * linesize] - data_next[x - mv_x + i + j * linesize]);
+    sbad = ff_me_block_sad(me_ctx, data_cur + x + mv_x + (y + mv_y) * linesize,
+                           data_next + x - mv_x + (y - mv_y) * linesize, me_ctx->mb_size);
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -283,17 +295,18 @@ static uint64_t get_sbad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv,
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
     int mv_x1 = x_mv - x;
     int mv_y1 = y_mv - y;
-    int mv_x, mv_y, i, j;
-    uint64_t sbad = 0;
+    int ob = me_ctx->mb_size / 2;
+    int mv_x, mv_y;
+    uint64_t sbad;
 
     x = av_clip(x, x_min, x_max);
     y = av_clip(y, y_min, y_max);
     mv_x = av_clip(x_mv - x, -FFMIN(x - x_min, x_max - x), FFMIN(x - x_min, x_max - x));
     mv_y = av_clip(y_mv - y, -FFMIN(y - y_min, y_max - y), FFMIN(y - y_min, y_max - y));
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sbad += FFABS(data_cur[x + mv_x + i + (y + mv_y + j) * linesize] - data_next[x - mv_x + i + (y - mv_y + j) * linesize]);
+    sbad = ff_me_block_sad(me_ctx, data_cur + x + mv_x - ob + (y + mv_y - ob) * linesize,
+                           data_next + x - mv_x - ob + (y - mv_y - ob) * linesize,
+                           me_ctx->mb_size * 3 / 2 + ob);
 
     return sbad + (FFABS(mv_x1 - me_ctx->pred_x) + FFABS(mv_y1 - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -309,17 +322,17 @@ static uint64_t get_sad_ob(AVMotionEstContext *me_ctx, int x, int y, int x_mv, i
     int y_max = me_ctx->y_max - me_ctx->mb_size / 2;
     int mv_x = x_mv - x;
     int mv_y = y_mv - y;
-    int i, j;
-    uint64_t sad = 0;
+    int ob = me_ctx->mb_size / 2;
+    uint64_t sad;
 
     x = av_clip(x, x_min, x_max);
     y = av_clip(y, y_min, y_max);
     x_mv = av_clip(x_mv, x_min, x_max);
     y_mv = av_clip(y_mv, y_min, y_max);
 
-    for (j = -me_ctx->mb_size / 2; j < me_ctx->mb_size * 3 / 2; j++)
-        for (i = -me_ctx->mb_size / 2; i < me_ctx->mb_size * 3 / 2; i++)
-            sad += FFABS(data_ref[x_mv + i + (y_mv + j) * linesize] - data_cur[x + i + (y + j) * linesize]);
+    sad = ff_me_block_sad(me_ctx, data_ref + x_mv - ob + (y_mv - ob) * linesize,
+                          data_cur + x - ob + (y - ob) * linesize,
+                          me_ctx->mb_size * 3 / 2 + ob);
 
     return sad + (FFABS(mv_x - me_ctx->pred_x) + FFABS(mv_y - me_ctx->pred_y)) * COST_PRED_SCALE;
 }
@@ -378,6 +391,10 @@ static int config_input(AVFilterLink *inlink)
             if (!FF_ALLOCZ_TYPED_ARRAY(mi_ctx->int_blocks, mi_ctx->b_count))
                 return AVERROR(ENOMEM);
 
+        mi_ctx->mb_row_progress = av_calloc(mi_ctx->b_height, sizeof(*mi_ctx->mb_row_progress));
+        if (!mi_ctx->mb_row_progress)
+            return AVERROR(ENOMEM);
+
         if (mi_ctx->me_method == AV_ME_METHOD_EPZS) {
             for (i = 0; i < 3; i++) {
                 mi_ctx->mv_table[i] = av_calloc(mi_ctx->b_count, sizeof(*mi_ctx->mv_table[0]));
@@ -414,9 +431,9 @@ static int config_output(AVFilterLink *outlink)
         preds.nb++;\
     } while(0)
 
-static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int dir)
+static void search_mv(MIContext *mi_ctx, AVMotionEstContext *me_ctx, Block *blocks,
+                      int mb_x, int mb_y, int dir)
 {
-    AVMotionEstContext *me_ctx = &mi_ctx->me_ctx;
     AVMotionEstPredictor *preds = me_ctx->preds;
     Block *block = &blocks[mb_x + mb_y * mi_ctx->b_width];
 
@@ -556,8 +573,82 @@ static void search_mv(MIContext *mi_ctx, Block *blocks, int mb_x, int mb_y, int
     block->mvs[dir][1] = mv[1] - y_mb;
 }
 
-static void bilateral_me(MIContext *mi_ctx)
+static void await_mb_row(MIContext *mi_ctx, int mb_y, int nb_blocks)
+{
+    if (atomic_load_explicit(&mi_ctx->mb_row_progress[mb_y], memory_order_acquire) >= nb_blocks)
+        return;
+
+    ff_mutex_lock(&mi_ctx->progress_lock);
+    while (atomic_load_explicit(&mi_ctx->mb_row_progress[mb_y], memory_order_acquire) < nb_blocks)
+        ff_cond_wait(&mi_ctx->progress_cond, &mi_ctx->progress_lock);
+    ff_mutex_unlock(&mi_ctx->progress_lock);
+}
+
+static void report_mb_row(MIContext *mi_ctx, int mb_y, int nb_blocks)
 {
+    ff_mutex_lock(&mi_ctx->progress_lock);
+    atomic_store_explicit(&mi_ctx->mb_row_progress[mb_y], nb_blocks, memory_order_release);
+    ff_cond_broadcast(&mi_ctx->progress_cond);
+    ff_mutex_unlock(&mi_ctx->progress_lock);
+}
+
+/**
+ * Macroblock rows are claimed in order by whichever job is free. EPZS and UMH
+ * predict from the left, top and top-right blocks, so for those a row only
+ * advances behind the row above it. A claimed row is always being processed
+ * by a running job, thus the wait cannot deadlock whatever the job order.
+ */
+static int search_mv_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    ThreadData *td = arg;
+    AVMotionEstContext me_ctx = mi_ctx->me_ctx;
+    const int wavefront = mi_ctx->me_method == AV_ME_METHOD_EPZS ||
+                          mi_ctx->me_method == AV_ME_METHOD_UMH;
+    int mb_x, mb_y;
+
+    while ((mb_y = atomic_fetch_add_explicit(&td->next_mb_row, 1, memory_order_relaxed)) < mi_ctx->b_height) {
+        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
+            if (wavefront && mb_y > 0)
+                await_mb_row(mi_ctx, mb_y - 1, FFMIN(mb_x + 2, mi_ctx->b_width));
+
+            search_mv(mi_ctx, &me_ctx, td->blocks, mb_x, mb_y, td->dir);
+
+            if (wavefront)
+                report_mb_row(mi_ctx, mb_y, mb_x + 1);
+        }
+
+        if (mb_y == mi_ctx->b_height - 1)
+            td->me_ctx = me_ctx;
+    }
+
+    return 0;
+}
+
+static void search_mvs(AVFilterContext *ctx, Block *blocks, int dir)
+{
+    MIContext *mi_ctx = ctx->priv;
+    ThreadData td;
+    int mb_y;
+
+    td.blocks = blocks;
+    td.dir = dir;
+    td.me_ctx = mi_ctx->me_ctx;
+    atomic_init(&td.next_mb_row, 0);
+
+    for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
+        atomic_store_explicit(&mi_ctx->mb_row_progress[mb_y], 0, memory_order_relaxed);
+
+    ff_filter_execute(ctx, search_mv_slice, &td, NULL,
+                      FFMIN(mi_ctx->b_height, ff_filter_get_nb_threads(ctx)));
+
+    /* later cost evaluations use the predictor of the last searched block */
+    mi_ctx->me_ctx = td.me_ctx;
+}
+
+static void bilateral_me(AVFilterContext *ctx)
+{
+    MIContext *mi_ctx = ctx->priv;
     Block *block;
     int mb_x, mb_y;
 
@@ -572,9 +663,26 @@ static void bilateral_me(MIContext *mi_ctx)
             block->mvs[0][1] = 0;
         }
 
-    for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
-            search_mv(mi_ctx, mi_ctx->int_blocks, mb_x, mb_y, 0);
+    search_mvs(ctx, mi_ctx->int_blocks, 0);
+}
+
+static int block_sbad_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    const int slice_start = (mi_ctx->b_height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (mi_ctx->b_height * (jobnr + 1)) / nb_jobs;
+    int mb_x, mb_y;
+
+    for (mb_y = slice_start; mb_y < slice_end; mb_y++)
+        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
+            int x_mb = mb_x << mi_ctx->log2_mb_size;
+            int y_mb = mb_y << mi_ctx->log2_mb_size;
+            Block *block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
+
+            block->sbad = get_sbad(&mi_ctx->me_ctx, x_mb, y_mb, x_mb + block->mvs[0][0], y_mb + block->mvs[0][1]);
+        }
+
+    return 0;
 }
 
 static int var_size_bme(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n)
@@ -757,9 +865,7 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
                     mi_ctx->me_ctx.data_cur = mi_ctx->frames[2].avf->data[0];
                     mi_ctx->me_ctx.data_ref = mi_ctx->frames[dir ? 3 : 1].avf->data[0];
 
-                    for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-                        for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++)
-                            search_mv(mi_ctx, mi_ctx->frames[2].blocks, mb_x, mb_y, dir);
+                    search_mvs(ctx, mi_ctx->frames[2].blocks, dir);
                 }
             }
 
@@ -774,19 +880,11 @@ static int inject_frame(AVFilterLink *inlink, AVFrame *avf_in)
             mi_ctx->me_ctx.data_cur = mi_ctx->frames[1].avf->data[0];
             mi_ctx->me_ctx.data_ref = mi_ctx->frames[2].avf->data[0];
 
-            bilateral_me(mi_ctx);
-
-            if (mi_ctx->mc_mode == MC_MODE_AOBMC) {
+            bilateral_me(ctx);
 
-                for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-                    for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
-                        int x_mb = mb_x << mi_ctx->log2_mb_size;
-                        int y_mb = mb_y << mi_ctx->log2_mb_size;
-                        block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
-
-                        block->sbad = get_sbad(&mi_ctx->me_ctx, x_mb, y_mb, x_mb + block->mvs[0][0], y_mb + block->mvs[0][1]);
-                    }
-            }
+            if (mi_ctx->mc_mode == MC_MODE_AOBMC)
+                ff_filter_execute(ctx, block_sbad_slice, NULL, NULL,
+                                  FFMIN(mi_ctx->b_height, ff_filter_get_nb_threads(ctx)));
 
             if (mi_ctx->vsbmc) {
 
@@ -855,17 +953,13 @@ static int detect_scene_change(AVFilterContext *ctx)
         pixel_refs->nb++;\
     } while(0)
 
-static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
+static void bidirectional_obmc(MIContext *mi_ctx, int alpha, int slice_start, int slice_end)
 {
     int x, y;
     int width = mi_ctx->frames[0].avf->width;
     int height = mi_ctx->frames[0].avf->height;
     int mb_y, mb_x, dir;
 
-    for (y = 0; y < height; y++)
-        for (x = 0; x < width; x++)
-            mi_ctx->pixel_refs[x + y * width].nb = 0;
-
     for (dir = 0; dir < 2; dir++)
         for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
             for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
@@ -879,9 +973,9 @@ static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
                 start_y = (mb_y << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2 + mv_y * a / ALPHA_MAX;
 
                 startc_x = av_clip(start_x, 0, width - 1);
-                startc_y = av_clip(start_y, 0, height - 1);
+                startc_y = av_clip(start_y, slice_start, slice_end);
                 endc_x = av_clip(start_x + (2 << mi_ctx->log2_mb_size), 0, width - 1);
-                endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), 0, height - 1);
+                endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), slice_start, FFMIN(slice_end, height - 1));
 
                 if (dir) {
                     mv_x = -mv_x;
@@ -905,16 +999,16 @@ static void bidirectional_obmc(MIContext *mi_ctx, int alpha)
             }
 }
 
-static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out)
+static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out,
+                           int slice_start, int slice_end)
 {
     int x, y, plane;
 
     for (plane = 0; plane < mi_ctx->nb_planes; plane++) {
         int width = avf_out->width;
-        int height = avf_out->height;
         int chroma = plane == 1 || plane == 2;
 
-        for (y = 0; y < height; y++)
+        for (y = slice_start; y < slice_end; y++)
             for (x = 0; x < width; x++) {
                 int x_mv, y_mv;
                 int weight_sum = 0;
@@ -966,7 +1060,8 @@ static void set_frame_data(MIContext *mi_ctx, int alpha, AVFrame *avf_out)
     }
 }
 
-static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n, int alpha)
+static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, int n, int alpha,
+                         int slice_start, int slice_end)
 {
     int sb_x, sb_y;
     int width = mi_ctx->frames[0].avf->width;
@@ -977,7 +1072,8 @@ static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, in
             Block *sb = &block->subs[sb_x + sb_y * 2];
 
             if (sb->sb)
-                var_size_bmc(mi_ctx, sb, x_mb + (sb_x << (n - 1)), y_mb + (sb_y << (n - 1)), n - 1, alpha);
+                var_size_bmc(mi_ctx, sb, x_mb + (sb_x << (n - 1)), y_mb + (sb_y << (n - 1)), n - 1, alpha,
+                             slice_start, slice_end);
             else {
                 int x, y;
                 int mv_x = sb->mvs[0][0] * 2;
@@ -986,7 +1082,9 @@ static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, in
                 int start_x = x_mb + (sb_x << (n - 1));
                 int start_y = y_mb + (sb_y << (n - 1));
                 int end_x = start_x + (1 << (n - 1));
-                int end_y = start_y + (1 << (n - 1));
+                int end_y = FFMIN(start_y + (1 << (n - 1)), slice_end);
+
+                start_y = FFMAX(start_y, slice_start);
 
                 for (y = start_y; y < end_y; y++)  {
                     int y_min = -y;
@@ -1005,7 +1103,8 @@ static void var_size_bmc(MIContext *mi_ctx, Block *block, int x_mb, int y_mb, in
         }
 }
 
-static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y, int alpha)
+static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y, int alpha,
+                           int slice_start, int slice_end)
 {
     int x, y;
     int width = mi_ctx->frames[0].avf->width;
@@ -1013,13 +1112,24 @@ static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y,
 
     Block *nb;
     int nb_x, nb_y;
-    uint64_t sbads[9];
+    uint64_t sbads[9] = { 0 };
 
     int mv_x = block->mvs[0][0] * 2;
     int mv_y = block->mvs[0][1] * 2;
     int start_x, start_y;
     int startc_x, startc_y, endc_x, endc_y;
 
+    start_x = (mb_x << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
+    start_y = (mb_y << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
+
+    startc_x = av_clip(start_x, 0, width - 1);
+    startc_y = av_clip(start_y, slice_start, slice_end);
+    endc_x = av_clip(start_x + (2 << mi_ctx->log2_mb_size), 0, width - 1);
+    endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), slice_start, FFMIN(slice_end, height - 1));
+
+    if (startc_y >= endc_y)
+        return;
+
     if (mi_ctx->mc_mode == MC_MODE_AOBMC)
         for (nb_y = FFMAX(0, mb_y - 1); nb_y < FFMIN(mb_y + 2, mi_ctx->b_height); nb_y++)
             for (nb_x = FFMAX(0, mb_x - 1); nb_x < FFMIN(mb_x + 2, mi_ctx->b_width); nb_x++) {
@@ -1030,14 +1140,6 @@ static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y,
                     sbads[nb_x - mb_x + 1 + (nb_y - mb_y + 1) * 3] = get_sbad(&mi_ctx->me_ctx, x_nb, y_nb, x_nb + block->mvs[0][0], y_nb + block->mvs[0][1]);
             }
 
-    start_x = (mb_x << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
-    start_y = (mb_y << mi_ctx->log2_mb_size) - mi_ctx->mb_size / 2;
-
-    startc_x = av_clip(start_x, 0, width - 1);
-    startc_y = av_clip(start_y, 0, height - 1);
-    endc_x = av_clip(start_x + (2 << mi_ctx->log2_mb_size), 0, width - 1);
-    endc_y = av_clip(start_y + (2 << mi_ctx->log2_mb_size), 0, height - 1);
-
     for (y = startc_y; y < endc_y; y++) {
         int y_min = -y;
         int y_max = height - y - 1;
@@ -1069,6 +1171,55 @@ static void bilateral_obmc(MIContext *mi_ctx, Block *block, int mb_x, int mb_y,
     }
 }
 
+/**
+ * Each job renders a band of rows aligned to the chroma subsampling. The
+ * blocks are visited in the same order in every band, so the motion vectors
+ * collected for a pixel do not depend on the number of jobs.
+ */
+static int interpolate_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    MIContext *mi_ctx = ctx->priv;
+    ThreadData *td = arg;
+    const int width  = mi_ctx->frames[0].avf->width;
+    const int height = mi_ctx->frames[0].avf->height;
+    const int nb_rows = AV_CEIL_RSHIFT(height, mi_ctx->log2_chroma_h);
+    const int slice_start = ((nb_rows *  jobnr     ) / nb_jobs) << mi_ctx->log2_chroma_h;
+    const int slice_end   = FFMIN(((nb_rows * (jobnr + 1)) / nb_jobs) << mi_ctx->log2_chroma_h, height);
+    int x, y;
+
+    for (y = slice_start; y < slice_end; y++)
+        for (x = 0; x < width; x++)
+            mi_ctx->pixel_refs[x + y * width].nb = 0;
+
+    if (mi_ctx->me_mode == ME_MODE_BIDIR) {
+        bidirectional_obmc(mi_ctx, td->alpha, slice_start, slice_end);
+    } else if (mi_ctx->me_mode == ME_MODE_BILAT) {
+        int mb_x, mb_y;
+        Block *block;
+
+        for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++) {
+            int y_mb = mb_y << mi_ctx->log2_mb_size;
+
+            if (y_mb + mi_ctx->mb_size * 3 / 2 <= slice_start || y_mb - mi_ctx->mb_size / 2 >= slice_end)
+                continue;
+
+            for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
+                block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
+
+                if (block->sb)
+                    var_size_bmc(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, y_mb, mi_ctx->log2_mb_size, td->alpha,
+                                 slice_start, slice_end);
+
+                bilateral_obmc(mi_ctx, block, mb_x, mb_y, td->alpha, slice_start, slice_end);
+            }
+        }
+    }
+
+    set_frame_data(mi_ctx, td->alpha, td->avf_out, slice_start, slice_end);
+
+    return 0;
+}
+
 static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -1126,34 +1277,17 @@ static void interpolate(AVFilterLink *inlink, AVFrame *avf_out)
             }
 
             break;
-        case MI_MODE_MCI:
-            if (mi_ctx->me_mode == ME_MODE_BIDIR) {
-                bidirectional_obmc(mi_ctx, alpha);
-                set_frame_data(mi_ctx, alpha, avf_out);
-
-            } else if (mi_ctx->me_mode == ME_MODE_BILAT) {
-                int mb_x, mb_y;
-                Block *block;
-
-                for (y = 0; y < mi_ctx->frames[0].avf->height; y++)
-                    for (x = 0; x < mi_ctx->frames[0].avf->width; x++)
-                        mi_ctx->pixel_refs[x + y * mi_ctx->frames[0].avf->width].nb = 0;
-
-                for (mb_y = 0; mb_y < mi_ctx->b_height; mb_y++)
-                    for (mb_x = 0; mb_x < mi_ctx->b_width; mb_x++) {
-                        block = &mi_ctx->int_blocks[mb_x + mb_y * mi_ctx->b_width];
-
-                        if (block->sb)
-                            var_size_bmc(mi_ctx, block, mb_x << mi_ctx->log2_mb_size, mb_y << mi_ctx->log2_mb_size, mi_ctx->log2_mb_size, alpha);
-
-                        bilateral_obmc(mi_ctx, block, mb_x, mb_y, alpha);
-
-                    }
+        case MI_MODE_MCI: {
+            ThreadData td;
 
-                set_frame_data(mi_ctx, alpha, avf_out);
-            }
+            td.avf_out = avf_out;
+            td.alpha = alpha;
+            ff_filter_execute(ctx, interpolate_slice, &td, NULL,
+                              FFMIN(AV_CEIL_RSHIFT(avf_out->height, mi_ctx->log2_chroma_h),
+                                    ff_filter_get_nb_threads(ctx)));
 
             break;
+        }
     }
 }
 
@@ -1208,6 +1342,19 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *avf_in)
     return 0;
 }
 
+static av_cold int init(AVFilterContext *ctx)
+{
+    MIContext *mi_ctx = ctx->priv;
+    int ret;
+
+    if ((ret = ff_mutex_init(&mi_ctx->progress_lock, NULL)))
+        return AVERROR(ret);
+    if ((ret = ff_cond_init(&mi_ctx->progress_cond, NULL)))
+        return AVERROR(ret);
+
+    return 0;
+}
+
 static av_cold void free_blocks(Block *block, int sb)
 {
     if (block->subs)
@@ -1224,6 +1371,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&mi_ctx->pixel_mvs);
     av_freep(&mi_ctx->pixel_weights);
     av_freep(&mi_ctx->pixel_refs);
+    av_freep(&mi_ctx->mb_row_progress);
     if (mi_ctx->int_blocks)
         for (m = 0; m < mi_ctx->b_count; m++)
             free_blocks(&mi_ctx->int_blocks[m], 0);
@@ -1237,6 +1385,9 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < 3; i++)
         av_freep(&mi_ctx->mv_table[i]);
+
+    ff_cond_destroy(&mi_ctx->progress_cond);
+    ff_mutex_destroy(&mi_ctx->progress_lock);
 }
 
 static const AVFilterPad minterpolate_inputs[] = {
@@ -1260,7 +1411,9 @@ const FFFilter ff_vf_minterpolate = {
     .p.name        = "minterpolate",
     .p.description = NULL_IF_CONFIG_SMALL("Frame rate conversion using Motion Interpolation."),
     .p.priv_class  = &minterpolate_class,
+    .p.flags       = AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(MIContext),
+    .init          = init,
     .uninit        = uninit,
     FILTER_INPUTS(minterpolate_inputs),
     FILTER_OUTPUTS(minterpolate_outputs),
@@ -478,6 +478,7 @@ const FFFilter ff_vf_nlmeans = {
     .p.priv_class  = &nlmeans_class,
     .p.flags       = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(NLMeansContext),
+    .flags_internal = FF_FILTER_FLAG_FRAME_THREADS,
     .init          = init,
     .uninit        = uninit,
     FILTER_INPUTS(nlmeans_inputs),
@@ -84,6 +84,10 @@ static av_cold void uninit(AVFilterContext *ctx)
     ff_framesync_uninit(&s->fs);
     av_expr_free(s->x_pexpr); s->x_pexpr = NULL;
     av_expr_free(s->y_pexpr); s->y_pexpr = NULL;
+#if CONFIG_SWSCALE
+    sws_free_context(&s->sws);
+#endif
+    av_frame_free(&s->band);
 }
 
 static inline int normalize_xy(double d, int chroma_sub)
@@ -274,14 +278,34 @@ static int query_formats(const AVFilterContext *ctx,
         overlay_formats = overlay_pix_fmts_gbrp;
         break;
     case OVERLAY_FORMAT_AUTO:
-        return ff_set_pixel_formats_from_list2(ctx, cfg_in, cfg_out, alpha_pix_fmts);
+        if (!s->scale_w)
+            return ff_set_pixel_formats_from_list2(ctx, cfg_in, cfg_out, alpha_pix_fmts);
+        main_formats = overlay_formats = alpha_pix_fmts;
+        break;
     default:
         av_assert0(0);
     }
 
     formats = ff_make_pixel_format_list(main_formats);
-    if ((ret = ff_formats_ref(formats, &cfg_in[MAIN]->formats)) < 0 ||
-        (ret = ff_formats_ref(formats, &cfg_out[MAIN]->formats)) < 0)
+    if ((ret = ff_formats_ref(formats, &cfg_out[MAIN]->formats)) < 0)
+        return ret;
+
+#if CONFIG_SWSCALE
+    /* The fused scaler converts from anything to the blending format */
+    if (s->scale_w) {
+        const AVPixFmtDescriptor *desc = NULL;
+
+        formats = NULL;
+        while ((desc = av_pix_fmt_desc_next(desc))) {
+            enum AVPixelFormat pix_fmt = av_pix_fmt_desc_get_id(desc);
+            if (sws_test_format(pix_fmt, 0) &&
+                (ret = ff_add_format(&formats, pix_fmt)) < 0)
+                return ret;
+        }
+    }
+#endif
+
+    if ((ret = ff_formats_ref(formats, &cfg_in[MAIN]->formats)) < 0)
         return ret;
 
     return ff_formats_ref(ff_make_pixel_format_list(overlay_formats),
@@ -299,8 +323,8 @@ static int config_input_overlay(AVFilterLink *inlink)
 
     /* Finish the configuration by evaluating the expressions
        now when both inputs are configured. */
-    s->var_values[VAR_MAIN_W   ] = s->var_values[VAR_MW] = ctx->inputs[MAIN   ]->w;
-    s->var_values[VAR_MAIN_H   ] = s->var_values[VAR_MH] = ctx->inputs[MAIN   ]->h;
+    s->var_values[VAR_MAIN_W   ] = s->var_values[VAR_MW] = s->scale_w ? s->scale_w : ctx->inputs[MAIN]->w;
+    s->var_values[VAR_MAIN_H   ] = s->var_values[VAR_MH] = s->scale_h ? s->scale_h : ctx->inputs[MAIN]->h;
     s->var_values[VAR_OVERLAY_W] = s->var_values[VAR_OW] = ctx->inputs[OVERLAY]->w;
     s->var_values[VAR_OVERLAY_H] = s->var_values[VAR_OH] = ctx->inputs[OVERLAY]->h;
     s->var_values[VAR_HSUB]  = 1<<pix_desc->log2_chroma_w;
@@ -334,18 +358,76 @@ static int config_input_overlay(AVFilterLink *inlink)
     return 0;
 }
 
+#if CONFIG_SWSCALE
+static int config_scaler(AVFilterContext *ctx)
+{
+    OverlayContext *s = ctx->priv;
+    const AVFilterLink *inlink  = ctx->inputs[MAIN];
+    const AVFilterLink *outlink = ctx->outputs[0];
+    int ret;
+
+    sws_free_context(&s->sws);
+    s->sws = sws_alloc_context();
+    if (!s->sws)
+        return AVERROR(ENOMEM);
+
+    av_opt_set_int(s->sws, "srcw",       inlink->w,       0);
+    av_opt_set_int(s->sws, "srch",       inlink->h,       0);
+    av_opt_set_int(s->sws, "src_format", inlink->format,  0);
+    av_opt_set_int(s->sws, "dstw",       outlink->w,      0);
+    av_opt_set_int(s->sws, "dsth",       outlink->h,      0);
+    av_opt_set_int(s->sws, "dst_format", outlink->format, 0);
+    av_opt_set_int(s->sws, "threads",    ff_filter_get_nb_threads(ctx), 0);
+    if (s->sws_flags && (ret = av_opt_set(s->sws, "sws_flags", s->sws_flags, 0)) < 0)
+        return ret;
+
+    ret = sws_init_context(s->sws, NULL, NULL);
+    if (ret < 0)
+        return ret;
+
+    if (inlink->colorspace != AVCOL_SPC_UNSPECIFIED) {
+        const int *coeffs = sws_getCoefficients(inlink->colorspace);
+        sws_setColorspaceDetails(s->sws,
+                                 coeffs, inlink->color_range  == AVCOL_RANGE_JPEG,
+                                 coeffs, outlink->color_range == AVCOL_RANGE_JPEG,
+                                 0, 1 << 16, 1 << 16);
+    }
+
+    if (!s->band && !(s->band = av_frame_alloc()))
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+#endif
+
 static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     OverlayContext *s = ctx->priv;
+    const AVFilterLink *inlink = ctx->inputs[MAIN];
     int ret;
 
     if ((ret = ff_framesync_init_dualinput(&s->fs, ctx)) < 0)
         return ret;
 
-    outlink->w = ctx->inputs[MAIN]->w;
-    outlink->h = ctx->inputs[MAIN]->h;
-    outlink->time_base = ctx->inputs[MAIN]->time_base;
+    outlink->w = inlink->w;
+    outlink->h = inlink->h;
+    outlink->time_base = inlink->time_base;
+
+#if CONFIG_SWSCALE
+    if (s->scale_w) {
+        outlink->w = s->scale_w;
+        outlink->h = s->scale_h;
+        if (inlink->sample_aspect_ratio.num) {
+            AVRational q = av_div_q((AVRational){ inlink->w, inlink->h },
+                                    (AVRational){ outlink->w, outlink->h });
+            outlink->sample_aspect_ratio = av_mul_q(q, inlink->sample_aspect_ratio);
+        }
+
+        if ((ret = config_scaler(ctx)) < 0)
+            return ret;
+    }
+#endif
 
     return ff_framesync_configure(&s->fs);
 }
@@ -742,7 +824,10 @@ DEFINE_BLEND_SLICE_PACKED_FMT(rgba_pp, rgb, 1, 0, 0)
 static int config_input_main(AVFilterLink *inlink)
 {
     OverlayContext *s = inlink->dst->priv;
-    const AVPixFmtDescriptor *pix_desc = av_pix_fmt_desc_get(inlink->format);
+    /* With fused scaling, the overlay is blended onto the converted output */
+    const enum AVPixelFormat format = s->scale_w ? inlink->dst->outputs[0]->format
+                                                 : inlink->format;
+    const AVPixFmtDescriptor *pix_desc = av_pix_fmt_desc_get(format);
 
     av_image_fill_max_pixsteps(s->main_pix_step,    NULL, pix_desc);
 
@@ -752,8 +837,8 @@ static int config_input_main(AVFilterLink *inlink)
     s->main_desc = pix_desc;
 
     s->main_is_packed_rgb =
-        ff_fill_rgba_map(s->main_rgba_map, inlink->format) >= 0;
-    s->main_has_alpha = ff_pixfmt_is_in(inlink->format, alpha_pix_fmts);
+        ff_fill_rgba_map(s->main_rgba_map, format) >= 0;
+    s->main_has_alpha = ff_pixfmt_is_in(format, alpha_pix_fmts);
     return 0;
 }
 
@@ -800,7 +885,7 @@ static int init_slice_fn(AVFilterContext *ctx)
         ASSIGN_BLEND_SLICE(blend_slice_gbrp);
         break;
     case OVERLAY_FORMAT_AUTO:
-        switch (main->format) {
+        switch (ctx->outputs[0]->format) {
         case AV_PIX_FMT_YUVA420P:
             ASSIGN_BLEND_SLICE(blend_slice_yuv420);
             break;
@@ -842,6 +927,64 @@ static int init_slice_fn(AVFilterContext *ctx)
     return 0;
 }
 
+static int blend_nb_jobs(AVFilterContext *ctx, const AVFrame *dst,
+                         const AVFrame *src)
+{
+    const OverlayContext *s = ctx->priv;
+    return FFMIN(FFMAX(1, FFMIN3(s->y + src->height, FFMIN(src->height, dst->height), dst->height - s->y)),
+                 ff_filter_get_nb_threads(ctx));
+}
+
+#if CONFIG_SWSCALE
+/**
+ * Scale the main picture into out one band of lines at a time, blending the
+ * overlay (if any) into each band while it is still in the cache, instead of
+ * writing out the whole scaled frame and reading it back for blending.
+ */
+static int scale_blend(AVFilterContext *ctx, AVFrame *out, const AVFrame *in,
+                       const AVFrame *second)
+{
+    OverlayContext *s = ctx->priv;
+    const int align = sws_receive_slice_alignment(s->sws);
+    const int band_h = out->height % align ? out->height : FFALIGN(s->band_h, align);
+    const int y = s->y;
+    int ret;
+
+    ret = sws_frame_start(s->sws, out, in);
+    if (ret < 0)
+        return ret;
+
+    ret = sws_send_slice(s->sws, 0, in->height);
+    for (int band_y = 0; ret >= 0 && band_y < out->height; band_y += band_h) {
+        const int h = FFMIN(band_h, out->height - band_y);
+        ThreadData td;
+
+        ret = sws_receive_slice(s->sws, band_y, h);
+        if (ret < 0 || !second || y >= band_y + h || y + second->height <= band_y)
+            continue;
+
+        for (int i = 0; i < FF_ARRAY_ELEMS(s->band->data) && out->data[i]; i++) {
+            const int vsub = (i == 1 || i == 2) ? s->vsub : 0;
+            s->band->data[i]     = out->data[i] + (band_y >> vsub) * out->linesize[i];
+            s->band->linesize[i] = out->linesize[i];
+        }
+        s->band->width  = out->width;
+        s->band->height = h;
+
+        /* The blend functions position the overlay relative to td.dst */
+        s->y   = y - band_y;
+        td.dst = s->band;
+        td.src = (AVFrame *) second;
+        ff_filter_execute(ctx, s->blend_slice, &td, NULL,
+                          blend_nb_jobs(ctx, s->band, second));
+        s->y = y;
+    }
+
+    sws_frame_end(s->sws);
+    return ret;
+}
+#endif
+
 static int do_blend(FFFrameSync *fs)
 {
     AVFilterContext *ctx = fs->parent;
@@ -851,10 +994,11 @@ static int do_blend(FFFrameSync *fs)
     FilterLink *inl = ff_filter_link(inlink);
     int ret;
 
-    ret = ff_framesync_dualinput_get_writable(fs, &mainpic, &second);
+    ret = s->sws ? ff_framesync_dualinput_get(fs, &mainpic, &second)
+                 : ff_framesync_dualinput_get_writable(fs, &mainpic, &second);
     if (ret < 0)
         return ret;
-    if (!second)
+    if (!second && !s->sws)
         return ff_filter_frame(ctx->outputs[0], mainpic);
 
     if (s->eval_mode == EVAL_MODE_FRAME) {
@@ -863,10 +1007,12 @@ static int do_blend(FFFrameSync *fs)
         s->var_values[VAR_T] = mainpic->pts == AV_NOPTS_VALUE ?
             NAN : mainpic->pts * av_q2d(inlink->time_base);
 
-        s->var_values[VAR_OVERLAY_W] = s->var_values[VAR_OW] = second->width;
-        s->var_values[VAR_OVERLAY_H] = s->var_values[VAR_OH] = second->height;
-        s->var_values[VAR_MAIN_W   ] = s->var_values[VAR_MW] = mainpic->width;
-        s->var_values[VAR_MAIN_H   ] = s->var_values[VAR_MH] = mainpic->height;
+        if (second) {
+            s->var_values[VAR_OVERLAY_W] = s->var_values[VAR_OW] = second->width;
+            s->var_values[VAR_OVERLAY_H] = s->var_values[VAR_OH] = second->height;
+        }
+        s->var_values[VAR_MAIN_W   ] = s->var_values[VAR_MW] = s->scale_w ? s->scale_w : mainpic->width;
+        s->var_values[VAR_MAIN_H   ] = s->var_values[VAR_MH] = s->scale_h ? s->scale_h : mainpic->height;
 
         eval_expr(ctx);
         av_log(ctx, AV_LOG_DEBUG, "n:%f t:%f x:%f xi:%d y:%f yi:%d\n",
@@ -875,6 +1021,40 @@ static int do_blend(FFFrameSync *fs)
                s->var_values[VAR_Y], s->y);
     }
 
+#if CONFIG_SWSCALE
+    if (s->sws) {
+        AVFilterLink *outlink = ctx->outputs[0];
+        AVFrame *out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
+        if (!out) {
+            av_frame_free(&mainpic);
+            return AVERROR(ENOMEM);
+        }
+        ret = av_frame_copy_props(out, mainpic);
+        if (ret < 0)
+            goto fail;
+        out->sample_aspect_ratio = outlink->sample_aspect_ratio;
+        out->color_range         = outlink->color_range;
+        out->colorspace          = outlink->colorspace;
+
+        if (second && !(s->x < out->width  && s->x + second->width  >= 0 &&
+                        s->y < out->height && s->y + second->height >= 0))
+            second = NULL;
+        if (second)
+            init_slice_fn(ctx);
+
+        ret = scale_blend(ctx, out, mainpic, second);
+        if (ret < 0)
+            goto fail;
+
+        av_frame_free(&mainpic);
+        return ff_filter_frame(outlink, out);
+fail:
+        av_frame_free(&out);
+        av_frame_free(&mainpic);
+        return ret;
+    }
+#endif
+
     if (s->x < mainpic->width  && s->x + second->width  >= 0 &&
         s->y < mainpic->height && s->y + second->height >= 0) {
         ThreadData td;
@@ -883,8 +1063,8 @@ static int do_blend(FFFrameSync *fs)
 
         td.dst = mainpic;
         td.src = second;
-        ff_filter_execute(ctx, s->blend_slice, &td, NULL, FFMIN(FFMAX(1, FFMIN3(s->y + second->height, FFMIN(second->height, mainpic->height), mainpic->height - s->y)),
-                                                                ff_filter_get_nb_threads(ctx)));
+        ff_filter_execute(ctx, s->blend_slice, &td, NULL,
+                          blend_nb_jobs(ctx, mainpic, second));
     }
     return ff_filter_frame(ctx->outputs[0], mainpic);
 }
@@ -893,6 +1073,11 @@ static av_cold int init(AVFilterContext *ctx)
 {
     OverlayContext *s = ctx->priv;
 
+    if (!CONFIG_SWSCALE && s->scale_w) {
+        av_log(ctx, AV_LOG_ERROR, "Scaling the main input requires libswscale\n");
+        return AVERROR(EINVAL);
+    }
+
     s->fs.on_event = do_blend;
     return 0;
 }
@@ -936,6 +1121,10 @@ static const AVOption overlay_options[] = {
         { "unknown",       "", 0, AV_OPT_TYPE_CONST, {.i64=AVALPHA_MODE_UNSPECIFIED},   .flags = FLAGS, .unit = "alpha_mode" },
         { "straight",      "", 0, AV_OPT_TYPE_CONST, {.i64=AVALPHA_MODE_STRAIGHT},      .flags = FLAGS, .unit = "alpha_mode" },
         { "premultiplied", "", 0, AV_OPT_TYPE_CONST, {.i64=AVALPHA_MODE_PREMULTIPLIED}, .flags = FLAGS, .unit = "alpha_mode" },
+    { "size", "scale the main input to this size while blending", OFFSET(scale_w), AV_OPT_TYPE_IMAGE_SIZE, {.str=NULL}, 0, 0, FLAGS },
+    { "s",    "scale the main input to this size while blending", OFFSET(scale_w), AV_OPT_TYPE_IMAGE_SIZE, {.str=NULL}, 0, 0, FLAGS },
+    { "sws_flags", "set the libswscale flags used for scaling the main input", OFFSET(sws_flags), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
+    { "band_h", "set the number of lines scaled and blended at once", OFFSET(band_h), AV_OPT_TYPE_INT, {.i64=64}, 1, INT_MAX, FLAGS },
     { NULL }
 };
 
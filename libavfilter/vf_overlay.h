@@ -20,7 +20,9 @@
 #define AVFILTER_OVERLAY_H
 
 #include "libavutil/eval.h"
+#include "libavutil/frame.h"
 #include "libavutil/pixdesc.h"
+#include "libswscale/swscale.h"
 #include "framesync.h"
 #include "avfilter.h"
 
@@ -77,6 +79,12 @@ typedef struct OverlayContext {
 
     AVExpr *x_pexpr, *y_pexpr;
 
+    int scale_w, scale_h;       ///< size the main input is scaled to, 0 to disable
+    char *sws_flags;            ///< flags for the fused main input scaler
+    int band_h;                 ///< number of lines scaled and blended at once
+    SwsContext *sws;            ///< fused main input scaler, or NULL
+    AVFrame *band;              ///< view of the output band being blended
+
     int (*blend_row[4])(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a, int w,
                         ptrdiff_t alinesize);
     int (*blend_slice)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
@@ -83,6 +83,10 @@ typedef struct PaletteGenContext {
     int nb_boxes;                           // number of boxes (increase will segmenting them)
     int palette_pushed;                     // if the palette frame is pushed into the outlink or not
     uint8_t transparency_color[4];          // background color for transparency
+
+    int nb_jobs;                            // number of slices the histogram is built in
+    struct hist_node *slice_histograms;     // histogram of each slice, merged into histogram
+    int *job_ret;                           // return value of each slice job
 } PaletteGenContext;
 
 #define OFFSET(x) offsetof(PaletteGenContext, x)
@@ -462,6 +466,100 @@ static int update_histogram_frame(struct hist_node *hist, const AVFrame *f)
     return nb_diff_colors;
 }
 
+typedef struct ThreadData {
+    const AVFrame *in, *prev;
+} ThreadData;
+
+static int update_histogram_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteGenContext *s = ctx->priv;
+    ThreadData *td = arg;
+    struct hist_node *hist = s->slice_histograms + jobnr * HIST_SIZE;
+    const int slice_start = (td->in->height *  jobnr     ) / nb_jobs;
+    const int slice_end   = (td->in->height * (jobnr + 1)) / nb_jobs;
+    AVFrame f1 = *td->in, f2;
+
+    f1.data[0] += slice_start * f1.linesize[0];
+    f1.height   = slice_end - slice_start;
+    if (!td->prev)
+        return update_histogram_frame(hist, &f1);
+
+    f2 = *td->prev;
+    f2.data[0] += slice_start * f2.linesize[0];
+    f2.height   = f1.height;
+    return update_histogram_diff(hist, &f2, &f1);
+}
+
+/**
+ * Add the colors of the slice histograms to the main one, for a range of
+ * hash buckets. The slices are merged in order, so that the colors of each
+ * bucket end up in the same order as with a single slice.
+ */
+static int merge_histograms(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteGenContext *s = ctx->priv;
+    const int start = (HIST_SIZE *  jobnr     ) / nb_jobs;
+    const int end   = (HIST_SIZE * (jobnr + 1)) / nb_jobs;
+    int nb_new = 0;
+
+    for (int j = start; j < end; j++) {
+        struct hist_node *node = &s->histogram[j];
+
+        for (int n = 0; n < s->nb_jobs; n++) {
+            struct hist_node *slice_node = &s->slice_histograms[n * HIST_SIZE + j];
+
+            for (int k = 0; k < slice_node->nb_entries; k++) {
+                const struct color_ref *ref = &slice_node->entries[k];
+                struct color_ref *e = NULL;
+
+                for (int i = 0; i < node->nb_entries; i++) {
+                    if (node->entries[i].color == ref->color) {
+                        e = &node->entries[i];
+                        break;
+                    }
+                }
+                if (e) {
+                    e->count += ref->count;
+                    continue;
+                }
+
+                e = av_dynarray2_add((void**)&node->entries, &node->nb_entries,
+                                     sizeof(*node->entries), (const uint8_t *)ref);
+                if (!e)
+                    return AVERROR(ENOMEM);
+                nb_new++;
+            }
+            slice_node->nb_entries = 0;
+        }
+    }
+
+    return nb_new;
+}
+
+static int update_histogram(AVFilterContext *ctx, const AVFrame *in)
+{
+    PaletteGenContext *s = ctx->priv;
+    ThreadData td = { .in = in, .prev = s->prev_frame };
+    int nb_diff_colors = 0;
+
+    if (s->nb_jobs == 1)
+        return s->prev_frame ? update_histogram_diff(s->histogram, s->prev_frame, in)
+                             : update_histogram_frame(s->histogram, in);
+
+    ff_filter_execute(ctx, update_histogram_slice, &td, s->job_ret, s->nb_jobs);
+    for (int i = 0; i < s->nb_jobs; i++)
+        if (s->job_ret[i] < 0)
+            return s->job_ret[i];
+
+    ff_filter_execute(ctx, merge_histograms, NULL, s->job_ret, s->nb_jobs);
+    for (int i = 0; i < s->nb_jobs; i++) {
+        if (s->job_ret[i] < 0)
+            return s->job_ret[i];
+        nb_diff_colors += s->job_ret[i];
+    }
+    return nb_diff_colors;
+}
+
 /**
  * Update the histogram for each passing frame. No frame will be pushed here.
  */
@@ -474,8 +572,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     if (in->color_trc != AVCOL_TRC_UNSPECIFIED && in->color_trc != AVCOL_TRC_IEC61966_2_1)
         av_log(ctx, AV_LOG_WARNING, "The input frame is not in sRGB, colors may be off\n");
 
-    ret = s->prev_frame ? update_histogram_diff(s->histogram, s->prev_frame, in)
-                        : update_histogram_frame(s->histogram, in);
+    ret = update_histogram(ctx, in);
     if (ret > 0)
         s->nb_refs += ret;
 
@@ -523,6 +620,22 @@ static int request_frame(AVFilterLink *outlink)
     return r;
 }
 
+static int config_input(AVFilterLink *inlink)
+{
+    AVFilterContext *ctx = inlink->dst;
+    PaletteGenContext *s = ctx->priv;
+
+    s->nb_jobs = FFMAX(1, FFMIN(inlink->h, ff_filter_get_nb_threads(ctx)));
+    if (s->nb_jobs == 1)
+        return 0;
+
+    s->slice_histograms = av_calloc(s->nb_jobs * HIST_SIZE, sizeof(*s->slice_histograms));
+    s->job_ret          = av_calloc(s->nb_jobs, sizeof(*s->job_ret));
+    if (!s->slice_histograms || !s->job_ret)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
 /**
  * The output is one simple 16x16 squared-pixels palette.
  */
@@ -552,6 +665,12 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     for (i = 0; i < HIST_SIZE; i++)
         av_freep(&s->histogram[i].entries);
+    if (s->slice_histograms) {
+        for (i = 0; i < s->nb_jobs * HIST_SIZE; i++)
+            av_freep(&s->slice_histograms[i].entries);
+    }
+    av_freep(&s->slice_histograms);
+    av_freep(&s->job_ret);
     av_freep(&s->refs);
     av_frame_free(&s->prev_frame);
 }
@@ -560,6 +679,7 @@ static const AVFilterPad palettegen_inputs[] = {
     {
         .name         = "default",
         .type         = AVMEDIA_TYPE_VIDEO,
+        .config_props = config_input,
         .filter_frame = filter_frame,
     },
 };
@@ -577,6 +697,7 @@ const FFFilter ff_vf_palettegen = {
     .p.name        = "palettegen",
     .p.description = NULL_IF_CONFIG_SMALL("Find the optimal palette for a given stream."),
     .p.priv_class  = &palettegen_class,
+    .p.flags       = AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(PaletteGenContext),
     .init          = init,
     .uninit        = uninit,
@@ -24,12 +24,15 @@
  * Use a palette to downsample an input video stream.
  */
 
+#include <stdatomic.h>
+
 #include "libavutil/bprint.h"
 #include "libavutil/file_open.h"
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/qsort.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "formats.h"
@@ -70,6 +73,13 @@ struct color_node {
 
 #define CACHE_SIZE (1<<15)
 
+/* columns processed between two progress reports in error diffusion */
+#define DIFFUSION_CHUNK 16
+/* distance a row stays behind the one above it in error diffusion: the error
+ * of a pixel reaches 2 columns on each side in the next row, and the two rows
+ * must not update the same pixels concurrently */
+#define DIFFUSION_LAG 5
+
 struct cached_color {
     uint32_t color;
     uint8_t pal_entry;
@@ -82,13 +92,16 @@ struct cache_node {
 
 struct PaletteUseContext;
 
-typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                              int x_start, int y_start, int width, int height);
+typedef int (*set_frame_func)(struct PaletteUseContext *s, struct cache_node *cache,
+                              AVFrame *out, AVFrame *in,
+                              int x_start, int y_start, int width, int height,
+                              int slice_x, int slice_y, int slice_w, int slice_h);
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFFrameSync fs;
-    struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node *cache;               /* lookup cache of each job, CACHE_SIZE entries each */
+    int nb_jobs;
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
     uint32_t palette[AVPALETTE_COUNT];
     int transparency_index; /* index in the palette of transparency. -1 if there is no transparency in the palette. */
@@ -103,6 +116,11 @@ typedef struct PaletteUseContext {
     AVFrame *last_in;
     AVFrame *last_out;
 
+    int *job_ret;               /* return value of each job */
+    atomic_int *row_progress;   /* number of dithered pixels in each row */
+    AVMutex progress_lock;
+    AVCond progress_cond;
+
     /* debug options */
     char *dot_filename;
     int calc_mean_err;
@@ -239,11 +257,12 @@ struct stack_node {
  * Check if the requested color is in the cache already. If not, find it in the
  * color tree and cache it.
  */
-static av_always_inline int color_get(PaletteUseContext *s, uint32_t color)
+static av_always_inline int color_get(PaletteUseContext *s, struct cache_node *cache,
+                                      uint32_t color)
 {
     struct color_info clrinfo;
     const uint32_t hash = ff_lowbias32(color) & (CACHE_SIZE - 1);
-    struct cache_node *node = &s->cache[hash];
+    struct cache_node *node = &cache[hash];
     struct cached_color *e;
 
     // first, check for transparency
@@ -268,11 +287,11 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color)
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(PaletteUseContext *s,
+static av_always_inline int get_dst_color_err(PaletteUseContext *s, struct cache_node *cache,
                                               uint32_t c, int *er, int *eg, int *eb)
 {
     uint32_t dstc;
-    const int dstx = color_get(s, c);
+    const int dstx = color_get(s, cache, c);
     if (dstx < 0)
         return dstx;
     dstc = s->palette[dstx];
@@ -289,20 +308,26 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     return dstx;
 }
 
-static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
+/**
+ * Map the slice_w x slice_h pixels at (slice_x, slice_y) of the w x h area at
+ * (x_start, y_start) to the palette. The area bounds the error diffusion.
+ */
+static av_always_inline int set_frame(PaletteUseContext *s, struct cache_node *cache,
+                                      AVFrame *out, AVFrame *in,
                                       int x_start, int y_start, int w, int h,
+                                      int slice_x, int slice_y, int slice_w, int slice_h,
                                       enum dithering_mode dither)
 {
     const int src_linesize = in ->linesize[0] >> 2;
     const int dst_linesize = out->linesize[0];
-    uint32_t *src = ((uint32_t *)in ->data[0]) + y_start*src_linesize;
-    uint8_t  *dst =              out->data[0]  + y_start*dst_linesize;
+    uint32_t *src = ((uint32_t *)in ->data[0]) + slice_y*src_linesize;
+    uint8_t  *dst =              out->data[0]  + slice_y*dst_linesize;
 
     w += x_start;
     h += y_start;
 
-    for (int y = y_start; y < h; y++) {
-        for (int x = x_start; x < w; x++) {
+    for (int y = slice_y; y < slice_y + slice_h; y++) {
+        for (int x = slice_x; x < slice_x + slice_w; x++) {
             int er, eg, eb;
 
             if (dither == DITHERING_BAYER) {
@@ -315,7 +340,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t g = av_clip_uint8(g8 + d);
                 const uint8_t b = av_clip_uint8(b8 + d);
                 const uint32_t color_new = (unsigned)(a8) << 24 | r << 16 | g << 8 | b;
-                const int color = color_get(s, color_new);
+                const int color = color_get(s, cache, color_new);
 
                 if (color < 0)
                     return color;
@@ -323,7 +348,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -335,7 +360,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -349,7 +374,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -368,7 +393,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -381,7 +406,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA3) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2, down2 = y < h - 2, left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -407,7 +432,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_BURKES) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -427,7 +452,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_ATKINSON) {
                 const int right  = x < w - 1, down  = y < h - 1, left = x > x_start;
                 const int right2 = x < w - 2, down2 = y < h - 2;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb);
 
                 if (color < 0)
                     return color;
@@ -444,7 +469,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 }
 
             } else {
-                const int color = color_get(s, src[x]);
+                const int color = color_get(s, cache, src[x]);
 
                 if (color < 0)
                     return color;
@@ -767,6 +792,75 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x, y, w, h;             /* area to process */
+    atomic_int next_row;
+} ThreadData;
+
+static void await_row(PaletteUseContext *s, int y, int nb_pixels)
+{
+    if (atomic_load_explicit(&s->row_progress[y], memory_order_acquire) >= nb_pixels)
+        return;
+
+    ff_mutex_lock(&s->progress_lock);
+    while (atomic_load_explicit(&s->row_progress[y], memory_order_acquire) < nb_pixels)
+        ff_cond_wait(&s->progress_cond, &s->progress_lock);
+    ff_mutex_unlock(&s->progress_lock);
+}
+
+static void report_row(PaletteUseContext *s, int y, int nb_pixels)
+{
+    ff_mutex_lock(&s->progress_lock);
+    atomic_store_explicit(&s->row_progress[y], nb_pixels, memory_order_release);
+    ff_cond_broadcast(&s->progress_cond);
+    ff_mutex_unlock(&s->progress_lock);
+}
+
+/**
+ * Without error diffusion, the pixels are mapped independently and the area is
+ * split in static slices. With error diffusion, rows are claimed in order by
+ * whichever job is free and each row stays DIFFUSION_LAG pixels behind the row
+ * above it, so that the errors add up in the same order as in a single pass.
+ * A claimed row is always being processed by a running job, thus the wait
+ * cannot deadlock whatever the job order.
+ */
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    struct cache_node *cache = s->cache + jobnr * CACHE_SIZE;
+    int ret = 0;
+
+    if (s->dither == DITHERING_NONE || s->dither == DITHERING_BAYER) {
+        const int slice_start = (td->h *  jobnr     ) / nb_jobs;
+        const int slice_end   = (td->h * (jobnr + 1)) / nb_jobs;
+
+        return s->set_frame(s, cache, td->out, td->in, td->x, td->y, td->w, td->h,
+                            td->x, td->y + slice_start, td->w, slice_end - slice_start);
+    }
+
+    while (1) {
+        const int y = atomic_fetch_add_explicit(&td->next_row, 1, memory_order_relaxed);
+
+        if (y >= td->h)
+            break;
+
+        for (int x = 0; x < td->w; x += DIFFUSION_CHUNK) {
+            const int chunk_w = FFMIN(DIFFUSION_CHUNK, td->w - x);
+
+            if (y)
+                await_row(s, y - 1, FFMIN(x + chunk_w - 1 + DIFFUSION_LAG, td->w));
+            /* keep reporting after an error, for the rows below not to wait */
+            if (!ret)
+                ret = s->set_frame(s, cache, td->out, td->in, td->x, td->y, td->w, td->h,
+                                   td->x + x, td->y + y, chunk_w, 1);
+            report_row(s, y, x + chunk_w);
+        }
+    }
+    return ret;
+}
+
 static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 {
     int x, y, w, h, ret;
@@ -795,7 +889,19 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    ret = s->set_frame(s, out, in, x, y, w, h);
+    if (s->nb_jobs > 1) {
+        ThreadData td = { .in = in, .out = out, .x = x, .y = y, .w = w, .h = h };
+
+        for (int i = 0; i < h; i++)
+            atomic_store_explicit(&s->row_progress[i], 0, memory_order_relaxed);
+        atomic_init(&td.next_row, 0);
+        ff_filter_execute(ctx, set_frame_slice, &td, s->job_ret, s->nb_jobs);
+        ret = 0;
+        for (int i = 0; i < s->nb_jobs && !ret; i++)
+            ret = FFMIN(s->job_ret[i], 0);
+    } else {
+        ret = s->set_frame(s, s->cache, out, in, x, y, w, h, x, y, w, h);
+    }
     if (ret < 0) {
         av_frame_free(&out);
         *outf = NULL;
@@ -822,6 +928,17 @@ static int config_output(AVFilterLink *outlink)
     outlink->w = ctx->inputs[0]->w;
     outlink->h = ctx->inputs[0]->h;
 
+    s->nb_jobs = FFMAX(1, FFMIN(outlink->h, ff_filter_get_nb_threads(ctx)));
+    s->cache = av_calloc(s->nb_jobs * CACHE_SIZE, sizeof(*s->cache));
+    if (!s->cache)
+        return AVERROR(ENOMEM);
+    if (s->nb_jobs > 1) {
+        s->job_ret      = av_calloc(s->nb_jobs, sizeof(*s->job_ret));
+        s->row_progress = av_calloc(outlink->h, sizeof(*s->row_progress));
+        if (!s->job_ret || !s->row_progress)
+            return AVERROR(ENOMEM);
+    }
+
     outlink->time_base = ctx->inputs[0]->time_base;
     if ((ret = ff_framesync_configure(&s->fs)) < 0)
         return ret;
@@ -854,9 +971,9 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
     if (s->new) {
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
-        for (i = 0; i < CACHE_SIZE; i++)
+        for (i = 0; i < s->nb_jobs * CACHE_SIZE; i++)
             av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+        memset(s->cache, 0, s->nb_jobs * CACHE_SIZE * sizeof(*s->cache));
     }
 
     i = 0;
@@ -904,10 +1021,13 @@ static int load_apply_palette(FFFrameSync *fs)
 }
 
 #define DEFINE_SET_FRAME(name, value)                                           \
-static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
-                            int x_start, int y_start, int w, int h)             \
+static int set_frame_##name(PaletteUseContext *s, struct cache_node *cache,     \
+                            AVFrame *out, AVFrame *in,                          \
+                            int x_start, int y_start, int w, int h,             \
+                            int slice_x, int slice_y, int slice_w, int slice_h) \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value);                \
+    return set_frame(s, cache, out, in, x_start, y_start, w, h,                 \
+                     slice_x, slice_y, slice_w, slice_h, value);                \
 }
 
 DEFINE_SET_FRAME(none,            DITHERING_NONE)
@@ -943,6 +1063,12 @@ static int dither_value(int p)
 static av_cold int init(AVFilterContext *ctx)
 {
     PaletteUseContext *s = ctx->priv;
+    int ret;
+
+    if ((ret = ff_mutex_init(&s->progress_lock, NULL)))
+        return AVERROR(ret);
+    if ((ret = ff_cond_init(&s->progress_cond, NULL)))
+        return AVERROR(ret);
 
     s->last_in  = av_frame_alloc();
     s->last_out = av_frame_alloc();
@@ -972,10 +1098,17 @@ static av_cold void uninit(AVFilterContext *ctx)
     PaletteUseContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
-    for (int i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    if (s->cache) {
+        for (int i = 0; i < s->nb_jobs * CACHE_SIZE; i++)
+            av_freep(&s->cache[i].entries);
+    }
+    av_freep(&s->cache);
+    av_freep(&s->job_ret);
+    av_freep(&s->row_progress);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
+    ff_cond_destroy(&s->progress_cond);
+    ff_mutex_destroy(&s->progress_lock);
 }
 
 static const AVFilterPad paletteuse_inputs[] = {
@@ -1001,6 +1134,7 @@ const FFFilter ff_vf_paletteuse = {
     .p.name        = "paletteuse",
     .p.description = NULL_IF_CONFIG_SMALL("Use a palette to downsample an input video stream."),
     .p.priv_class  = &paletteuse_class,
+    .p.flags       = AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(PaletteUseContext),
     .init          = init,
     .uninit        = uninit,
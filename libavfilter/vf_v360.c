@@ -5098,6 +5098,7 @@ const FFFilter ff_vf_v360 = {
     .p.priv_class  = &v360_class,
     .p.flags       = AVFILTER_FLAG_SLICE_THREADS,
     .priv_size     = sizeof(V360Context),
+    .flags_internal = FF_FILTER_FLAG_FRAME_THREADS,
     .init          = init,
     .uninit        = uninit,
     FILTER_INPUTS(inputs),
@@ -60,6 +60,7 @@ typedef struct XPSNRContext {
     /* XPSNR specific variables */
     double          *sse_luma;
     double          *weights;
+    uint64_t        *sse_chroma;
     int16_t         *buf_org_m1;
     int16_t         *buf_org_m2;
     int16_t         *buf_org   [3];
@@ -144,6 +145,19 @@ static uint64_t diff2nd(const uint32_t w_act, const uint32_t h_act, const int16_
     return (ta_act * XPSNR_GAMMA);
 }
 
+typedef struct ThreadData {
+    const AVFrame  *master, *ref;
+    int16_t       **org;
+    int16_t        *org_m1;
+    int16_t        *org_m2;
+    int16_t       **rec;
+    const int      *stride_org;
+    uint32_t        b; /* luma block size */
+    int             c; /* chroma component */
+} ThreadData;
+
+/* XPSNR function definitions */
+
 static inline uint64_t calc_squared_error(XPSNRContext const *s,
                                           const int16_t *blk_org,     const uint32_t stride_org,
                                           const int16_t *blk_rec,     const uint32_t stride_rec,
@@ -193,8 +207,6 @@ static inline double calc_squared_error_and_weight (XPSNRContext const *s,
     if (b_val > 1) { /* highpass with downsampling */
         if (w_act > 12)
             sa_act = s->dsp.highds_func(x_act, y_act, w_act, h_act, o_m0, o);
-        else
-            highds(x_act, y_act, w_act, h_act, o_m0, o);
     } else { /* <=HD highpass without downsampling */
         for (int y = y_act; y < h_act; y++) {
             for (int x = x_act; x < w_act; x++) {
@@ -266,6 +278,78 @@ static inline double get_avg_xpsnr (const double sqrt_wsse_val,  const double su
     return sum_xpsnr_val / (double) num_frames_64; /* older log-domain average */
 }
 
+static int luma_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    XPSNRContext *const  s = ctx->priv;
+    const ThreadData   *td = arg;
+    const uint32_t       w = s->plane_width [0];
+    const uint32_t       h = s->plane_height[0];
+    const uint32_t       b = td->b;
+    const uint32_t   w_blk = (w + b - 1) / b;
+    const uint32_t   h_blk = (h + b - 1) / b;
+    const uint32_t   start = (h_blk *  jobnr     ) / nb_jobs;
+    const uint32_t     end = (h_blk * (jobnr + 1)) / nb_jobs;
+    const int16_t   *p_org = td->org[0];
+    const uint32_t   s_org = td->stride_org[0] / s->bpp;
+    const int16_t   *p_rec = td->rec[0];
+    const uint32_t   s_rec = s->plane_width[0];
+
+    for (uint32_t y = start * b; y < end * b; y += b) { /* block SSE and perceptual weights */
+        const uint32_t block_height = (y + b > h ? h - y : b);
+        uint32_t idx_blk = (y / b) * w_blk;
+
+        for (uint32_t x = 0; x < w; x += b, idx_blk++) {
+            const uint32_t block_width = (x + b > w ? w - x : b);
+            double ms_act = 1.0;
+
+            s->sse_luma[idx_blk] = calc_squared_error_and_weight(s, p_org, s_org,
+                                                                 td->org_m1 /* pixel  */,
+                                                                 td->org_m2 /* memory */,
+                                                                 p_rec, s_rec,
+                                                                 x, y,
+                                                                 block_width, block_height,
+                                                                 s->depth, s->frame_rate, &ms_act);
+            s->weights[idx_blk] = 1.0 / sqrt(ms_act);
+        }
+    }
+
+    return 0;
+}
+
+static int chroma_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    XPSNRContext *const  s = ctx->priv;
+    const ThreadData   *td = arg;
+    const int            c = td->c;
+    const int16_t   *p_org = td->org[c];
+    const uint32_t   s_org = td->stride_org[c] / s->bpp;
+    const int16_t   *p_rec = td->rec[c];
+    const uint32_t   s_rec = s->plane_width[c];
+    const uint32_t   w_pln = s->plane_width[c];
+    const uint32_t   h_pln = s->plane_height[c];
+    const uint32_t      bx = (td->b * w_pln) / s->plane_width [0];
+    const uint32_t      by = (td->b * h_pln) / s->plane_height[0];
+    const uint32_t   w_blk = (w_pln + bx - 1) / bx;
+    const uint32_t   h_blk = (h_pln + by - 1) / by;
+    const uint32_t   start = (h_blk *  jobnr     ) / nb_jobs;
+    const uint32_t     end = (h_blk * (jobnr + 1)) / nb_jobs;
+
+    for (uint32_t y = start * by; y < end * by; y += by) {
+        const uint32_t block_height = (y + by > h_pln ? h_pln - y : by);
+        uint32_t idx_blk = (y / by) * w_blk;
+
+        for (uint32_t x = 0; x < w_pln; x += bx, idx_blk++) {
+            const uint32_t block_width = (x + bx > w_pln ? w_pln - x : bx);
+
+            s->sse_chroma[idx_blk] = calc_squared_error (s, p_org + y * s_org + x, s_org,
+                                                         p_rec + y * s_rec + x, s_rec,
+                                                         block_width, block_height);
+        }
+    }
+
+    return 0;
+}
+
 static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
                     int16_t *org_m2, int16_t **rec, uint64_t *const wsse64)
 {
@@ -282,6 +366,11 @@ static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
     uint32_t x, y, idx_blk = 0; /* the "16.0" above is due to fixed-point code */
     double *const sse_luma = s->sse_luma;
     double *const  weights = s->weights;
+    const int  nb_threads = ff_filter_get_nb_threads(ctx);
+    ThreadData td = {
+        .org = org, .org_m1 = org_m1, .org_m2 = org_m2, .rec = rec,
+        .stride_org = stride_org, .b = b,
+    };
     int c;
 
     if (!wsse64 || (s->depth < 6) || (s->depth > 16) || (s->num_comps <= 0) ||
@@ -289,35 +378,25 @@ static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
         av_log(ctx, AV_LOG_ERROR, "Error in XPSNR routine: invalid argument(s).\n");
         return AVERROR(EINVAL);
     }
-    if (!weights || (b >= 4 && !sse_luma)) {
+    if (!weights || (b >= 4 && (!sse_luma || (s->num_comps > 1 && !s->sse_chroma)))) {
         av_log(ctx, AV_LOG_ERROR, "Failed to allocate temporary block memory.\n");
         return AVERROR(ENOMEM);
     }
 
     if (b >= 4) {
-        const int16_t *p_org = org[0];
-        const uint32_t s_org = stride_org[0] / s->bpp;
-        const int16_t *p_rec = rec[0];
-        const uint32_t s_rec = s->plane_width[0];
+        const uint32_t h_blk = (h + b - 1) / b;
         double     wsse_luma = 0.0;
+        /* above HD with an odd width, the temporal differences of the last
+         * block of a row also update the first pixel of the next row */
+        const int  nb_jobs = ((w & 1) && w * h > 2048 * 1152 ? 1 : FFMIN(h_blk, nb_threads));
 
-        for (y = 0; y < h; y += b) { /* calculate block SSE and perceptual weights */
-            const uint32_t block_height = (y + b > h ? h - y : b);
+        ff_filter_execute(ctx, luma_slice, &td, NULL, nb_jobs);
+
+        if (w * h <= 640 * 480) { /* "min-smoothing" as in paper, in raster order */
+            for (y = idx_blk = 0; y < h; y += b) {
+                for (x = 0; x < w; x += b, idx_blk++) {
+                    double ms_act_prev;
 
-            for (x = 0; x < w; x += b, idx_blk++) {
-                const uint32_t block_width = (x + b > w ? w - x : b);
-                double ms_act = 1.0, ms_act_prev = 0.0;
-
-                sse_luma[idx_blk] = calc_squared_error_and_weight(s, p_org, s_org,
-                                                                  org_m1 /* pixel  */,
-                                                                  org_m2 /* memory */,
-                                                                  p_rec, s_rec,
-                                                                  x, y,
-                                                                  block_width, block_height,
-                                                                  s->depth, s->frame_rate, &ms_act);
-                weights[idx_blk] = 1.0 / sqrt(ms_act);
-
-                if (w * h <= 640 * 480) { /* in-line "min-smoothing" as in paper */
                     if (x == 0) /* first column */
                         ms_act_prev = (idx_blk > 1 ? weights[idx_blk - 2] : 0);
                     else  /* after first column */
@@ -333,9 +412,9 @@ static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
                         if (weights[idx_blk] > ms_act_prev)
                             weights[idx_blk] = ms_act_prev;
                     }
-                }
-            } /* for x */
-        } /* for y */
+                } /* for x */
+            } /* for y */
+        }
 
         for (y = idx_blk = 0; y < h; y += b) { /* calculate sum for luma (Y) XPSNR */
             for (x = 0; x < w; x += b, idx_blk++) {
@@ -360,18 +439,15 @@ static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
         else if (c > 0) { /* b >= 4 so Y XPSNR has already been calculated above */
             const uint32_t  bx = (b * w_pln) / w;
             const uint32_t  by = (b * h_pln) / h;  /* up to chroma downsampling by 4 */
+            const uint32_t h_blk = (h_pln + by - 1) / by;
             double wsse_chroma = 0.0;
 
-            for (y = idx_blk = 0; y < h_pln; y += by) { /* calc chroma (Cb/Cr) XPSNR */
-                const uint32_t block_height = (y + by > h_pln ? h_pln - y : by);
-
-                for (x = 0; x < w_pln; x += bx, idx_blk++) {
-                    const uint32_t block_width = (x + bx > w_pln ? w_pln - x : bx);
+            td.c = c;
+            ff_filter_execute(ctx, chroma_slice, &td, NULL, FFMIN(h_blk, nb_threads));
 
-                    wsse_chroma += (double) calc_squared_error (s, p_org + y * s_org + x, s_org,
-                                                                p_rec + y * s_rec + x, s_rec,
-                                                                block_width, block_height) * weights[idx_blk];
-                }
+            for (y = idx_blk = 0; y < h_pln; y += by) { /* calc chroma (Cb/Cr) XPSNR */
+                for (x = 0; x < w_pln; x += bx, idx_blk++)
+                    wsse_chroma += (double) s->sse_chroma[idx_blk] * weights[idx_blk];
             }
             wsse64[c] = (wsse_chroma <= 0.0 ? 0 : (uint64_t) (wsse_chroma * avg_act + 0.5));
         }
@@ -380,6 +456,31 @@ static int get_wsse(AVFilterContext *ctx, int16_t **org, int16_t *org_m1,
     return 0;
 }
 
+static int copy_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    XPSNRContext *const s = ctx->priv;
+    const ThreadData  *td = arg;
+
+    for (int c = 0; c < s->num_comps; c++) { /* widen 8-bit org/rec to 16 bit */
+        const int     m = td->master->linesize[c]; /* master stride */
+        const int     r = td->ref->linesize[c];    /* ref/c stride */
+        const int     o = s->plane_width[c];       /* XPSNR stride */
+        const int start = (s->plane_height[c] *  jobnr     ) / nb_jobs;
+        const int   end = (s->plane_height[c] * (jobnr + 1)) / nb_jobs;
+        int16_t *porg = td->org[c];
+        int16_t *prec = td->rec[c];
+
+        for (int y = start; y < end; y++) {
+            for (int x = 0; x < s->plane_width[c]; x++) {
+                porg[y * o + x] = (int16_t) td->master->data[c][y * m + x];
+                prec[y * o + x] = (int16_t)    td->ref->data[c][y * r + x];
+            }
+        }
+    }
+
+    return 0;
+}
+
 static void set_meta(AVDictionary **metadata, const char *key, char comp, float d)
 {
     char value[128];
@@ -421,6 +522,13 @@ static int do_xpsnr(FFFrameSync *fs)
         s->sse_luma = av_malloc_array(w_blk * h_blk, sizeof(double));
     if (!s->weights)
         s->weights  = av_malloc_array(w_blk * h_blk, sizeof(double));
+    if (!s->sse_chroma && s->num_comps > 1 && b >= 4) {
+        const uint32_t bx = (b * s->plane_width [1]) / w;
+        const uint32_t by = (b * s->plane_height[1]) / h;
+
+        s->sse_chroma = av_malloc_array(((s->plane_width [1] + bx - 1) / bx) *
+                                        ((s->plane_height[1] + by - 1) / by), sizeof(uint64_t));
+    }
 
     for (c = 0; c < s->num_comps; c++)  /* create temporal org buffer memory */
         s->line_sizes[c] = master->linesize[c];
@@ -433,26 +541,21 @@ static int do_xpsnr(FFFrameSync *fs)
         s->buf_org_m2 = av_calloc(s->plane_height[0], stride_org_bpp * sizeof(int16_t));
 
     if (s->bpp == 1) { /* 8 bit */
-        for (c = 0; c < s->num_comps; c++) { /* allocate org/rec buffer memory */
-            const int m = s->line_sizes[c];  /* master stride */
-            const int r = ref->linesize[c];  /* ref/c stride */
-            const int o = s->plane_width[c]; /* XPSNR stride */
+        ThreadData td = { .master = master, .ref = ref, .org = porg, .rec = prec };
 
+        for (c = 0; c < s->num_comps; c++) { /* allocate org/rec buffer memory */
             if (!s->buf_org[c])
                 s->buf_org[c] = av_calloc(s->plane_width[c], s->plane_height[c] * sizeof(int16_t));
             if (!s->buf_rec[c])
                 s->buf_rec[c] = av_calloc(s->plane_width[c], s->plane_height[c] * sizeof(int16_t));
+            if (!s->buf_org[c] || !s->buf_rec[c])
+                return AVERROR(ENOMEM);
 
             porg[c] = s->buf_org[c];
             prec[c] = s->buf_rec[c];
-
-            for (int y = 0; y < s->plane_height[c]; y++) {
-                for (int x = 0; x < s->plane_width[c]; x++) {
-                    porg[c][y * o + x] = (int16_t) master->data[c][y * m + x];
-                    prec[c][y * o + x] = (int16_t)    ref->data[c][y * r + x];
-                }
-            }
         }
+        ff_filter_execute(ctx, copy_slice, &td, NULL,
+                          FFMIN(s->plane_height[0], ff_filter_get_nb_threads(ctx)));
     } else {  /* 10, 12, 14 bit */
         for (c = 0; c < s->num_comps; c++) {
             porg[c] = (int16_t *) master->data[c];
@@ -681,6 +784,7 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_freep(&s->sse_luma);
     av_freep(&s->weights );
+    av_freep(&s->sse_chroma);
 
     av_freep(&s->buf_org_m1);
     av_freep(&s->buf_org_m2);
@@ -714,7 +818,8 @@ const FFFilter ff_vf_xpsnr = {
     .p.name       = "xpsnr",
     .p.description = NULL_IF_CONFIG_SMALL("Calculate the extended perceptually weighted peak signal-to-noise ratio (XPSNR) between two video streams."),
     .p.priv_class = &xpsnr_class,
-    .p.flags      = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_METADATA_ONLY,
+    .p.flags      = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_METADATA_ONLY |
+                    AVFILTER_FLAG_SLICE_THREADS,
     .preinit      = xpsnr_framesync_preinit,
     .init         = init,
     .uninit       = uninit,
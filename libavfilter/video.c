@@ -26,6 +26,7 @@
 #include "libavutil/buffer.h"
 #include "libavutil/cpu.h"
 #include "libavutil/hwcontext.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/pixfmt.h"
 
 #include "avfilter.h"
@@ -46,7 +47,8 @@ AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h)
     return ff_get_video_buffer(link->dst->outputs[0], w, h);
 }
 
-AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int align)
+static AVFrame *get_video_buffer(AVFilterLink *link, int w, int h, int align,
+                                 unsigned pool_flags)
 {
     FilterLinkInternal *const li = ff_link_internal(link);
     AVFrame *frame = NULL;
@@ -66,7 +68,8 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
         return frame;
     }
 
-    if (ff_frame_pool_video_reinit(&li->frame_pool, w, h, link->format, align) < 0)
+    if (ff_frame_pool_video_reinit(&li->frame_pool, w, h, link->format,
+                                   align, pool_flags) < 0)
         return NULL;
 
     frame = ff_frame_pool_get(&li->frame_pool);
@@ -81,6 +84,30 @@ AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int alig
     return frame;
 }
 
+AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int align)
+{
+    return get_video_buffer(link, w, h, align, 0);
+}
+
+AVFrame *ff_get_packed_video_buffer(AVFilterLink *link, int w, int h)
+{
+    FilterLinkInternal *const li = ff_link_internal(link);
+    const int align = av_cpu_max_align();
+    int linesizes[4];
+
+    if (li->l.hw_frames_ctx)
+        return NULL;
+
+    /* Only use the packed layout if it keeps every line aligned for SIMD */
+    if (av_image_fill_linesizes(linesizes, link->format, w) < 0)
+        return NULL;
+    for (int i = 0; i < 4; i++)
+        if (linesizes[i] % align)
+            return NULL;
+
+    return get_video_buffer(link, w, h, align, FF_FRAME_POOL_FLAG_PACKED);
+}
+
 AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h)
 {
     return ff_default_get_video_buffer2(link, w, h, av_cpu_max_align());
@@ -34,6 +34,16 @@ AVFrame *ff_default_get_video_buffer(AVFilterLink *link, int w, int h);
 AVFrame *ff_default_get_video_buffer2(AVFilterLink *link, int w, int h, int align);
 AVFrame *ff_null_get_video_buffer(AVFilterLink *link, int w, int h);
 
+/**
+ * Allocate a picture whose planes are stored contiguously in a single buffer,
+ * with the same layout as av_image_copy_to_buffer() using an alignment of 1,
+ * followed by zeroed padding.
+ *
+ * @return the frame, or NULL if this layout cannot be used for the link
+ *         without breaking the usual line alignment or on error
+ */
+AVFrame *ff_get_packed_video_buffer(AVFilterLink *link, int w, int h);
+
 /**
  * Request a picture buffer with a specific set of permissions.
  *
@@ -37,15 +37,16 @@
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 #include "url.h"
 
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
 
-#define BUFFER_CAPACITY         (4 * 1024 * 1024)
 #define READ_BACK_CAPACITY      (4 * 1024 * 1024)
 #define SHORT_SEEK_THRESHOLD    (256 * 1024)
+#define READ_CHUNK_SIZE         (32 * 1024)
 
 typedef struct RingBuffer
 {
@@ -73,6 +74,20 @@ typedef struct AsyncContext {
     int64_t         logical_size;
     RingBuffer      ring;
 
+    /* Amount of data to keep buffered ahead of the read position. Doubles
+     * whenever the reader has to wait and drops to min_window on seeks. */
+    int             window;
+    int             min_window;
+    int             max_window;
+    int             sequential;         ///< a read happened since the last seek
+
+    /* statistics, exported as read-only options */
+    int64_t         inner_bytes;        ///< updated by the background thread
+    int64_t         bytes_prefetched;   ///< copy of inner_bytes for the caller
+    int64_t         read_hits;
+    int64_t         read_misses;
+    int64_t         stall_time;
+
     pthread_cond_t  cond_wakeup_main;
     pthread_cond_t  cond_wakeup_background;
     pthread_mutex_t mutex;
@@ -223,7 +238,7 @@ static void *async_buffer_task(void *arg)
             continue;
         }
 
-        fifo_space = ring_space(ring);
+        fifo_space = FFMIN(ring_space(ring), c->window - ring_size(ring));
         if (c->io_eof_reached || fifo_space <= 0) {
             pthread_cond_signal(&c->cond_wakeup_main);
             pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
@@ -232,7 +247,7 @@ static void *async_buffer_task(void *arg)
         }
         pthread_mutex_unlock(&c->mutex);
 
-        to_copy = FFMIN(4096, fifo_space);
+        to_copy = FFMIN(READ_CHUNK_SIZE, fifo_space);
         ret = ring_write(ring, h, to_copy);
 
         pthread_mutex_lock(&c->mutex);
@@ -240,6 +255,8 @@ static void *async_buffer_task(void *arg)
             c->io_eof_reached = 1;
             if (c->inner_io_error < 0)
                 c->io_error = c->inner_io_error;
+        } else {
+            c->inner_bytes += ret;
         }
 
         pthread_cond_signal(&c->cond_wakeup_main);
@@ -257,7 +274,10 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
 
     av_strstart(arg, "async:", &arg);
 
-    ret = ring_init(&c->ring, BUFFER_CAPACITY, READ_BACK_CAPACITY);
+    c->min_window = FFMIN(c->min_window, c->max_window);
+    c->window     = c->min_window;
+
+    ret = ring_init(&c->ring, c->max_window, READ_BACK_CAPACITY);
     if (ret < 0)
         goto fifo_fail;
 
@@ -330,6 +350,11 @@ static int async_close(URLContext *h)
     if (ret != 0)
         av_log(h, AV_LOG_ERROR, "pthread_join(): %s\n", av_err2str(ret));
 
+    av_log(h, AV_LOG_VERBOSE, "Read ahead %"PRId64" bytes, %"PRId64" of %"PRId64" reads "
+           "served without waiting, stalled for %.3f s, final window %d\n",
+           c->inner_bytes, c->read_hits, c->read_hits + c->read_misses,
+           c->stall_time / 1000000.0, c->window);
+
     pthread_cond_destroy(&c->cond_wakeup_background);
     pthread_cond_destroy(&c->cond_wakeup_main);
     pthread_mutex_destroy(&c->mutex);
@@ -346,6 +371,7 @@ static int async_read_internal(URLContext *h, void *dest, int size)
     int     read_complete = !dest;
     int           to_read = size;
     int           ret     = 0;
+    int64_t   stall_start = 0;
 
     pthread_mutex_lock(&c->mutex);
 
@@ -376,10 +402,26 @@ static int async_read_internal(URLContext *h, void *dest, int size)
             }
             break;
         }
+        if (!stall_start) {
+            /* The reader caught up with the background thread; waiting right
+             * after a seek is expected and says nothing about the window. */
+            stall_start = av_gettime_relative();
+            if (c->sequential)
+                c->window = FFMIN(2 * c->window, c->max_window);
+        }
         pthread_cond_signal(&c->cond_wakeup_background);
         pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
     }
 
+    if (stall_start) {
+        c->stall_time += av_gettime_relative() - stall_start;
+        c->read_misses++;
+    } else {
+        c->read_hits++;
+    }
+    c->bytes_prefetched = c->inner_bytes;
+    c->sequential       = 1;
+
     pthread_cond_signal(&c->cond_wakeup_background);
     pthread_mutex_unlock(&c->mutex);
 
@@ -448,6 +490,8 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 
     pthread_mutex_lock(&c->mutex);
 
+    c->window         = c->min_window;
+    c->sequential     = 0;
     c->seek_request   = 1;
     c->seek_pos       = new_logical_pos;
     c->seek_whence    = SEEK_SET;
@@ -477,10 +521,26 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 #define OFFSET(x) offsetof(AsyncContext, x)
 #define D AV_OPT_FLAG_DECODING_PARAM
 
+#define E (AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY)
+
 static const AVOption options[] = {
+    { "min_window", "Amount of data to read ahead after opening or seeking", OFFSET(min_window),
+        AV_OPT_TYPE_INT, { .i64 = 256 * 1024 }, READ_CHUNK_SIZE, INT_MAX / 2, D },
+    { "max_window", "Maximum amount of data to read ahead", OFFSET(max_window),
+        AV_OPT_TYPE_INT, { .i64 = 4 * 1024 * 1024 }, READ_CHUNK_SIZE, INT_MAX / 2, D },
+    { "bytes_prefetched", "Number of bytes read from the underlying protocol", OFFSET(bytes_prefetched),
+        AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D | E },
+    { "read_hits", "Number of reads served without waiting for data", OFFSET(read_hits),
+        AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D | E },
+    { "read_misses", "Number of reads that had to wait for data", OFFSET(read_misses),
+        AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D | E },
+    { "stall_time", "Total time spent waiting for data, in microseconds", OFFSET(stall_time),
+        AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D | E },
     {NULL},
 };
 
+#undef E
+
 #undef D
 #undef OFFSET
 
@@ -66,6 +66,7 @@ static const AVOption urlcontext_options[] = {
     {"protocol_blacklist", "List of protocols that are not allowed to be used", OFFSET(protocol_blacklist), AV_OPT_TYPE_STRING, { .str = NULL },  0, 0, D },
     {"rw_timeout", "Timeout for IO operations (in microseconds)", offsetof(URLContext, rw_timeout), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, AV_OPT_FLAG_ENCODING_PARAM | AV_OPT_FLAG_DECODING_PARAM },
     {"prefer_libcurl", "use the libcurl protocol for http(s) URLs when available", OFFSET(prefer_libcurl), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    {"readahead", "read input ahead in a background thread", OFFSET(readahead), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
     { NULL }
 };
 
@@ -397,6 +398,36 @@ static int prefer_libcurl(const char *filename, AVDictionary **options,
 }
 #endif
 
+#if CONFIG_ASYNC_PROTOCOL
+extern const URLProtocol ff_async_protocol;
+
+/* Decide whether a top-level input should be wrapped with the async protocol.
+ * Controlled by the per-open "readahead" option. */
+static int prefer_readahead(const char *filename, int flags, AVDictionary **options,
+                            const char *whitelist, const char *blacklist,
+                            URLContext *parent)
+{
+    URLContext dummy = { .av_class = &url_context_class };
+    AVDictionaryEntry *e;
+
+    if (parent || (flags & AVIO_FLAG_WRITE) || av_strstart(filename, "async:", NULL))
+        return 0;
+
+    if (!options || !(e = av_dict_get(*options, "readahead", NULL, 0)))
+        return 0;
+    if (av_opt_set(&dummy, "readahead", e->value, 0) < 0 || !dummy.readahead)
+        return 0;
+
+    /* Keep reading directly rather than failing if async is not allowed */
+    if (whitelist && av_match_list("async", whitelist, ',') <= 0)
+        return 0;
+    if (blacklist && av_match_list("async", blacklist, ',') > 0)
+        return 0;
+
+    return 1;
+}
+#endif
+
 static int url_open_whitelist(URLContext **puc, const char *filename, int flags,
                               const AVIOInterruptCB *int_cb, AVDictionary **options,
                               const char *whitelist, const char* blacklist,
@@ -406,6 +437,13 @@ static int url_open_whitelist(URLContext **puc, const char *filename, int flags,
     AVDictionaryEntry *e;
     int ret;
 
+#if CONFIG_ASYNC_PROTOCOL
+    /* The async protocol opens the actual URL itself, as a nested protocol */
+    if (prefer_readahead(filename, flags, options, whitelist, blacklist, parent))
+        ret = url_alloc_for_protocol(puc, &ff_async_protocol, filename, flags,
+                                     int_cb);
+    else
+#endif
 #if CONFIG_LIBCURL_PROTOCOL
     /* The option itself is applied to the URLContext further down; here it only
      * picks the protocol, before the context exists. */
@@ -0,0 +1,525 @@
+/*
+ * io_uring based file protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* Needed for syscall() and O_DIRECT */
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/error.h"
+#include "libavutil/file_open.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+
+#include "avio.h"
+#include "url.h"
+
+/* Required alignment of buffers, offsets and sizes for O_DIRECT */
+#define DIRECT_ALIGN 4096
+
+/* user_data of cancellation requests, which do not belong to a block */
+#define CANCEL_USER_DATA UINT64_MAX
+
+typedef struct IOUringBlock {
+    uint8_t *data;
+    int64_t  pos;       ///< file offset of the block, -1 if unused
+    int      size;      ///< number of bytes read so far
+    int      pending;   ///< a read into this block is in flight
+    int      error;     ///< error of the last read, or 0
+} IOUringBlock;
+
+typedef struct IOUringContext {
+    const AVClass *class;
+    int queue_depth;
+    int block_size;
+    int direct;
+
+    int fd;
+    int ring_fd;
+    int64_t filesize;
+    int64_t pos;
+    int64_t next_pos;   ///< position following the previous read
+    int nb_ahead;       ///< number of blocks to read ahead, grows on sequential reads
+
+    /* rings shared with the kernel */
+    uint8_t *sq_ring;
+    uint8_t *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    atomic_uint *sq_tail;
+    atomic_uint *cq_head;
+    atomic_uint *cq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned nb_queued; ///< SQEs written but not yet submitted
+
+    uint8_t *buffer;
+    IOUringBlock *blocks;
+} IOUringContext;
+
+static int ring_setup(URLContext *h)
+{
+    IOUringContext *c = h->priv_data;
+    struct io_uring_params p = { 0 };
+
+    c->ring_fd = syscall(__NR_io_uring_setup, c->queue_depth, &p);
+    if (c->ring_fd < 0) {
+        int ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Failed to set up io_uring: %s\n", av_err2str(ret));
+        return ret;
+    }
+
+    c->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    c->cq_ring_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        c->sq_ring_size = c->cq_ring_size = FFMAX(c->sq_ring_size, c->cq_ring_size);
+
+    c->sq_ring = mmap(NULL, c->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, c->ring_fd, IORING_OFF_SQ_RING);
+    if (c->sq_ring == MAP_FAILED) {
+        c->sq_ring = NULL;
+        return AVERROR(errno);
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        c->cq_ring = c->sq_ring;
+    } else {
+        c->cq_ring = mmap(NULL, c->cq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, c->ring_fd, IORING_OFF_CQ_RING);
+        if (c->cq_ring == MAP_FAILED) {
+            c->cq_ring = NULL;
+            return AVERROR(errno);
+        }
+    }
+
+    c->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    c->sqes = mmap(NULL, c->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, c->ring_fd, IORING_OFF_SQES);
+    if (c->sqes == MAP_FAILED) {
+        c->sqes = NULL;
+        return AVERROR(errno);
+    }
+
+    c->sq_tail  = (atomic_uint *)(c->sq_ring + p.sq_off.tail);
+    c->sq_mask  = *(unsigned *)(c->sq_ring + p.sq_off.ring_mask);
+    c->sq_array = (unsigned *)(c->sq_ring + p.sq_off.array);
+    c->cq_head  = (atomic_uint *)(c->cq_ring + p.cq_off.head);
+    c->cq_tail  = (atomic_uint *)(c->cq_ring + p.cq_off.tail);
+    c->cq_mask  = *(unsigned *)(c->cq_ring + p.cq_off.ring_mask);
+    c->cqes     = (struct io_uring_cqe *)(c->cq_ring + p.cq_off.cqes);
+    return 0;
+}
+
+static void queue_read(IOUringContext *c, int idx)
+{
+    IOUringBlock *blk = &c->blocks[idx];
+    unsigned tail = atomic_load_explicit(c->sq_tail, memory_order_relaxed);
+    unsigned slot = tail & c->sq_mask;
+    struct io_uring_sqe *sqe = &c->sqes[slot];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_READ;
+    sqe->fd        = c->fd;
+    sqe->addr      = (uintptr_t)(blk->data + blk->size);
+    sqe->len       = c->block_size - blk->size;
+    sqe->off       = blk->pos + blk->size;
+    sqe->user_data = idx;
+    c->sq_array[slot] = slot;
+
+    atomic_store_explicit(c->sq_tail, tail + 1, memory_order_release);
+    blk->pending = 1;
+    c->nb_queued++;
+}
+
+static int ring_enter(IOUringContext *c, unsigned min_complete)
+{
+    int ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, c->ring_fd, c->nb_queued, min_complete,
+                      min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0)
+        return AVERROR(errno);
+
+    c->nb_queued -= FFMIN(c->nb_queued, ret);
+    return 0;
+}
+
+static void complete_read(IOUringContext *c, const struct io_uring_cqe *cqe)
+{
+    IOUringBlock *blk = &c->blocks[cqe->user_data];
+    const int64_t expected = FFMIN(c->block_size, c->filesize - blk->pos);
+
+    blk->pending = 0;
+    if (cqe->res < 0) {
+        blk->error = AVERROR(-cqe->res);
+        return;
+    }
+
+    blk->size += cqe->res;
+    /* Continue short reads that stopped before the end of the file */
+    if (cqe->res > 0 && blk->size < expected)
+        queue_read(c, cqe->user_data);
+}
+
+/**
+ * Reap completions until the read into the given block has finished.
+ */
+static int wait_block(IOUringContext *c, int idx)
+{
+    while (c->blocks[idx].pending) {
+        unsigned head = atomic_load_explicit(c->cq_head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(c->cq_tail, memory_order_acquire);
+        int ret;
+
+        if (head == tail) {
+            ret = ring_enter(c, 1);
+            if (ret < 0)
+                return ret;
+            continue;
+        }
+
+        for (; head != tail; head++)
+            complete_read(c, &c->cqes[head & c->cq_mask]);
+        atomic_store_explicit(c->cq_head, head, memory_order_release);
+
+        if (c->nb_queued) {
+            ret = ring_enter(c, 0);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Make sure reads are in flight for the block containing pos and the
+ * following nb_ahead - 1 blocks.
+ */
+static int read_ahead(IOUringContext *c, int64_t pos)
+{
+    const int64_t first = pos / c->block_size;
+    int ret;
+
+    for (int i = 0; i < c->nb_ahead; i++) {
+        const int64_t block_pos = (first + i) * c->block_size;
+        const int idx = (first + i) % c->queue_depth;
+        IOUringBlock *blk = &c->blocks[idx];
+
+        if (block_pos >= c->filesize)
+            break;
+        if (blk->pos == block_pos && !blk->error)
+            continue;
+
+        /* The buffer is still owned by the kernel until the old read ends */
+        ret = wait_block(c, idx);
+        if (ret < 0)
+            return ret;
+
+        blk->pos   = block_pos;
+        blk->size  = 0;
+        blk->error = 0;
+        queue_read(c, idx);
+    }
+
+    return c->nb_queued ? ring_enter(c, 0) : 0;
+}
+
+static int iouring_read(URLContext *h, unsigned char *buf, int size)
+{
+    IOUringContext *c = h->priv_data;
+    IOUringBlock *blk;
+    int64_t offset;
+    int idx, ret;
+
+    if (c->pos >= c->filesize)
+        return AVERROR_EOF;
+
+    /* Start with a single block after a seek, so that random access does not
+     * wait for reads it will never use, and double the read-ahead every time
+     * a sequential read enters a new block (reads never cross blocks). */
+    if (c->pos != c->next_pos)
+        c->nb_ahead = 1;
+    else if (c->pos % c->block_size == 0)
+        c->nb_ahead = FFMIN(2 * c->nb_ahead, c->queue_depth);
+
+    ret = read_ahead(c, c->pos);
+    if (ret < 0)
+        return ret;
+
+    idx = (c->pos / c->block_size) % c->queue_depth;
+    blk = &c->blocks[idx];
+    ret = wait_block(c, idx);
+    if (ret < 0)
+        return ret;
+
+    if (blk->error) {
+        ret = blk->error;
+        blk->pos = -1;
+        return ret;
+    }
+
+    offset = c->pos - blk->pos;
+    if (offset >= blk->size)
+        return AVERROR_EOF; /* the file was truncated */
+
+    size = FFMIN(size, blk->size - offset);
+    memcpy(buf, blk->data + offset, size);
+    c->pos += size;
+    c->next_pos = c->pos;
+    return size;
+}
+
+static int64_t iouring_seek(URLContext *h, int64_t pos, int whence)
+{
+    IOUringContext *c = h->priv_data;
+
+    switch (whence) {
+    case AVSEEK_SIZE:
+        return c->filesize;
+    case SEEK_SET:
+        break;
+    case SEEK_CUR:
+        pos += c->pos;
+        break;
+    case SEEK_END:
+        pos += c->filesize;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    return c->pos = pos;
+}
+
+/**
+ * Cancel the reads in flight and reap their completions, so that the kernel
+ * no longer accesses any block.
+ */
+static int cancel_reads(IOUringContext *c)
+{
+    int nb_pending = 0, ret;
+
+    /* Only submitted reads can be cancelled */
+    if (c->nb_queued) {
+        ret = ring_enter(c, 0);
+        if (ret < 0)
+            return ret;
+        if (c->nb_queued)
+            return AVERROR(EAGAIN);
+    }
+
+    for (int i = 0; i < c->queue_depth; i++) {
+        unsigned tail, slot;
+        struct io_uring_sqe *sqe;
+
+        if (!c->blocks[i].pending)
+            continue;
+
+        tail = atomic_load_explicit(c->sq_tail, memory_order_relaxed);
+        slot = tail & c->sq_mask;
+        sqe  = &c->sqes[slot];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+        sqe->fd        = -1;
+        sqe->addr      = i;
+        sqe->user_data = CANCEL_USER_DATA;
+        c->sq_array[slot] = slot;
+        atomic_store_explicit(c->sq_tail, tail + 1, memory_order_release);
+        c->nb_queued++;
+        nb_pending++;
+    }
+
+    /* Reads that could not be cancelled still complete, and unlike in
+     * wait_block() short reads are not continued */
+    while (nb_pending) {
+        unsigned head = atomic_load_explicit(c->cq_head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(c->cq_tail, memory_order_acquire);
+
+        if (c->nb_queued || head == tail) {
+            ret = ring_enter(c, head == tail);
+            if (ret < 0)
+                return ret;
+            continue;
+        }
+
+        for (; head != tail; head++) {
+            const struct io_uring_cqe *cqe = &c->cqes[head & c->cq_mask];
+            if (cqe->user_data != CANCEL_USER_DATA) {
+                c->blocks[cqe->user_data].pending = 0;
+                nb_pending--;
+            }
+        }
+        atomic_store_explicit(c->cq_head, head, memory_order_release);
+    }
+
+    return 0;
+}
+
+static int iouring_close(URLContext *h)
+{
+    IOUringContext *c = h->priv_data;
+
+    /* The kernel must be done with the buffers before they are released. If
+     * that cannot be ensured, leak them rather than have memory that gets
+     * reused overwritten by a late read. */
+    if (c->blocks && c->cqes && cancel_reads(c) < 0) {
+        av_log(h, AV_LOG_ERROR, "Failed to cancel pending reads, "
+               "leaking the read buffers\n");
+        c->buffer = NULL;
+    }
+
+    if (c->sqes)
+        munmap(c->sqes, c->sqes_size);
+    if (c->cq_ring && c->cq_ring != c->sq_ring)
+        munmap(c->cq_ring, c->cq_ring_size);
+    if (c->sq_ring)
+        munmap(c->sq_ring, c->sq_ring_size);
+    if (c->ring_fd >= 0)
+        close(c->ring_fd);
+    if (c->fd >= 0)
+        close(c->fd);
+
+    av_freep(&c->blocks);
+    av_freep(&c->buffer);
+    return 0;
+}
+
+static int iouring_open(URLContext *h, const char *filename, int flags)
+{
+    IOUringContext *c = h->priv_data;
+    uint8_t *data;
+    int ret;
+
+    c->fd = c->ring_fd = -1;
+    c->nb_ahead = 1;
+
+    if (flags & AVIO_FLAG_WRITE)
+        return AVERROR(ENOSYS);
+
+    av_strstart(filename, "iouring:", &filename);
+
+    if (c->direct) {
+        c->fd = avpriv_open(filename, O_RDONLY | O_DIRECT);
+        if (c->fd < 0 && errno == EINVAL)
+            av_log(h, AV_LOG_WARNING, "O_DIRECT is not supported for this file, "
+                   "falling back to buffered reads\n");
+    }
+    if (c->fd < 0)
+        c->fd = avpriv_open(filename, O_RDONLY);
+    if (c->fd < 0)
+        return AVERROR(errno);
+
+    c->filesize = lseek(c->fd, 0, SEEK_END);
+    if (c->filesize < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+
+    /* O_DIRECT requires aligned offsets and sizes, and it costs nothing
+     * to use the same block size for buffered reads */
+    c->block_size = FFALIGN(c->block_size, DIRECT_ALIGN);
+
+    c->blocks = av_calloc(c->queue_depth, sizeof(*c->blocks));
+    c->buffer = av_malloc((size_t)c->queue_depth * c->block_size + DIRECT_ALIGN);
+    if (!c->blocks || !c->buffer) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    data = (uint8_t *)FFALIGN((uintptr_t)c->buffer, DIRECT_ALIGN);
+    for (int i = 0; i < c->queue_depth; i++) {
+        c->blocks[i].data = data + (size_t)i * c->block_size;
+        c->blocks[i].pos  = -1;
+    }
+
+    ret = ring_setup(h);
+    if (ret < 0)
+        goto fail;
+
+    return 0;
+
+fail:
+    iouring_close(h);
+    return ret;
+}
+
+static int iouring_get_file_handle(URLContext *h)
+{
+    IOUringContext *c = h->priv_data;
+    return c->fd;
+}
+
+static int iouring_get_short_seek(URLContext *h)
+{
+    IOUringContext *c = h->priv_data;
+    return c->block_size;
+}
+
+#define OFFSET(x) offsetof(IOUringContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+
+static const AVOption options[] = {
+    { "queue_depth", "Number of blocks to read ahead concurrently", OFFSET(queue_depth), AV_OPT_TYPE_INT,  { .i64 = 8 }, 1, 4096, .flags = D },
+    { "block_size",  "Size of each read request in bytes",          OFFSET(block_size),  AV_OPT_TYPE_INT,  { .i64 = 1 << 20 }, 1, 1 << 28, .flags = D },
+    { "direct",      "Bypass the page cache using O_DIRECT",         OFFSET(direct),      AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, .flags = D },
+    { NULL },
+};
+
+static const AVClass iouring_context_class = {
+    .class_name = "iouring",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+const URLProtocol ff_iouring_protocol = {
+    .name                = "iouring",
+    .url_open            = iouring_open,
+    .url_read            = iouring_read,
+    .url_seek            = iouring_seek,
+    .url_close           = iouring_close,
+    .url_get_file_handle = iouring_get_file_handle,
+    .url_get_short_seek  = iouring_get_short_seek,
+    .priv_data_size      = sizeof(IOUringContext),
+    .priv_data_class     = &iouring_context_class,
+};
@@ -4891,6 +4891,9 @@ static int build_open_gop_key_points(AVStream *st)
 #define MOV_MERGE_STTS 2
 /*
  * Merge stts and ctts arrays into a new combined array.
+ * The result stays run-length coded: each entry covers the samples for which
+ * both the duration and the composition offset are constant, so its size
+ * depends on the number of table entries rather than on the sample count.
  * stts_count and ctts_count may be left untouched as they will be
  * used to check for the presence of either of them.
  */
@@ -4899,60 +4902,118 @@ static int mov_merge_tts_data(MOVContext *mov, AVStream *st, int flags)
     MOVStreamContext *sc = st->priv_data;
     int ctts = sc->ctts_data && (flags & MOV_MERGE_CTTS);
     int stts = sc->stts_data && (flags & MOV_MERGE_STTS);
-    int idx = 0;
+    unsigned int ctts_index = 0, stts_index = 0;
+    unsigned int ctts_left = 0, stts_left = 0;
+    uint64_t max_entries = 0;
+    unsigned int idx = 0;
 
     if (!sc->ctts_data && !sc->stts_data)
         return 0;
-    // Expand time to sample entries such that we have a 1-1 mapping with samples
     if (!sc->sample_count || sc->sample_count >= UINT_MAX / sizeof(*sc->tts_data))
         return -1;
 
-    if (ctts) {
+    if (ctts)
+        max_entries += sc->ctts_count;
+    else
+        sc->ctts_count = 0;
+    if (stts)
+        max_entries += sc->stts_count;
+    else
+        sc->stts_count = 0;
+    max_entries = FFMIN(max_entries, sc->sample_count);
+
+    av_freep(&sc->tts_data);
+    sc->tts_allocated_size = 0;
+    sc->tts_count = 0;
+    if (max_entries) {
         sc->tts_data = av_fast_realloc(NULL, &sc->tts_allocated_size,
-                                       sc->sample_count * sizeof(*sc->tts_data));
+                                       max_entries * sizeof(*sc->tts_data));
         if (!sc->tts_data)
             return -1;
+    }
 
-        memset(sc->tts_data, 0, sc->tts_allocated_size);
+    while (idx < sc->sample_count) {
+        MOVTimeToSample *last = sc->tts_count ? &sc->tts_data[sc->tts_count - 1] : NULL;
+        unsigned int count = sc->sample_count - idx;
+        int offset = 0, duration = 0;
 
-        for (int i = 0; i < sc->ctts_count &&
-                    idx < sc->sample_count; i++)
-            for (int j = 0; j < sc->ctts_data[i].count &&
-                        idx < sc->sample_count; j++) {
-                sc->tts_data[idx].offset = sc->ctts_data[i].offset;
-                sc->tts_data[idx++].count = 1;
-            }
+        while (ctts && !ctts_left && ctts_index < sc->ctts_count)
+            ctts_left = sc->ctts_data[ctts_index++].count;
+        while (stts && !stts_left && stts_index < sc->stts_count)
+            stts_left = sc->stts_data[stts_index++].count;
+        // Samples past the end of both tables have no time to sample entries
+        if (!ctts_left && !stts_left)
+            break;
+
+        if (ctts_left) {
+            count  = FFMIN(count, ctts_left);
+            offset = sc->ctts_data[ctts_index - 1].offset;
+        }
+        if (stts_left) {
+            count    = FFMIN(count, stts_left);
+            duration = sc->stts_data[stts_index - 1].duration;
+        }
+        if (ctts_left)
+            ctts_left -= count;
+        if (stts_left)
+            stts_left -= count;
+        idx += count;
+
+        if (last && last->offset == offset && last->duration == duration) {
+            last->count += count;
+            continue;
+        }
+        av_assert1(sc->tts_count < max_entries);
+        sc->tts_data[sc->tts_count].count    = count;
+        sc->tts_data[sc->tts_count].duration = duration;
+        sc->tts_data[sc->tts_count].offset   = offset;
+        sc->tts_count++;
+    }
 
-        sc->tts_count = idx;
-    } else
-        sc->ctts_count = 0;
     av_freep(&sc->ctts_data);
     sc->ctts_allocated_size = 0;
+    av_freep(&sc->stts_data);
+    sc->stts_allocated_size = 0;
 
-    idx = 0;
-    if (stts) {
-        MOVTimeToSample *tts_data = av_fast_realloc(sc->tts_data, &sc->tts_allocated_size,
-                                                    sc->sample_count * sizeof(*sc->tts_data));
-        if (!tts_data)
-            return -1;
+    return 0;
+}
 
-        if (!sc->tts_data)
-            memset(tts_data, 0, sc->tts_allocated_size);
-        sc->tts_data = tts_data;
+/*
+ * Expand the time to sample entries such that there is one entry per
+ * index entry. Fragments are merged into the index sample by sample, so
+ * this is done on demand the first time a fragment is added to a track
+ * which already has run-length coded entries from its sample table.
+ */
+static int mov_expand_tts_data(MOVStreamContext *sc, unsigned int nb_samples)
+{
+    MOVTimeToSample *tts_data;
+    unsigned int idx = 0, allocated_size = 0;
+    int expanded = 1;
 
-        for (int i = 0; i < sc->stts_count &&
-                    idx < sc->sample_count; i++)
-            for (int j = 0; j < sc->stts_data[i].count &&
-                        idx < sc->sample_count; j++) {
-                sc->tts_data[idx].duration = sc->stts_data[i].duration;
-                sc->tts_data[idx++].count = 1;
-            }
+    for (unsigned int i = 0; i < sc->tts_count && expanded; i++)
+        expanded = sc->tts_data[i].count == 1;
+    if (expanded)
+        return 0;
+    if (nb_samples >= UINT_MAX / sizeof(*tts_data))
+        return AVERROR_INVALIDDATA;
 
-        sc->tts_count = FFMAX(sc->tts_count, idx);
-    } else
-        sc->stts_count = 0;
-    av_freep(&sc->stts_data);
-    sc->stts_allocated_size = 0;
+    tts_data = av_fast_realloc(NULL, &allocated_size, nb_samples * sizeof(*tts_data));
+    if (!tts_data)
+        return AVERROR(ENOMEM);
+    memset(tts_data, 0, allocated_size);
+
+    for (unsigned int i = 0; i < sc->tts_count && idx < nb_samples; i++)
+        for (unsigned int j = 0; j < sc->tts_data[i].count && idx < nb_samples; j++) {
+            tts_data[idx] = sc->tts_data[i];
+            tts_data[idx++].count = 1;
+        }
+
+    av_free(sc->tts_data);
+    sc->tts_data           = tts_data;
+    sc->tts_allocated_size = allocated_size;
+    sc->tts_count          = idx;
+    sc->tts_index          = FFMIN(sc->current_sample, idx);
+    sc->tts_sample         = 0;
 
     return 0;
 }
@@ -5655,9 +5716,13 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         }
 
 #if FF_API_R_FRAME_RATE
-        for (unsigned int i = 1; sc->stts_count && i + 1 < sc->tts_count; i++) {
+        /* the entries are runs, only the duration of the last sample
+         * may differ */
+        for (unsigned int i = 1; sc->stts_count && i < sc->tts_count; i++) {
             if (sc->tts_data[i].duration == sc->tts_data[0].duration)
                 continue;
+            if (i + 1 == sc->tts_count && sc->tts_data[i].count == 1)
+                continue;
             stts_constant = 0;
         }
         if (stts_constant)
@@ -6198,7 +6263,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts, pts = AV_NOPTS_VALUE;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i;
+    int flags, distance, i, ret;
     int64_t prev_dts = AV_NOPTS_VALUE;
     int next_frag_index = -1, index_entry_pos;
     size_t requested_size;
@@ -6347,6 +6412,10 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         return AVERROR(ENOMEM);
     sti->index_entries= new_entries;
 
+    ret = mov_expand_tts_data(sc, sti->nb_index_entries);
+    if (ret < 0)
+        return ret;
+
     requested_size = (sti->nb_index_entries + entries) * sizeof(*sc->tts_data);
     old_allocated_size = sc->tts_allocated_size;
     tts_data = av_fast_realloc(sc->tts_data, &sc->tts_allocated_size,
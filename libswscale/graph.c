@@ -29,6 +29,7 @@
 #include "libavutil/pixdesc.h"
 #include "libavutil/refstruct.h"
 #include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
 
 #include "libswscale/swscale.h"
 #include "libswscale/format.h"
@@ -863,6 +864,227 @@ static int sws_graph_worker(void *priv, int jobnr, int threadnr, int nb_jobs,
     return 0;
 }
 
+/**
+ * A pass submitted to the shared pool. The slices are claimed one by one by
+ * the submitting thread and by the idle pool workers.
+ */
+typedef struct SwsPoolJob {
+    SwsGraph *graph;
+    int num_slices;
+    int next_slice; /* next slice to claim */
+    int nb_done;    /* number of finished slices */
+    struct SwsPoolJob *next;
+} SwsPoolJob;
+
+/**
+ * Process-wide slice thread pool, shared by all graphs with
+ * SwsContext.shared_threads set, so that the total number of worker threads
+ * stays bounded no matter how many scalers are active.
+ */
+typedef struct SwsThreadPool {
+    pthread_t *workers;
+    int nb_workers;
+    int num_threads; /* workers + the submitting thread */
+    int refcount;
+
+    AVMutex lock;
+    AVCond work_cond;  /* workers wait for jobs here */
+    AVCond done_cond;  /* submitters wait for their slices to finish here */
+    SwsPoolJob *jobs;  /* jobs with unclaimed slices, oldest first */
+    int die;
+} SwsThreadPool;
+
+static AVMutex thread_pool_lock = AV_MUTEX_INITIALIZER;
+static SwsThreadPool *thread_pool;
+
+/* Must be called with pool->lock held, and job must have unclaimed slices. */
+static int claim_slice_locked(SwsThreadPool *pool, SwsPoolJob *job)
+{
+    const int slice = job->next_slice++;
+
+    if (job->next_slice == job->num_slices) {
+        SwsPoolJob **p = &pool->jobs;
+        while (*p != job)
+            p = &(*p)->next;
+        *p = job->next;
+    }
+
+    return slice;
+}
+
+static void run_slice_locked(SwsThreadPool *pool, SwsPoolJob *job, int slice)
+{
+    ff_mutex_unlock(&pool->lock);
+    sws_graph_worker(job->graph, slice, 0, job->num_slices, 1);
+    ff_mutex_lock(&pool->lock);
+
+    if (++job->nb_done == job->num_slices)
+        ff_cond_broadcast(&pool->done_cond);
+}
+
+#if HAVE_THREADS
+static void *thread_pool_worker(void *arg)
+{
+    SwsThreadPool *pool = arg;
+
+    ff_mutex_lock(&pool->lock);
+    while (!pool->die) {
+        SwsPoolJob *job = pool->jobs;
+        if (!job) {
+            ff_cond_wait(&pool->work_cond, &pool->lock);
+            continue;
+        }
+
+        run_slice_locked(pool, job, claim_slice_locked(pool, job));
+    }
+    ff_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+#endif
+
+static void thread_pool_free(SwsThreadPool *pool)
+{
+    ff_mutex_lock(&pool->lock);
+    pool->die = 1;
+    ff_cond_broadcast(&pool->work_cond);
+    ff_mutex_unlock(&pool->lock);
+
+#if HAVE_THREADS
+    for (int i = 0; i < pool->nb_workers; i++)
+        pthread_join(pool->workers[i], NULL);
+#endif
+
+    ff_cond_destroy(&pool->done_cond);
+    ff_cond_destroy(&pool->work_cond);
+    ff_mutex_destroy(&pool->lock);
+    av_free(pool->workers);
+    av_free(pool);
+}
+
+static int thread_pool_alloc(SwsThreadPool **ppool)
+{
+#if HAVE_THREADS
+    SwsThreadPool *pool;
+    const int num_threads = av_cpu_count();
+    int ret;
+
+    pool = av_mallocz(sizeof(*pool));
+    if (!pool)
+        return AVERROR(ENOMEM);
+    pool->num_threads = num_threads;
+
+    pool->workers = av_calloc(num_threads, sizeof(*pool->workers));
+    if (!pool->workers) {
+        av_free(pool);
+        return AVERROR(ENOMEM);
+    }
+
+    if ((ret = ff_mutex_init(&pool->lock, NULL))) {
+        av_free(pool->workers);
+        av_free(pool);
+        return AVERROR(ret);
+    }
+    if ((ret = ff_cond_init(&pool->work_cond, NULL))) {
+        ff_mutex_destroy(&pool->lock);
+        av_free(pool->workers);
+        av_free(pool);
+        return AVERROR(ret);
+    }
+    if ((ret = ff_cond_init(&pool->done_cond, NULL))) {
+        ff_cond_destroy(&pool->work_cond);
+        ff_mutex_destroy(&pool->lock);
+        av_free(pool->workers);
+        av_free(pool);
+        return AVERROR(ret);
+    }
+
+    /* the thread submitting a pass processes slices as well */
+    for (; pool->nb_workers < num_threads - 1; pool->nb_workers++) {
+        ret = pthread_create(&pool->workers[pool->nb_workers], NULL,
+                             thread_pool_worker, pool);
+        if (ret) {
+            thread_pool_free(pool);
+            return AVERROR(ret);
+        }
+    }
+
+    *ppool = pool;
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
+static int thread_pool_ref(SwsThreadPool **ppool)
+{
+    int ret = 0;
+
+    ff_mutex_lock(&thread_pool_lock);
+    if (!thread_pool) {
+        ret = thread_pool_alloc(&thread_pool);
+        if (ret < 0)
+            goto end;
+    }
+
+    thread_pool->refcount++;
+    *ppool = thread_pool;
+end:
+    ff_mutex_unlock(&thread_pool_lock);
+    return ret;
+}
+
+static void thread_pool_unref(SwsThreadPool **ppool)
+{
+    SwsThreadPool *pool = *ppool;
+    if (!pool)
+        return;
+
+    ff_mutex_lock(&thread_pool_lock);
+    av_assert0(pool == thread_pool);
+    if (!--pool->refcount) {
+        thread_pool_free(pool);
+        thread_pool = NULL;
+    }
+    ff_mutex_unlock(&thread_pool_lock);
+
+    *ppool = NULL;
+}
+
+static void run_slices(SwsGraph *graph, const SwsPass *pass)
+{
+    SwsThreadPool *pool = graph->thread_pool;
+    SwsPoolJob job = {
+        .graph      = graph,
+        .num_slices = pass->num_slices,
+    };
+    SwsPoolJob **tail;
+
+    if (!pool) {
+        avpriv_slicethread_execute2(graph->slicethread, pass->num_slices, 0);
+        return;
+    }
+
+    /* Queue the pass for the idle workers, and process its slices on the
+     * calling thread as well; with the workers busy with other passes, it
+     * runs on the calling thread alone. */
+    ff_mutex_lock(&pool->lock);
+
+    tail = &pool->jobs;
+    while (*tail)
+        tail = &(*tail)->next;
+    *tail = &job;
+    ff_cond_broadcast(&pool->work_cond);
+
+    while (job.next_slice < job.num_slices)
+        run_slice_locked(pool, &job, claim_slice_locked(pool, &job));
+
+    while (job.nb_done < job.num_slices)
+        ff_cond_wait(&pool->done_cond, &pool->lock);
+
+    ff_mutex_unlock(&pool->lock);
+}
+
 SwsGraph *ff_sws_graph_alloc(void)
 {
     return av_mallocz(sizeof(SwsGraph));
@@ -871,6 +1093,7 @@ SwsGraph *ff_sws_graph_alloc(void)
 static void graph_uninit(SwsGraph *graph)
 {
     avpriv_slicethread_free(&graph->slicethread);
+    thread_pool_unref(&graph->thread_pool);
 
     for (int i = 0; i < graph->num_passes; i++)
         pass_free(graph->passes[i]);
@@ -900,6 +1123,17 @@ int ff_sws_graph_init(SwsGraph *graph, SwsContext *ctx, const SwsFormat *dst,
 
     if (ctx->threads == 1) {
         graph->num_threads = 1;
+    } else if (ctx->shared_threads) {
+        ret = thread_pool_ref(&graph->thread_pool);
+        if (ret == AVERROR(ENOSYS)) {
+            graph->num_threads = 1;
+        } else if (ret < 0) {
+            goto error;
+        } else {
+            graph->num_threads = graph->thread_pool->num_threads;
+            if (ctx->threads > 0)
+                graph->num_threads = FFMIN(graph->num_threads, ctx->threads);
+        }
     } else {
         ret = avpriv_slicethread_create2(&graph->slicethread, (void *) graph,
                                          sws_graph_worker, NULL, ctx->threads);
@@ -966,6 +1200,7 @@ static int opts_equal(const SwsContext *c1, const SwsContext *c2)
            c1->scaler        == c2->scaler        &&
            c1->scaler_sub    == c2->scaler_sub    &&
            c1->backends      == c2->backends      &&
+           c1->shared_threads == c2->shared_threads &&
            !memcmp(c1->scaler_params, c2->scaler_params, sizeof(c1->scaler_params));
 
 }
@@ -1046,7 +1281,7 @@ int ff_sws_graph_run(SwsGraph *graph, const AVFrame *dst, const AVFrame *src)
         if (pass->num_slices == 1) {
             pass->run(graph->exec.output, graph->exec.input, 0, pass->lines, pass);
         } else {
-            avpriv_slicethread_execute2(graph->slicethread, pass->num_slices, 0);
+            run_slices(graph, pass);
         }
     }
 
@@ -129,9 +129,12 @@ int ff_sws_pass_aligned_width(const SwsPass *pass, int width);
 /**
  * Filter graph, which represents a 'baked' pixel format conversion.
  */
+typedef struct SwsThreadPool SwsThreadPool;
+
 typedef struct SwsGraph {
     SwsContext *ctx;
     AVSliceThread *slicethread;
+    SwsThreadPool *thread_pool; /* shared pool, used instead of slicethread */
     int num_threads; /* resolved at init() time */
     bool incomplete; /* set during init() if formats had to be inferred */
     bool noop;       /* set during init() if the graph is a no-op */
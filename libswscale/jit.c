@@ -21,10 +21,7 @@
 
 #include "config.h"
 
-#include "libavutil/error.h"
-
-#include "jit.h"
-
+/* The feature macros must come before any system header is included */
 #if HAVE_MMAP && HAVE_MPROTECT
 #   define _DEFAULT_SOURCE
 #   define _SVID_SOURCE // needed for MAP_ANONYMOUS
@@ -35,6 +32,10 @@
 #   endif
 #endif
 
+#include "libavutil/error.h"
+
+#include "jit.h"
+
 #if HAVE_MMAP && HAVE_MPROTECT && defined(MAP_ANONYMOUS)
 
 void *ff_sws_jit_alloc(size_t size)
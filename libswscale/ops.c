@@ -35,12 +35,16 @@ extern const SwsOpBackend backend_c;
 extern const SwsOpBackend backend_murder;
 extern const SwsOpBackend backend_aarch64;
 extern const SwsOpBackend backend_x86;
+extern const SwsOpBackend backend_x86_jit;
 #if HAVE_SPIRV_HEADERS_SPIRV_H || HAVE_SPIRV_UNIFIED1_SPIRV_H
 extern const SwsOpBackend backend_spirv;
 #endif
 
 const SwsOpBackend * const ff_sws_op_backends[] = {
     &backend_murder,
+#if ARCH_X86_64
+    &backend_x86_jit,
+#endif
 #if ARCH_AARCH64 && HAVE_NEON && 0
     &backend_aarch64,
 #elif ARCH_X86_64 && HAVE_X86ASM && 0
@@ -1393,7 +1393,8 @@ int sws_receive_slice(SwsContext *sws, unsigned int slice_start,
     }
 
     for (int i = 0; i < FF_ARRAY_ELEMS(dst); i++) {
-        ptrdiff_t offset = c->frame_dst->linesize[i] * (ptrdiff_t)(slice_start >> c->chrDstVSubSample);
+        const int vshift = (i == 1 || i == 2) ? c->chrDstVSubSample : 0;
+        ptrdiff_t offset = c->frame_dst->linesize[i] * (ptrdiff_t)(slice_start >> vshift);
         dst[i] = FF_PTR_ADD(c->frame_dst->data[i], offset);
     }
 
@@ -1611,7 +1612,7 @@ int sws_frame_setup(SwsContext *ctx, const AVFrame *dst, const AVFrame *src)
 
     if (!dst->hw_frames_ctx) {
         ret = ff_frame_pool_video_reinit(&s->frame_pool, dst_width, dst->height,
-                                         dst->format, av_cpu_max_align());
+                                         dst->format, av_cpu_max_align(), 0);
         if (ret < 0)
             return ret;
     }
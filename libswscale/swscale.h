@@ -311,6 +311,20 @@ typedef struct SwsContext {
      */
     SwsBackend backends;
 
+    /**
+     * If set, slice threading uses a single process-wide thread pool shared
+     * by all contexts with this option enabled, instead of creating private
+     * threads for each context. The pool has one thread per CPU core. A
+     * `SwsContext.threads` value of 1 still disables threading, other non-zero
+     * values limit the number of slices a frame is split into. Frames from
+     * several contexts are queued on the pool and their slices are shared
+     * among the pool threads; the calling thread also processes slices of
+     * its own frame until it is done.
+     *
+     * Note: Does not affect the legacy (stateful) API.
+     */
+    int shared_threads;
+
     /* Remember to add new fields to graph.c:opts_equal() */
 } SwsContext;
 
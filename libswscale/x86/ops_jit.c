@@ -0,0 +1,1493 @@
+/**
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Runtime code generator for micro-op lists (AVX2).
+ *
+ * Instead of chaining pre-assembled kernels, this backend emits one function
+ * per SwsUOpList, with the whole list fused into a single loop body. Each
+ * component lives in exactly one vector register for the entire block, so
+ * there are no intermediate loads/stores and no continuation calls.
+ *
+ * The block size is chosen such that the widest component fits into a single
+ * ymm register. Narrower components occupy the low bytes of a register.
+ * Anything that can't be expressed (yet) fails with AVERROR(ENOTSUP), letting
+ * the dispatcher fall back to the next backend.
+ */
+
+#include <string.h>
+
+#include "config.h"
+
+#include "libavutil/avassert.h"
+#include "libavutil/cpu.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/cpu.h"
+
+#include "../jit.h"
+#include "../ops_internal.h"
+#include "../uops.h"
+
+enum {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8,  R9,  R10, R11, R12, R13, R14, R15,
+};
+
+/* Fixed GPR assignment; see emit_function() */
+static const int8_t in_regs[4]  = { R8,  R9,  R10, R11 };
+static const int8_t out_regs[4] = { R12, R13, R14, R15 };
+#define REG_EXEC    RDI
+#define REG_BLOCKS  RBX
+#define REG_Y       RBP
+#define REG_X       RDX
+
+/* Stack slots */
+#define STACK_Y_END     0
+#define STACK_BLOCKS    8
+#define STACK_X_START   16
+#define STACK_SIZE      24
+
+#define NB_VREGS 16
+
+enum JitOperandKind {
+    OPND_REG,
+    OPND_MEM,   /* [reg + (index << shift) + disp] */
+    OPND_DATA,  /* [rip + data section offset `disp`] */
+};
+
+typedef struct JitOperand {
+    uint8_t kind;
+    int8_t  reg;
+    int8_t  index;
+    uint8_t shift;
+    int32_t disp;
+} JitOperand;
+
+static inline JitOperand reg(int r)
+{
+    return (JitOperand) { .kind = OPND_REG, .reg = r, .index = -1 };
+}
+
+static inline JitOperand mem(int base, int32_t disp)
+{
+    return (JitOperand) { .kind = OPND_MEM, .reg = base, .index = -1, .disp = disp };
+}
+
+static inline JitOperand mem_idx(int base, int index, int shift, int32_t disp)
+{
+    return (JitOperand) { .kind = OPND_MEM, .reg = base, .index = index,
+                          .shift = shift, .disp = disp };
+}
+
+typedef struct JitFixup {
+    int pos;    /* position of the rel32 displacement */
+    int end;    /* end of the instruction, which rel32 is relative to */
+    int data;   /* target offset inside the data section */
+} JitFixup;
+
+typedef struct JitData {
+    int offset;
+    int size;
+} JitData;
+
+typedef struct JitContext {
+    SwsContext *ctx;
+    int error;
+    int block_size;
+    bool fma;
+
+    uint8_t *code;
+    int code_size, code_alloc;
+    uint8_t *data;
+    int data_size, data_alloc;
+    JitData *consts;
+    int nb_consts;
+    JitFixup *fixups;
+    int nb_fixups;
+
+    /* Vector register allocation */
+    int8_t comp[4];     /* register holding each component, or -1 */
+    int8_t tmp;         /* temporary used by SWS_UOP_PERMUTE/COPY */
+    uint8_t refs[NB_VREGS];
+} JitContext;
+
+typedef struct JitFunc {
+    uint8_t *mem;
+    size_t size;
+} JitFunc;
+
+/*********************
+ * Buffer management *
+ *********************/
+
+static int grow(JitContext *s, uint8_t **buf, int *alloc, int size)
+{
+    if (s->error < 0)
+        return s->error;
+    if (size <= *alloc)
+        return 0;
+
+    const int new_alloc = FFMAX(size, 2 * *alloc);
+    uint8_t *ptr = av_realloc(*buf, new_alloc);
+    if (!ptr)
+        return s->error = AVERROR(ENOMEM);
+    *buf = ptr;
+    *alloc = new_alloc;
+    return 0;
+}
+
+static void emit_bytes(JitContext *s, const void *bytes, int size)
+{
+    if (grow(s, &s->code, &s->code_alloc, s->code_size + size) < 0)
+        return;
+    memcpy(&s->code[s->code_size], bytes, size);
+    s->code_size += size;
+}
+
+static void emit_u8(JitContext *s, int value)
+{
+    const uint8_t byte = value;
+    emit_bytes(s, &byte, 1);
+}
+
+static void emit_u32(JitContext *s, uint32_t value)
+{
+    uint8_t bytes[4];
+    AV_WL32(bytes, value);
+    emit_bytes(s, bytes, 4);
+}
+
+/* Add constant data, returning an operand referencing it */
+static JitOperand add_data(JitContext *s, const void *data, int size)
+{
+    JitOperand op = { .kind = OPND_DATA, .index = -1 };
+    const int align = size > 16 ? 32 : 16;
+
+    /* De-duplicate small constants */
+    for (int i = 0; size <= 32 && i < s->nb_consts; i++) {
+        const JitData *c = &s->consts[i];
+        if (c->size == size && !memcmp(&s->data[c->offset], data, size)) {
+            op.disp = c->offset;
+            return op;
+        }
+    }
+
+    const int offset = FFALIGN(s->data_size, align);
+    if (grow(s, &s->data, &s->data_alloc, offset + size) < 0)
+        return op;
+    memset(&s->data[s->data_size], 0, offset - s->data_size);
+    memcpy(&s->data[offset], data, size);
+    s->data_size = offset + size;
+
+    if (size <= 32) {
+        JitData *consts = av_realloc_array(s->consts, s->nb_consts + 1,
+                                           sizeof(*consts));
+        if (!consts) {
+            s->error = AVERROR(ENOMEM);
+            return op;
+        }
+        consts[s->nb_consts++] = (JitData) { offset, size };
+        s->consts = consts;
+    }
+
+    op.disp = offset;
+    return op;
+}
+
+/* Splat a pixel value across a full 32-byte constant */
+static JitOperand splat(JitContext *s, SwsPixelType type, uint32_t value)
+{
+    uint8_t buf[32];
+    for (int i = 0; i < 32; i += ff_sws_pixel_type_size(type)) {
+        switch (type) {
+        case SWS_PIXEL_U8:  buf[i] = value; break;
+        case SWS_PIXEL_U16: AV_WL16(&buf[i], value); break;
+        default:            AV_WL32(&buf[i], value); break;
+        }
+    }
+    return add_data(s, buf, sizeof(buf));
+}
+
+static void add_fixup(JitContext *s, int pos, int end, int data)
+{
+    JitFixup *fixups = av_realloc_array(s->fixups, s->nb_fixups + 1,
+                                        sizeof(*fixups));
+    if (!fixups) {
+        s->error = AVERROR(ENOMEM);
+        return;
+    }
+    fixups[s->nb_fixups++] = (JitFixup) { pos, end, data };
+    s->fixups = fixups;
+}
+
+/***********************
+ * Instruction encoder *
+ ***********************/
+
+static void emit_modrm(JitContext *s, int r, JitOperand rm, int imm_bytes)
+{
+    r &= 7;
+    switch (rm.kind) {
+    case OPND_REG:
+        emit_u8(s, 0xC0 | r << 3 | (rm.reg & 7));
+        return;
+    case OPND_DATA:
+        emit_u8(s, r << 3 | 5);
+        add_fixup(s, s->code_size, s->code_size + 4 + imm_bytes, rm.disp);
+        emit_u32(s, 0);
+        return;
+    case OPND_MEM: {
+        const int base = rm.reg & 7;
+        const int mod = (!rm.disp && base != 5)   ? 0 :
+                        (rm.disp == (int8_t) rm.disp) ? 1 : 2;
+        if (rm.index >= 0 || base == RSP) {
+            const int index = rm.index >= 0 ? rm.index & 7 : RSP;
+            emit_u8(s, mod << 6 | r << 3 | 4);
+            emit_u8(s, rm.shift << 6 | index << 3 | base);
+        } else {
+            emit_u8(s, mod << 6 | r << 3 | base);
+        }
+        if (mod == 1)
+            emit_u8(s, rm.disp);
+        else if (mod == 2)
+            emit_u32(s, rm.disp);
+        return;
+    }
+    }
+}
+
+static inline int rex_b(JitOperand rm)
+{
+    return rm.kind != OPND_DATA ? (rm.reg >> 3) & 1 : 0;
+}
+
+static inline int rex_x(JitOperand rm)
+{
+    return rm.kind == OPND_MEM && rm.index >= 0 ? (rm.index >> 3) & 1 : 0;
+}
+
+/* Legacy/REX encoded GPR instruction; `op` may be a two byte 0x0F opcode */
+static void emit_op(JitContext *s, int w, int op, int r, JitOperand rm,
+                    int imm_bytes)
+{
+    const int rex = w << 3 | ((r >> 3) & 1) << 2 | rex_x(rm) << 1 | rex_b(rm);
+    if (rex)
+        emit_u8(s, 0x40 | rex);
+    if (op > 0xFF)
+        emit_u8(s, op >> 8);
+    emit_u8(s, op & 0xFF);
+    emit_modrm(s, r, rm, imm_bytes);
+}
+
+#define MAP_0F      1
+#define MAP_0F38    2
+#define MAP_0F3A    3
+#define PP_NONE     0
+#define PP_66       1
+#define PP_F3       2
+
+#define INSN(map, pp, w, op) ((map) << 16 | (pp) << 12 | (w) << 8 | (op))
+
+enum {
+    VMOVDQU_LD   = INSN(MAP_0F,   PP_F3,   0, 0x6F),
+    VMOVDQU_ST   = INSN(MAP_0F,   PP_F3,   0, 0x7F),
+    VMOVDQA      = INSN(MAP_0F,   PP_66,   0, 0x6F),
+    VMOVQ_LD     = INSN(MAP_0F,   PP_F3,   0, 0x7E),
+    VMOVQ_ST     = INSN(MAP_0F,   PP_66,   0, 0xD6),
+    VPSHUFB      = INSN(MAP_0F38, PP_66,   0, 0x00),
+    VPAND        = INSN(MAP_0F,   PP_66,   0, 0xDB),
+    VPOR         = INSN(MAP_0F,   PP_66,   0, 0xEB),
+    VPXOR        = INSN(MAP_0F,   PP_66,   0, 0xEF),
+    VPADDB       = INSN(MAP_0F,   PP_66,   0, 0xFC),
+    VPADDW       = INSN(MAP_0F,   PP_66,   0, 0xFD),
+    VPADDD       = INSN(MAP_0F,   PP_66,   0, 0xFE),
+    VPMULLW      = INSN(MAP_0F,   PP_66,   0, 0xD5),
+    VPMULLD      = INSN(MAP_0F38, PP_66,   0, 0x40),
+    VPSHIFTW     = INSN(MAP_0F,   PP_66,   0, 0x71), /* /6 = left, /2 = right */
+    VPSHIFTD     = INSN(MAP_0F,   PP_66,   0, 0x72),
+    VPMINUB      = INSN(MAP_0F,   PP_66,   0, 0xDA),
+    VPMINUW      = INSN(MAP_0F38, PP_66,   0, 0x3A),
+    VPMINUD      = INSN(MAP_0F38, PP_66,   0, 0x3B),
+    VPMAXUB      = INSN(MAP_0F,   PP_66,   0, 0xDE),
+    VPMAXUW      = INSN(MAP_0F38, PP_66,   0, 0x3E),
+    VPMAXUD      = INSN(MAP_0F38, PP_66,   0, 0x3F),
+    VPCMPEQB     = INSN(MAP_0F,   PP_66,   0, 0x74),
+    VPCMPEQW     = INSN(MAP_0F,   PP_66,   0, 0x75),
+    VPCMPEQD     = INSN(MAP_0F,   PP_66,   0, 0x76),
+    VPMOVZXBW    = INSN(MAP_0F38, PP_66,   0, 0x30),
+    VPMOVZXBD    = INSN(MAP_0F38, PP_66,   0, 0x31),
+    VPMOVZXWD    = INSN(MAP_0F38, PP_66,   0, 0x33),
+    VCVTDQ2PS    = INSN(MAP_0F,   PP_NONE, 0, 0x5B),
+    VCVTTPS2DQ   = INSN(MAP_0F,   PP_F3,   0, 0x5B),
+    VADDPS       = INSN(MAP_0F,   PP_NONE, 0, 0x58),
+    VMULPS       = INSN(MAP_0F,   PP_NONE, 0, 0x59),
+    VSUBPS       = INSN(MAP_0F,   PP_NONE, 0, 0x5C),
+    VMINPS       = INSN(MAP_0F,   PP_NONE, 0, 0x5D),
+    VMAXPS       = INSN(MAP_0F,   PP_NONE, 0, 0x5F),
+    VCMPPS       = INSN(MAP_0F,   PP_NONE, 0, 0xC2),
+    VBLENDVPS    = INSN(MAP_0F3A, PP_66,   0, 0x4A),
+    VFMADD231PS  = INSN(MAP_0F38, PP_66,   0, 0xB8),
+    VINSERTI128  = INSN(MAP_0F3A, PP_66,   0, 0x38),
+    VEXTRACTI128 = INSN(MAP_0F3A, PP_66,   0, 0x39),
+};
+
+/* VEX encoded instruction; pass imm < 0 for none */
+static void emit_vex(JitContext *s, int insn, int l, int r, int vvvv,
+                     JitOperand rm, int imm)
+{
+    const int map = insn >> 16, pp = (insn >> 12) & 0xF, w = (insn >> 8) & 0xF;
+    const int nr = !((r >> 3) & 1), nx = !rex_x(rm), nb = !rex_b(rm);
+    const int vex = (~vvvv & 0xF) << 3 | l << 2 | pp;
+
+    if (map == MAP_0F && !w && nx && nb) {
+        emit_u8(s, 0xC5);
+        emit_u8(s, nr << 7 | vex);
+    } else {
+        emit_u8(s, 0xC4);
+        emit_u8(s, nr << 7 | nx << 6 | nb << 5 | map);
+        emit_u8(s, w << 7 | vex);
+    }
+    emit_u8(s, insn & 0xFF);
+    emit_modrm(s, r, rm, imm >= 0);
+    if (imm >= 0)
+        emit_u8(s, imm);
+}
+
+/* Three-operand vector op; `bytes` selects between xmm and ymm */
+static void vop(JitContext *s, int insn, int bytes, int dst, int src,
+                JitOperand rm)
+{
+    emit_vex(s, insn, bytes > 16, dst, src, rm, -1);
+}
+
+static void vshift(JitContext *s, int insn, int ext, int bytes, int dst,
+                   int src, int amount)
+{
+    emit_vex(s, insn, bytes > 16, ext, dst, reg(src), amount);
+}
+
+static void vload(JitContext *s, int bytes, int dst, JitOperand src)
+{
+    if (bytes <= 8)
+        emit_vex(s, VMOVQ_LD, 0, dst, 0, src, -1);
+    else
+        emit_vex(s, VMOVDQU_LD, bytes > 16, dst, 0, src, -1);
+}
+
+static void vstore(JitContext *s, int bytes, JitOperand dst, int src)
+{
+    if (bytes <= 8)
+        emit_vex(s, VMOVQ_ST, 0, src, 0, dst, -1);
+    else
+        emit_vex(s, VMOVDQU_ST, bytes > 16, src, 0, dst, -1);
+}
+
+static void vzero(JitContext *s, int dst)
+{
+    vop(s, VPXOR, 16, dst, dst, reg(dst));
+}
+
+/* 64-bit GPR helpers */
+static void mov_rm(JitContext *s, int dst, JitOperand src)  { emit_op(s, 1, 0x8B, dst, src, 0); }
+static void mov_mr(JitContext *s, JitOperand dst, int src)  { emit_op(s, 1, 0x89, src, dst, 0); }
+static void movsxd(JitContext *s, int dst, JitOperand src)  { emit_op(s, 1, 0x63, dst, src, 0); }
+static void add_rm(JitContext *s, int dst, JitOperand src)  { emit_op(s, 1, 0x03, dst, src, 0); }
+static void sub_rm(JitContext *s, int dst, JitOperand src)  { emit_op(s, 1, 0x2B, dst, src, 0); }
+static void cmp_rm(JitContext *s, int dst, JitOperand src)  { emit_op(s, 1, 0x3B, dst, src, 0); }
+static void imul_rm(JitContext *s, int dst, JitOperand src) { emit_op(s, 1, 0x0FAF, dst, src, 0); }
+static void lea(JitContext *s, int dst, JitOperand src)     { emit_op(s, 1, 0x8D, dst, src, 0); }
+static void test_rr(JitContext *s, int a, int b)            { emit_op(s, 1, 0x85, b, reg(a), 0); }
+
+enum { ALU_ADD = 0, ALU_AND = 4, ALU_SUB = 5 };
+
+static void alu_ri(JitContext *s, int ext, int dst, int32_t imm)
+{
+    emit_op(s, 1, 0x81, ext, reg(dst), 4);
+    emit_u32(s, imm);
+}
+
+static void shl_ri(JitContext *s, int dst, int amount)
+{
+    if (!amount)
+        return;
+    emit_op(s, 1, 0xC1, 4, reg(dst), 1);
+    emit_u8(s, amount);
+}
+
+static void push(JitContext *s, int r)
+{
+    if (r >= R8)
+        emit_u8(s, 0x41);
+    emit_u8(s, 0x50 | (r & 7));
+}
+
+static void pop(JitContext *s, int r)
+{
+    if (r >= R8)
+        emit_u8(s, 0x41);
+    emit_u8(s, 0x58 | (r & 7));
+}
+
+enum { CC_Z = 0x4, CC_NZ = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE };
+
+/* Emits a forward jump, returning the position to patch */
+static int jcc_fwd(JitContext *s, int cc)
+{
+    emit_u8(s, 0x0F);
+    emit_u8(s, 0x80 | cc);
+    emit_u32(s, 0);
+    return s->code_size - 4;
+}
+
+static void jcc_back(JitContext *s, int cc, int target)
+{
+    emit_u8(s, 0x0F);
+    emit_u8(s, 0x80 | cc);
+    emit_u32(s, target - (s->code_size + 4));
+}
+
+static void patch_jump(JitContext *s, int pos)
+{
+    if (s->error >= 0)
+        AV_WL32(&s->code[pos], s->code_size - (pos + 4));
+}
+
+/****************************
+ * Vector register handling *
+ ****************************/
+
+static int alloc_reg(JitContext *s)
+{
+    for (int r = 0; r < NB_VREGS; r++) {
+        if (!s->refs[r]) {
+            s->refs[r] = 1;
+            return r;
+        }
+    }
+
+    /* Out of registers; give up on this uop list */
+    if (s->error >= 0)
+        s->error = AVERROR(ENOTSUP);
+    return 0;
+}
+
+static void unref_reg(JitContext *s, int r)
+{
+    if (r >= 0 && s->refs[r])
+        s->refs[r]--;
+}
+
+static int free_regs(const JitContext *s)
+{
+    int count = 0;
+    for (int r = 0; r < NB_VREGS; r++)
+        count += !s->refs[r];
+    return count;
+}
+
+/* Takes over the reference to `r` */
+static void set_comp(JitContext *s, int c, int r)
+{
+    unref_reg(s, s->comp[c]);
+    s->comp[c] = r;
+}
+
+static int get_comp(JitContext *s, int c)
+{
+    if (s->comp[c] < 0) {
+        /* Reading an undefined component; produce well-defined garbage */
+        s->comp[c] = alloc_reg(s);
+        vzero(s, s->comp[c]);
+    }
+    return s->comp[c];
+}
+
+/*****************************
+ * Byte permutation networks *
+ *****************************/
+
+/**
+ * A 16-byte lane of source data: either (half of) a vector register, or
+ * 8/16 bytes of memory.
+ */
+typedef struct JitLane {
+    int8_t  reg;    /* vector register, or -1 for memory */
+    int8_t  high;   /* upper 128 bits of `reg` */
+    int8_t  base;   /* GPR base address for memory lanes */
+    int8_t  bytes;  /* number of valid bytes */
+    int32_t off;
+} JitLane;
+
+static int comp_lanes(JitLane *lanes, int r, int bytes)
+{
+    lanes[0] = (JitLane) { .reg = r, .bytes = FFMIN(bytes, 16) };
+    if (bytes <= 16)
+        return 1;
+    lanes[1] = (JitLane) { .reg = r, .high = 1, .bytes = 16 };
+    return 2;
+}
+
+static int load_lane(JitContext *s, const JitLane *lane, int tmp)
+{
+    if (lane->reg >= 0 && !lane->high)
+        return lane->reg;
+    if (lane->reg >= 0)
+        emit_vex(s, VEXTRACTI128, 1, lane->reg, 0, reg(tmp), 1);
+    else
+        vload(s, lane->bytes, tmp, mem(lane->base, lane->off));
+    return tmp;
+}
+
+/**
+ * Assemble 16 bytes into the xmm register `dst`. Byte `i` is taken from
+ * `map[i]`, indexing into the concatenation of all 16-byte lanes, or zeroed
+ * if negative.
+ */
+static void gather_lane(JitContext *s, int dst, const JitLane *lanes,
+                        int nb_lanes, const int map[16])
+{
+    int used[8] = {0}, nb_used = 0;
+    av_assert1(nb_lanes <= FF_ARRAY_ELEMS(used));
+    for (int i = 0; i < 16; i++) {
+        if (map[i] >= 0 && map[i] < 16 * nb_lanes && !used[map[i] >> 4]++)
+            nb_used++;
+    }
+
+    int scratch = -1;
+    bool first = true;
+    for (int k = 0; k < nb_lanes; k++) {
+        if (!used[k])
+            continue;
+
+        uint8_t mask[16];
+        bool identity = true;
+        for (int i = 0; i < 16; i++) {
+            const int idx = map[i] - 16 * k;
+            mask[i] = (map[i] >= 0 && idx >= 0 && idx < 16) ? idx : 0x80;
+            identity &= mask[i] == i;
+        }
+
+        if (first && nb_used == 1 && identity) {
+            const int src = load_lane(s, &lanes[k], dst);
+            if (src != dst)
+                vop(s, VMOVDQA, 16, dst, 0, reg(src));
+            return;
+        }
+
+        if (first) {
+            const int src = load_lane(s, &lanes[k], dst);
+            vop(s, VPSHUFB, 16, dst, src, add_data(s, mask, 16));
+            first = false;
+        } else {
+            if (scratch < 0)
+                scratch = alloc_reg(s);
+            const int src = load_lane(s, &lanes[k], scratch);
+            vop(s, VPSHUFB, 16, scratch, src, add_data(s, mask, 16));
+            vop(s, VPOR, 16, dst, dst, reg(scratch));
+        }
+    }
+
+    if (first)
+        vzero(s, dst);
+    unref_reg(s, scratch);
+}
+
+/* Gather `bytes` bytes into a newly allocated register */
+static int gather(JitContext *s, int bytes, const JitLane *lanes, int nb_lanes,
+                  const int *map)
+{
+    const int dst = alloc_reg(s);
+    gather_lane(s, dst, lanes, nb_lanes, map);
+    if (bytes > 16) {
+        const int hi = alloc_reg(s);
+        gather_lane(s, hi, lanes, nb_lanes, &map[16]);
+        emit_vex(s, VINSERTI128, 1, dst, dst, reg(hi), 1);
+        unref_reg(s, hi);
+    }
+    return dst;
+}
+
+/* Integer cast by truncation / zero extension */
+static int int_cast(JitContext *s, int src, SwsPixelType from, SwsPixelType to)
+{
+    const int isize = ff_sws_pixel_type_size(from);
+    const int osize = ff_sws_pixel_type_size(to);
+    const int bytes = s->block_size * osize;
+
+    if (isize == osize) {
+        s->refs[src]++;
+        return src;
+    }
+
+    if (isize < osize) {
+        const int insn = isize == 2 ? VPMOVZXWD :
+                         osize == 2 ? VPMOVZXBW : VPMOVZXBD;
+        const int dst = alloc_reg(s);
+        vop(s, insn, bytes, dst, 0, reg(src));
+        return dst;
+    }
+
+    JitLane lanes[2];
+    const int nb_lanes = comp_lanes(lanes, src, s->block_size * isize);
+    int map[32];
+    for (int i = 0; i < 32; i++)
+        map[i] = i < bytes ? i % osize + isize * (i / osize) : -1;
+    return gather(s, bytes, lanes, nb_lanes, map);
+}
+
+/*****************
+ * Uop emitters  *
+ *****************/
+
+#define COMP_BYTES(type) (s->block_size * ff_sws_pixel_type_size(type))
+
+static int packed_elems(SwsCompMask mask)
+{
+    return SWS_COMP_TEST(mask, 3) ? 4 : SWS_COMP_TEST(mask, 2) ? 3 :
+           SWS_COMP_TEST(mask, 1) ? 2 : 1;
+}
+
+static int emit_read(JitContext *s, const SwsUOp *uop)
+{
+    const int size  = ff_sws_pixel_type_size(uop->type);
+    const int bytes = COMP_BYTES(uop->type);
+
+    if (uop->uop == SWS_UOP_READ_PLANAR) {
+        for (int c = 0; c < 4; c++) {
+            if (!SWS_COMP_TEST(uop->mask, c))
+                continue;
+            const int r = alloc_reg(s);
+            vload(s, bytes, r, mem(in_regs[c], 0));
+            alu_ri(s, ALU_ADD, in_regs[c], bytes);
+            set_comp(s, c, r);
+        }
+        return 0;
+    }
+
+    const int elems = packed_elems(uop->mask);
+    const int total = bytes * elems;
+    if (uop->mask != SWS_COMP_ELEMS(elems))
+        return AVERROR(ENOTSUP);
+
+    for (int c = 0; c < elems; c++)
+        set_comp(s, c, -1);
+
+    /* Load all source lanes up front, if there is enough room */
+    JitLane lanes[8];
+    const int nb_lanes = (total + 15) >> 4;
+    const bool preload = free_regs(s) >= nb_lanes + elems + 2;
+    for (int k = 0; k < nb_lanes; k++) {
+        lanes[k] = (JitLane) {
+            .reg   = -1,
+            .base  = in_regs[0],
+            .off   = 16 * k,
+            .bytes = FFMIN(total - 16 * k, 16),
+        };
+        if (preload) {
+            const int r = alloc_reg(s);
+            vload(s, lanes[k].bytes, r, mem(in_regs[0], lanes[k].off));
+            lanes[k].reg = r;
+        }
+    }
+
+    for (int c = 0; c < elems; c++) {
+        int map[32];
+        for (int i = 0; i < 32; i++) {
+            const int px = i / size;
+            map[i] = i < bytes ? (px * elems + c) * size + i % size : -1;
+        }
+        set_comp(s, c, gather(s, bytes, lanes, nb_lanes, map));
+    }
+
+    for (int k = 0; preload && k < nb_lanes; k++)
+        unref_reg(s, lanes[k].reg);
+
+    alu_ri(s, ALU_ADD, in_regs[0], total);
+    return 0;
+}
+
+static int emit_write(JitContext *s, const SwsUOp *uop)
+{
+    const int size  = ff_sws_pixel_type_size(uop->type);
+    const int bytes = COMP_BYTES(uop->type);
+
+    if (uop->uop == SWS_UOP_WRITE_PLANAR) {
+        for (int c = 0; c < 4; c++) {
+            if (!SWS_COMP_TEST(uop->mask, c))
+                continue;
+            vstore(s, bytes, mem(out_regs[c], 0), get_comp(s, c));
+            alu_ri(s, ALU_ADD, out_regs[c], bytes);
+        }
+        return 0;
+    }
+
+    const int elems = packed_elems(uop->mask);
+    const int total = bytes * elems;
+    const int comp_stride = bytes > 16 ? 2 : 1; /* lanes per component */
+    if (uop->mask != SWS_COMP_ELEMS(elems))
+        return AVERROR(ENOTSUP);
+
+    /* Pre-extract the upper halves, since they are needed repeatedly */
+    JitLane lanes[8];
+    int extracted[4] = { -1, -1, -1, -1 };
+    for (int c = 0; c < elems; c++) {
+        JitLane *l = &lanes[c * comp_stride];
+        comp_lanes(l, get_comp(s, c), bytes);
+        if (bytes > 16 && free_regs(s) > 2) {
+            extracted[c] = alloc_reg(s);
+            load_lane(s, &l[1], extracted[c]);
+            l[1] = (JitLane) { .reg = extracted[c], .bytes = 16 };
+        }
+    }
+
+    const int tmp = alloc_reg(s);
+    for (int off = 0; off < total; off += 16) {
+        int map[16];
+        for (int i = 0; i < 16; i++) {
+            const int pos = off + i;
+            const int px  = pos / (size * elems);
+            const int c   = (pos / size) % elems;
+            map[i] = 16 * c * comp_stride + px * size + pos % size;
+        }
+        gather_lane(s, tmp, lanes, elems * comp_stride, map);
+        vstore(s, FFMIN(total - off, 16), mem(out_regs[0], off), tmp);
+    }
+    unref_reg(s, tmp);
+
+    for (int c = 0; c < elems; c++)
+        unref_reg(s, extracted[c]);
+
+    alu_ri(s, ALU_ADD, out_regs[0], total);
+    return 0;
+}
+
+static int emit_move(JitContext *s, const SwsUOp *uop)
+{
+    const SwsMoveUOp *move = &uop->par.move;
+    int8_t regs[5] = { s->tmp, s->comp[0], s->comp[1], s->comp[2], s->comp[3] };
+
+    /* Both permutations and copies are just register renames here, since
+     * every uop writes its results to freshly allocated registers */
+    for (int n = 0; n < move->num_moves; n++)
+        regs[move->dst[n] + 1] = regs[move->src[n] + 1];
+
+    uint8_t refs[NB_VREGS] = {0};
+    for (int c = 0; c < 4; c++) {
+        if (SWS_COMP_TEST(uop->mask, c) && regs[c + 1] >= 0)
+            refs[regs[c + 1]]++;
+    }
+
+    /* Re-derive reference counts, dropping anything no longer reachable */
+    memcpy(s->refs, refs, sizeof(refs));
+    for (int c = 0; c < 4; c++)
+        s->comp[c] = SWS_COMP_TEST(uop->mask, c) ? regs[c + 1] : -1;
+    s->tmp = -1;
+    return 0;
+}
+
+static int emit_cast(JitContext *s, const SwsUOp *uop)
+{
+    const SwsPixelType from = uop->type;
+    const int ibytes = COMP_BYTES(from);
+    SwsPixelType to;
+    switch (uop->uop) {
+    case SWS_UOP_TO_U8:  to = SWS_PIXEL_U8;  break;
+    case SWS_UOP_TO_U16: to = SWS_PIXEL_U16; break;
+    case SWS_UOP_TO_U32: to = SWS_PIXEL_U32; break;
+    case SWS_UOP_TO_F32: to = SWS_PIXEL_F32; break;
+    default: return AVERROR_BUG;
+    }
+    const int obytes = COMP_BYTES(to);
+
+    for (int c = 0; c < 4; c++) {
+        if (!SWS_COMP_TEST(uop->mask, c)) {
+            set_comp(s, c, -1);
+            continue;
+        }
+
+        const int src = get_comp(s, c);
+        int dst;
+
+        if (from == to) {
+            continue;
+        } else if (from != SWS_PIXEL_F32 && to != SWS_PIXEL_F32) {
+            dst = int_cast(s, src, from, to);
+        } else if (from == SWS_PIXEL_U32) {
+            /* Unsigned conversion, split into two exactly representable
+             * halves so the final sum is rounded only once */
+            const int hi = alloc_reg(s);
+            dst = alloc_reg(s);
+            vshift(s, VPSHIFTD, 2, obytes, hi, src, 16);
+            vop(s, VPAND, obytes, dst, src, splat(s, SWS_PIXEL_U32, 0xFFFF));
+            vop(s, VCVTDQ2PS, obytes, hi, 0, reg(hi));
+            vop(s, VCVTDQ2PS, obytes, dst, 0, reg(dst));
+            vop(s, VMULPS, obytes, hi, hi, splat(s, SWS_PIXEL_F32, 0x47800000)); /* 65536.0f */
+            vop(s, VADDPS, obytes, dst, dst, reg(hi));
+            unref_reg(s, hi);
+        } else if (to == SWS_PIXEL_F32) {
+            dst = int_cast(s, src, from, SWS_PIXEL_U32);
+            vop(s, VCVTDQ2PS, obytes, dst, 0, reg(dst));
+        } else {
+            /* Float to int, with values >= 2^31 handled separately */
+            const JitOperand bias = splat(s, SWS_PIXEL_F32, 0x4F000000); /* 2^31 */
+            const int lo = alloc_reg(s);
+            vop(s, VCVTTPS2DQ, ibytes, lo, 0, reg(src));
+            if (to == SWS_PIXEL_U32) {
+                const int hi = alloc_reg(s), sel = alloc_reg(s);
+                vop(s, VSUBPS, ibytes, hi, src, bias);
+                vop(s, VCVTTPS2DQ, ibytes, hi, 0, reg(hi));
+                vop(s, VPXOR, ibytes, hi, hi, splat(s, SWS_PIXEL_U32, 0x80000000));
+                emit_vex(s, VCMPPS, 1, sel, src, bias, 0x1D); /* GE_OQ */
+                emit_vex(s, VBLENDVPS, 1, lo, lo, reg(hi), sel << 4);
+                unref_reg(s, hi);
+                unref_reg(s, sel);
+                dst = lo;
+            } else {
+                dst = int_cast(s, lo, SWS_PIXEL_U32, to);
+                unref_reg(s, lo);
+            }
+        }
+
+        set_comp(s, c, dst);
+    }
+
+    return 0;
+}
+
+static int emit_bits(JitContext *s, const SwsUOp *uop)
+{
+    const SwsPixelType type = uop->type;
+    const int size  = ff_sws_pixel_type_size(type);
+    const int bytes = COMP_BYTES(type);
+    if (!ff_sws_pixel_type_is_int(type))
+        return AVERROR(ENOTSUP);
+
+    for (int c = 0; c < 4; c++) {
+        if (!SWS_COMP_TEST(uop->mask, c))
+            continue;
+
+        const int src = get_comp(s, c);
+        const int dst = alloc_reg(s);
+
+        switch (uop->uop) {
+        case SWS_UOP_SWAP_BYTES: {
+            uint8_t mask[32];
+            if (size == 1)
+                return AVERROR(ENOTSUP);
+            for (int i = 0; i < 32; i++)
+                mask[i] = (i & ~(size - 1)) + (size - 1) - (i & (size - 1));
+            vop(s, VPSHUFB, bytes, dst, src, add_data(s, mask, sizeof(mask)));
+            break;
+        }
+        case SWS_UOP_EXPAND_BIT: {
+            const int insn = size == 1 ? VPCMPEQB : size == 2 ? VPCMPEQW : VPCMPEQD;
+            vop(s, insn, bytes, dst, src, splat(s, type, 0));
+            vop(s, VPXOR, bytes, dst, dst, splat(s, type, UINT32_MAX));
+            break;
+        }
+        case SWS_UOP_EXPAND_PAIR:
+        case SWS_UOP_EXPAND_QUAD: {
+            if (size != 1)
+                return AVERROR(ENOTSUP);
+            const bool pair = uop->uop == SWS_UOP_EXPAND_PAIR;
+            const int obytes = bytes * (pair ? 2 : 4);
+            vop(s, pair ? VPMOVZXBW : VPMOVZXBD, obytes, dst, 0, reg(src));
+            if (pair) {
+                const int tmp = alloc_reg(s);
+                vshift(s, VPSHIFTW, 6, obytes, tmp, dst, 8);
+                vop(s, VPOR, obytes, dst, dst, reg(tmp));
+                unref_reg(s, tmp);
+            } else {
+                vop(s, VPMULLD, obytes, dst, dst, splat(s, SWS_PIXEL_U32, 0x01010101));
+            }
+            break;
+        }
+        case SWS_UOP_LSHIFT:
+        case SWS_UOP_RSHIFT: {
+            const int amount = uop->par.shift.amount;
+            const bool left  = uop->uop == SWS_UOP_LSHIFT;
+            const int ext    = left ? 6 : 2;
+            if (amount >= 8 * size) {
+                vzero(s, dst);
+            } else if (size == 4) {
+                vshift(s, VPSHIFTD, ext, bytes, dst, src, amount);
+            } else {
+                vshift(s, VPSHIFTW, ext, bytes, dst, src, amount);
+                if (size == 1) {
+                    /* No byte shifts; mask off bits crossing into neighbours */
+                    const uint8_t mask = left ? 0xFF << amount : 0xFF >> amount;
+                    vop(s, VPAND, bytes, dst, dst, splat(s, type, mask));
+                }
+            }
+            break;
+        }
+        }
+
+        set_comp(s, c, dst);
+    }
+
+    if (uop->uop == SWS_UOP_EXPAND_PAIR || uop->uop == SWS_UOP_EXPAND_QUAD) {
+        for (int c = 0; c < 4; c++) {
+            if (!SWS_COMP_TEST(uop->mask, c))
+                set_comp(s, c, -1);
+        }
+    }
+
+    return 0;
+}
+
+static void emit_shift(JitContext *s, SwsPixelType type, int dst, int src,
+                       int amount, bool left)
+{
+    const int size  = ff_sws_pixel_type_size(type);
+    const int bytes = COMP_BYTES(type);
+    vshift(s, size == 4 ? VPSHIFTD : VPSHIFTW, left ? 6 : 2, bytes, dst, src, amount);
+}
+
+static int emit_pack(JitContext *s, const SwsUOp *uop)
+{
+    const SwsPixelType type = uop->type;
+    const int size  = ff_sws_pixel_type_size(type);
+    const int bytes = COMP_BYTES(type);
+    const uint8_t *pat = uop->par.pack.pattern;
+    const int shift[4] = { pat[1] + pat[2] + pat[3], pat[2] + pat[3], pat[3], 0 };
+    if (!ff_sws_pixel_type_is_int(type))
+        return AVERROR(ENOTSUP);
+
+    if (uop->uop == SWS_UOP_UNPACK) {
+        const int src = get_comp(s, 0);
+        s->refs[src]++;
+        for (int c = 0; c < 4; c++) {
+            if (!SWS_COMP_TEST(uop->mask, c))
+                continue;
+            const uint32_t mask = pat[c] >= 32 ? UINT32_MAX : (1u << pat[c]) - 1;
+            const int dst = alloc_reg(s);
+            JitOperand in = reg(src);
+            if (shift[c]) {
+                emit_shift(s, type, dst, src, shift[c], false);
+                in = reg(dst);
+            }
+            /* Byte shifts are done on words, so always mask those */
+            if (shift[c] + pat[c] < 8 * size || (size == 1 && shift[c]))
+                vop(s, VPAND, bytes, dst, in.reg, splat(s, type, mask));
+            else if (!shift[c])
+                vop(s, VMOVDQA, bytes, dst, 0, in);
+            set_comp(s, c, dst);
+        }
+        unref_reg(s, src);
+        return 0;
+    }
+
+    const int dst = alloc_reg(s), tmp = alloc_reg(s);
+    bool first = true;
+    for (int c = 0; c < 4; c++) {
+        if (!SWS_COMP_TEST(uop->mask, c))
+            continue;
+        const int src = get_comp(s, c);
+        const int out = first ? dst : tmp;
+        if (shift[c]) {
+            emit_shift(s, type, out, src, shift[c], true);
+            if (size == 1)
+                vop(s, VPAND, bytes, out, out, splat(s, type, 0xFF << shift[c]));
+        } else {
+            vop(s, VMOVDQA, bytes, out, 0, reg(src));
+        }
+        if (!first)
+            vop(s, VPOR, bytes, dst, dst, reg(tmp));
+        first = false;
+    }
+    if (first)
+        vzero(s, dst);
+    unref_reg(s, tmp);
+    set_comp(s, 0, dst);
+    return 0;
+}
+
+static uint32_t pixel_max(SwsPixelType type)
+{
+    return UINT32_MAX >> (32 - 8 * ff_sws_pixel_type_size(type));
+}
+
+static int emit_clear(JitContext *s, const SwsUOp *uop)
+{
+    const SwsPixelType type = uop->type;
+    if (!ff_sws_pixel_type_is_int(type))
+        return AVERROR(ENOTSUP);
+
+    for (int c = 0; c < 4; c++) {
+        if (!SWS_COMP_TEST(uop->mask, c))
+            continue;
+
+        const SwsPixel px = uop->data.vec4[c];
+        uint32_t value = type == SWS_PIXEL_U8  ? px.u8  :
+                         type == SWS_PIXEL_U16 ? px.u16 : px.u32;
+        if (SWS_COMP_TEST(uop->par.clear.one, c))
+            value = pixel_max(type);
+        else if (SWS_COMP_TEST(uop->par.clear.zero, c))
+            value = 0;
+
+        const int dst = alloc_reg(s);
+        vload(s, COMP_BYTES(type), dst, splat(s, type, value));
+        set_comp(s, c, dst);
+    }
+
+    return 0;
+}
+
+static uint32_t pixel_bits(SwsPixelType type, SwsPixel px)
+{
+    switch (type) {
+    case SWS_PIXEL_U8:  return px.u8;
+    case SWS_PIXEL_U16: return px.u16;
+    default:            return px.u32;
+    }
+}
+
+static int emit_arith(JitContext *s, const SwsUOp *uop)
+{
+    const SwsPixelType type = uop->type;
+    const int size  = ff_sws_pixel_type_size(type);
+    const int bytes = COMP_BYTES(type);
+    const bool is_float = type == SWS_PIXEL_F32;
+
+    for (int c = 0; c < 4; c++) {
+        if (!SWS_COMP_TEST(uop->mask, c))
+            continue;
+
+        const SwsPixel px = uop->uop == SWS_UOP_SCALE ? uop->data.scalar
+                                                      : uop->data.vec4[c];
+        const JitOperand k = splat(s, type, pixel_bits(type, px));
+        const int src = get_comp(s, c);
+        const int dst = alloc_reg(s);
+
+        switch (uop->uop) {
+        case SWS_UOP_SCALE:
+            if (is_float) {
+                vop(s, VMULPS, bytes, dst, src, k);
+            } else if (size == 4) {
+                vop(s, VPMULLD, bytes, dst, src, k);
+            } else if (size == 2) {
+                vop(s, VPMULLW, bytes, dst, src, k);
+            } else {
+                /* No byte multiply; do even and odd bytes separately */
+                const JitOperand kw = splat(s, SWS_PIXEL_U16, px.u8);
+                const int tmp = alloc_reg(s);
+                vop(s, VPMULLW, bytes, dst, src, kw);
+                vop(s, VPAND, bytes, dst, dst, splat(s, SWS_PIXEL_U16, 0xFF));
+                vshift(s, VPSHIFTW, 2, bytes, tmp, src, 8);
+                vop(s, VPMULLW, bytes, tmp, tmp, kw);
+                vshift(s, VPSHIFTW, 6, bytes, tmp, tmp, 8);
+                vop(s, VPOR, bytes, dst, dst, reg(tmp));
+                unref_reg(s, tmp);
+            }
+            break;
+        case SWS_UOP_ADD:
+            vop(s, is_float  ? VADDPS :
+                   size == 1 ? VPADDB :
+                   size == 2 ? VPADDW : VPADDD, bytes, dst, src, k);
+            break;
+        case SWS_UOP_MIN:
+            if (is_float) {
+                /* Operand order matters for FFMIN() semantics with NaN */
+                vload(s, bytes, dst, k);
+                vop(s, VMINPS, bytes, dst, dst, reg(src));
+            } else {
+                vop(s, size == 1 ? VPMINUB :
+                       size == 2 ? VPMINUW : VPMINUD, bytes, dst, src, k);
+            }
+            break;
+        case SWS_UOP_MAX:
+            vop(s, is_float  ? VMAXPS  :
+                   size == 1 ? VPMAXUB :
+                   size == 2 ? VPMAXUW : VPMAXUD, bytes, dst, src, k);
+            break;
+        }
+
+        set_comp(s, c, dst);
+    }
+
+    return 0;
+}
+
+static int emit_linear(JitContext *s, const SwsUOp *uop)
+{
+    const SwsLinearUOp *lin = &uop->par.lin;
+    const bool fma = uop->uop == SWS_UOP_LINEAR_FMA;
+    const int bytes = COMP_BYTES(uop->type);
+    int rows[4] = { -1, -1, -1, -1 };
+
+    if (uop->type != SWS_PIXEL_F32)
+        return AVERROR(ENOTSUP);
+    if (fma && !s->fma)
+        return AVERROR(ENOTSUP);
+
+    /* Accumulate in the same order as the C reference */
+    const int tmp = alloc_reg(s);
+    for (int i = 0; i < 4; i++) {
+        if (!SWS_COMP_TEST(uop->mask, i))
+            continue;
+
+        const int acc = rows[i] = alloc_reg(s);
+        if (lin->zero & SWS_MASK(i, 4))
+            vzero(s, acc);
+        else
+            vload(s, bytes, acc, splat(s, SWS_PIXEL_F32, uop->data.mat4[i][4].u32));
+
+        for (int j = 0; j < 4; j++) {
+            if (lin->zero & SWS_MASK(i, j))
+                continue;
+            const int src = get_comp(s, j);
+            const JitOperand k = splat(s, SWS_PIXEL_F32, uop->data.mat4[i][j].u32);
+            if (lin->one & SWS_MASK(i, j)) {
+                vop(s, VADDPS, bytes, acc, acc, reg(src));
+            } else if (fma && (lin->exact & SWS_MASK(i, j))) {
+                vop(s, VFMADD231PS, bytes, acc, src, k);
+            } else {
+                vop(s, VMULPS, bytes, tmp, src, k);
+                vop(s, VADDPS, bytes, acc, acc, reg(tmp));
+            }
+        }
+    }
+    unref_reg(s, tmp);
+
+    for (int i = 0; i < 4; i++) {
+        if (rows[i] >= 0)
+            set_comp(s, i, rows[i]);
+    }
+
+    return 0;
+}
+
+static int emit_dither(JitContext *s, const SwsUOp *uop)
+{
+    const SwsDitherUOp *dither = &uop->par.dither;
+    const int size   = 1 << dither->size_log2;
+    const int stride = FFMAX(size, s->block_size);
+    const int height = ff_sws_dither_height(dither);
+    const int bytes  = COMP_BYTES(uop->type);
+
+    if (uop->type != SWS_PIXEL_F32)
+        return AVERROR(ENOTSUP);
+
+    /* Pad each row to a multiple of the block size */
+    float *matrix = av_malloc_array(height, stride * sizeof(*matrix));
+    if (!matrix)
+        return AVERROR(ENOMEM);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < stride; x++)
+            matrix[y * stride + x] = uop->data.ptr[y * size + (x & (size - 1))].f32;
+    }
+    const JitOperand data = add_data(s, matrix, height * stride * sizeof(*matrix));
+    av_free(matrix);
+
+    /* rax = row offset, rcx = matrix base */
+    mov_mr(s, reg(RAX), REG_Y);
+    alu_ri(s, ALU_AND, RAX, size - 1);
+    shl_ri(s, RAX, av_log2(stride * sizeof(float)));
+    if (size > s->block_size) {
+        mov_mr(s, reg(RCX), REG_X);
+        alu_ri(s, ALU_AND, RCX, size - 1);
+        lea(s, RAX, mem_idx(RAX, RCX, 2, 0));
+    }
+    lea(s, RCX, data);
+
+    for (int c = 0; c < 4; c++) {
+        if (!SWS_COMP_TEST(uop->mask, c))
+            continue;
+        const int32_t off = dither->y_offset[c] * stride * sizeof(float);
+        const int src = get_comp(s, c);
+        const int dst = alloc_reg(s);
+        vop(s, VADDPS, bytes, dst, src, mem_idx(RCX, RAX, 0, off));
+        set_comp(s, c, dst);
+    }
+
+    return 0;
+}
+
+static int emit_uop(JitContext *s, const SwsUOp *uop)
+{
+    switch (uop->uop) {
+    case SWS_UOP_READ_PLANAR:
+    case SWS_UOP_READ_PACKED:   return emit_read(s, uop);
+    case SWS_UOP_WRITE_PLANAR:
+    case SWS_UOP_WRITE_PACKED:  return emit_write(s, uop);
+    case SWS_UOP_PERMUTE:
+    case SWS_UOP_COPY:          return emit_move(s, uop);
+    case SWS_UOP_TO_U8:
+    case SWS_UOP_TO_U16:
+    case SWS_UOP_TO_U32:
+    case SWS_UOP_TO_F32:        return emit_cast(s, uop);
+    case SWS_UOP_SWAP_BYTES:
+    case SWS_UOP_EXPAND_BIT:
+    case SWS_UOP_EXPAND_PAIR:
+    case SWS_UOP_EXPAND_QUAD:
+    case SWS_UOP_LSHIFT:
+    case SWS_UOP_RSHIFT:        return emit_bits(s, uop);
+    case SWS_UOP_UNPACK:
+    case SWS_UOP_PACK:          return emit_pack(s, uop);
+    case SWS_UOP_CLEAR:         return emit_clear(s, uop);
+    case SWS_UOP_SCALE:
+    case SWS_UOP_ADD:
+    case SWS_UOP_MIN:
+    case SWS_UOP_MAX:           return emit_arith(s, uop);
+    case SWS_UOP_LINEAR:
+    case SWS_UOP_LINEAR_FMA:    return emit_linear(s, uop);
+    case SWS_UOP_DITHER:        return emit_dither(s, uop);
+    default:                    return AVERROR(ENOTSUP);
+    }
+}
+
+/**************************
+ * Function body and loop *
+ **************************/
+
+#define EXEC_OFF(field) ((int32_t) offsetof(SwsOpExec, field))
+
+static const int8_t saved_regs[] = { RBX, RBP, R12, R13, R14, R15 };
+
+static int emit_function(JitContext *s, const SwsUOpList *uops)
+{
+    SwsCompMask planes_in = 0, planes_out = 0;
+    bool need_x = false;
+    int ret;
+
+    for (int i = 0; i < uops->num_ops; i++) {
+        const SwsUOp *uop = &uops->ops[i];
+        switch (uop->uop) {
+        case SWS_UOP_READ_PLANAR:   planes_in  |= uop->mask; break;
+        case SWS_UOP_READ_PACKED:   planes_in  |= SWS_COMP(0); break;
+        case SWS_UOP_WRITE_PLANAR:  planes_out |= uop->mask; break;
+        case SWS_UOP_WRITE_PACKED:  planes_out |= SWS_COMP(0); break;
+        case SWS_UOP_DITHER:        need_x = true; break;
+        }
+    }
+
+    /**
+     * SysV arguments: rdi = exec, rsi = priv, edx = bx_start, ecx = y_start,
+     * r8d = bx_end, r9d = y_end
+     */
+    for (int i = 0; i < FF_ARRAY_ELEMS(saved_regs); i++)
+        push(s, saved_regs[i]);
+    alu_ri(s, ALU_SUB, RSP, STACK_SIZE);
+
+    movsxd(s, RAX, reg(R9));
+    mov_mr(s, mem(RSP, STACK_Y_END), RAX);
+    movsxd(s, RAX, reg(R8));
+    movsxd(s, RDX, reg(RDX));
+    sub_rm(s, RAX, reg(RDX));
+    const int skip_blocks = jcc_fwd(s, CC_LE);
+    mov_mr(s, mem(RSP, STACK_BLOCKS), RAX);
+    shl_ri(s, RDX, av_log2(s->block_size));
+    mov_mr(s, mem(RSP, STACK_X_START), RDX);
+    movsxd(s, REG_Y, reg(RCX));
+    cmp_rm(s, REG_Y, mem(RSP, STACK_Y_END));
+    const int skip_lines = jcc_fwd(s, CC_GE);
+
+    for (int i = 0; i < 4; i++) {
+        if (SWS_COMP_TEST(planes_in, i))
+            mov_rm(s, in_regs[i], mem(REG_EXEC, EXEC_OFF(in[i])));
+        if (SWS_COMP_TEST(planes_out, i))
+            mov_rm(s, out_regs[i], mem(REG_EXEC, EXEC_OFF(out[i])));
+    }
+
+    /* Line loop */
+    const int loop_y = s->code_size;
+    mov_rm(s, REG_BLOCKS, mem(RSP, STACK_BLOCKS));
+    if (need_x)
+        mov_rm(s, REG_X, mem(RSP, STACK_X_START));
+
+    /* Block loop */
+    const int loop_x = s->code_size;
+    for (int i = 0; i < uops->num_ops; i++) {
+        if ((ret = emit_uop(s, &uops->ops[i])) < 0)
+            return ret;
+        if (s->error < 0)
+            return s->error;
+    }
+    if (need_x)
+        alu_ri(s, ALU_ADD, REG_X, s->block_size);
+    alu_ri(s, ALU_SUB, REG_BLOCKS, 1);
+    jcc_back(s, CC_NZ, loop_x);
+
+    /* Advance to the next line */
+    if (planes_in) {
+        for (int i = 0; i < 4; i++) {
+            if (SWS_COMP_TEST(planes_in, i))
+                add_rm(s, in_regs[i], mem(REG_EXEC, EXEC_OFF(in_bump[i])));
+        }
+
+        mov_rm(s, RCX, mem(REG_EXEC, EXEC_OFF(in_bump_y)));
+        test_rr(s, RCX, RCX);
+        const int skip_bump = jcc_fwd(s, CC_Z);
+        movsxd(s, RCX, mem_idx(RCX, REG_Y, 2, 0));
+        for (int i = 0; i < 4; i++) {
+            if (!SWS_COMP_TEST(planes_in, i))
+                continue;
+            mov_mr(s, reg(RAX), RCX);
+            imul_rm(s, RAX, mem(REG_EXEC, EXEC_OFF(in_stride[i])));
+            add_rm(s, in_regs[i], reg(RAX));
+        }
+        patch_jump(s, skip_bump);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        if (SWS_COMP_TEST(planes_out, i))
+            add_rm(s, out_regs[i], mem(REG_EXEC, EXEC_OFF(out_bump[i])));
+    }
+
+    alu_ri(s, ALU_ADD, REG_Y, 1);
+    cmp_rm(s, REG_Y, mem(RSP, STACK_Y_END));
+    jcc_back(s, CC_L, loop_y);
+
+    patch_jump(s, skip_blocks);
+    patch_jump(s, skip_lines);
+    emit_bytes(s, (const uint8_t[]) { 0xC5, 0xF8, 0x77 }, 3); /* vzeroupper */
+    alu_ri(s, ALU_ADD, RSP, STACK_SIZE);
+    for (int i = FF_ARRAY_ELEMS(saved_regs) - 1; i >= 0; i--)
+        pop(s, saved_regs[i]);
+    emit_u8(s, 0xC3); /* ret */
+
+    return s->error;
+}
+
+static void free_func(void *priv)
+{
+    JitFunc *func = priv;
+    ff_sws_jit_free(func->mem, func->size);
+    av_free(func);
+}
+
+/* Copy code and data into executable memory, resolving data references */
+static int finalize(JitContext *s, SwsCompiledOp *out)
+{
+    const int data_off = FFALIGN(s->code_size, 64);
+    JitFunc *func = av_mallocz(sizeof(*func));
+    if (!func)
+        return AVERROR(ENOMEM);
+
+    func->size = data_off + s->data_size;
+    func->mem  = ff_sws_jit_alloc(func->size);
+    if (!func->mem) {
+        av_free(func);
+        return AVERROR(ENOMEM);
+    }
+
+    memcpy(func->mem, s->code, s->code_size);
+    memset(func->mem + s->code_size, 0xCC, data_off - s->code_size); /* int3 */
+    if (s->data_size)
+        memcpy(func->mem + data_off, s->data, s->data_size);
+    for (int i = 0; i < s->nb_fixups; i++) {
+        const JitFixup *f = &s->fixups[i];
+        AV_WL32(func->mem + f->pos, data_off + f->data - f->end);
+    }
+
+    int ret = ff_sws_jit_protect(func->mem, func->size);
+    if (ret < 0) {
+        free_func(func);
+        return ret;
+    }
+
+    *out = (SwsCompiledOp) {
+        .func        = (SwsOpFunc) func->mem,
+        .block_size  = s->block_size,
+        .slice_align = 1,
+        .cpu_flags   = AV_CPU_FLAG_AVX2 | (s->fma ? AV_CPU_FLAG_FMA3 : 0),
+        .priv        = func,
+        .free        = free_func,
+    };
+
+    return 0;
+}
+
+static int compile_uops_jit(SwsContext *ctx, const SwsUOpList *uops,
+                            SwsCompiledOp *out)
+{
+#if !(HAVE_MMAP && HAVE_MPROTECT) && !HAVE_VIRTUALALLOC || defined(_WIN64)
+    /* No executable memory, or non-SysV calling convention */
+    return AVERROR(ENOTSUP);
+#endif
+    const int cpu_flags = av_get_cpu_flags();
+    if (!X86_AVX2(cpu_flags))
+        return AVERROR(ENOTSUP);
+
+    int pixel_size = FFMAX(uops->pixel_size_max, 1);
+    for (int i = 0; i < uops->num_ops; i++)
+        pixel_size = FFMAX(pixel_size, ff_sws_pixel_type_size(uops->ops[i].type));
+
+    JitContext s = {
+        .ctx        = ctx,
+        .block_size = 32 / pixel_size,
+        .fma        = X86_FMA3(cpu_flags),
+        .comp       = { -1, -1, -1, -1 },
+        .tmp        = -1,
+    };
+
+    int ret = emit_function(&s, uops);
+    if (ret >= 0)
+        ret = finalize(&s, out);
+
+    if (ret >= 0) {
+        av_log(ctx, AV_LOG_DEBUG, "Compiled %d micro-ops into %d bytes of code "
+               "and %d bytes of data:\n", uops->num_ops, s.code_size, s.data_size);
+        for (int i = 0; i < uops->num_ops; i++) {
+            char name[SWS_UOP_NAME_MAX];
+            ff_sws_uop_name(&uops->ops[i], name);
+            av_log(ctx, AV_LOG_DEBUG, "    %s\n", name);
+        }
+    }
+
+    av_free(s.code);
+    av_free(s.data);
+    av_free(s.consts);
+    av_free(s.fixups);
+    return ret;
+}
+
+static int compile_jit(SwsContext *ctx, const SwsOpList *ops, SwsCompiledOp *out)
+{
+    const int cpu_flags = av_get_cpu_flags();
+    if (!X86_AVX2(cpu_flags))
+        return AVERROR(ENOTSUP);
+
+    SwsUOpFlags flags = SWS_UOP_FLAG_NONE;
+    if (X86_FMA3(cpu_flags))
+        flags |= SWS_UOP_FLAG_FMA;
+
+    SwsUOpList *uops = ff_sws_uop_list_alloc();
+    if (!uops)
+        return AVERROR(ENOMEM);
+
+    int ret = ff_sws_ops_translate(ctx, ops, flags, uops);
+    if (ret < 0)
+        goto fail;
+
+    ret = compile_uops_jit(ctx, uops, out);
+
+fail:
+    ff_sws_uop_list_free(&uops);
+    return ret;
+}
+
+const SwsOpBackend backend_x86_jit = {
+    .name           = "x86_jit",
+    .flags          = SWS_BACKEND_X86,
+    .compile        = compile_jit,
+    .compile_uops   = compile_uops_jit,
+    .hw_format      = AV_PIX_FMT_NONE,
+};
@@ -0,0 +1,315 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * avcodec_decode_batch() test.
+ * Encodes MPEG-4 video with B-frames, decodes it once with
+ * avcodec_send_packet()/avcodec_receive_frame(), then in batches with discard
+ * hints and a small frames array, and checks that the batches return exactly
+ * the wanted frames, unchanged.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavcodec/avcodec.h"
+#include "libavutil/adler32.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/log.h"
+
+#define NB_FRAMES 40
+#define WIDTH     64
+#define HEIGHT    64
+#define KEEP_EVERY 3 // keep the frames whose pts is a multiple of this
+#define BATCH_FRAMES 2
+
+static uint32_t frame_checksum(const AVFrame *frame)
+{
+    uint32_t checksum = 0;
+
+    for (int p = 0; p < 3; p++) {
+        int w = p ? WIDTH  / 2 : WIDTH;
+        int h = p ? HEIGHT / 2 : HEIGHT;
+
+        for (int y = 0; y < h; y++)
+            checksum = av_adler32_update(checksum, frame->data[p] + y * frame->linesize[p], w);
+    }
+    return checksum;
+}
+
+static int encode_frames(AVPacket **pkts, int *nb_pkts)
+{
+    const AVCodec *enc = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    AVCodecContext *ctx = NULL;
+    AVFrame *frame = NULL;
+    AVPacket *pkt = NULL;
+    int ret;
+
+    *nb_pkts = 0;
+    if (!enc) {
+        av_log(NULL, AV_LOG_ERROR, "Can't find encoder\n");
+        return AVERROR_ENCODER_NOT_FOUND;
+    }
+
+    ctx   = avcodec_alloc_context3(enc);
+    frame = av_frame_alloc();
+    pkt   = av_packet_alloc();
+    if (!ctx || !frame || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ctx->width        = WIDTH;
+    ctx->height       = HEIGHT;
+    ctx->pix_fmt      = AV_PIX_FMT_YUV420P;
+    ctx->time_base    = (AVRational){ 1, 25 };
+    ctx->gop_size     = 12;
+    ctx->max_b_frames = 2;
+    ctx->flags       |= AV_CODEC_FLAG_BITEXACT;
+
+    ret = avcodec_open2(ctx, enc, NULL);
+    if (ret < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Can't open encoder\n");
+        goto end;
+    }
+
+    for (int i = 0; i <= NB_FRAMES; i++) {
+        if (i < NB_FRAMES) {
+            frame->format = ctx->pix_fmt;
+            frame->width  = ctx->width;
+            frame->height = ctx->height;
+            ret = av_frame_get_buffer(frame, 0);
+            if (ret < 0)
+                goto end;
+            for (int y = 0; y < HEIGHT; y++)
+                for (int x = 0; x < WIDTH; x++)
+                    frame->data[0][y * frame->linesize[0] + x] = x + 2 * y + 3 * i;
+            for (int y = 0; y < HEIGHT / 2; y++)
+                for (int x = 0; x < WIDTH / 2; x++) {
+                    frame->data[1][y * frame->linesize[1] + x] = 128 + x - i;
+                    frame->data[2][y * frame->linesize[2] + x] = 128 + y + i;
+                }
+            frame->pts = i;
+        }
+
+        ret = avcodec_send_frame(ctx, i < NB_FRAMES ? frame : NULL);
+        av_frame_unref(frame);
+        if (ret < 0)
+            goto end;
+
+        while ((ret = avcodec_receive_packet(ctx, pkt)) >= 0) {
+            if (*nb_pkts == NB_FRAMES) {
+                ret = AVERROR_BUG;
+                goto end;
+            }
+            pkts[*nb_pkts] = av_packet_alloc();
+            if (!pkts[*nb_pkts]) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            av_packet_move_ref(pkts[(*nb_pkts)++], pkt);
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            goto end;
+    }
+    ret = 0;
+
+end:
+    avcodec_free_context(&ctx);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    return ret;
+}
+
+static int open_decoder(AVCodecContext **ctx, int threads)
+{
+    const AVCodec *dec = avcodec_find_decoder(AV_CODEC_ID_MPEG4);
+    int ret;
+
+    if (!dec) {
+        av_log(NULL, AV_LOG_ERROR, "Can't find decoder\n");
+        return AVERROR_DECODER_NOT_FOUND;
+    }
+    *ctx = avcodec_alloc_context3(dec);
+    if (!*ctx)
+        return AVERROR(ENOMEM);
+    (*ctx)->thread_count = threads;
+    (*ctx)->flags       |= AV_CODEC_FLAG_BITEXACT;
+
+    ret = avcodec_open2(*ctx, dec, NULL);
+    if (ret < 0)
+        av_log(*ctx, AV_LOG_ERROR, "Can't open decoder\n");
+    return ret;
+}
+
+/* decode every packet, sums[pts] receives the checksum of each frame */
+static int decode_reference(AVPacket **pkts, int nb_pkts, int threads,
+                            uint32_t *sums)
+{
+    AVCodecContext *ctx = NULL;
+    AVFrame *frame = av_frame_alloc();
+    int nb_frames = 0, ret;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    ret = open_decoder(&ctx, threads);
+    if (ret < 0)
+        goto end;
+
+    for (int i = 0; i <= nb_pkts; i++) {
+        ret = avcodec_send_packet(ctx, i < nb_pkts ? pkts[i] : NULL);
+        if (ret < 0)
+            goto end;
+        while ((ret = avcodec_receive_frame(ctx, frame)) >= 0) {
+            if (frame->pts < 0 || frame->pts >= NB_FRAMES) {
+                ret = AVERROR_BUG;
+                goto end;
+            }
+            sums[frame->pts] = frame_checksum(frame);
+            nb_frames++;
+            av_frame_unref(frame);
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            goto end;
+    }
+    ret = 0;
+    if (nb_frames != NB_FRAMES) {
+        av_log(NULL, AV_LOG_ERROR, "Reference decode returned %d frames\n", nb_frames);
+        ret = AVERROR_BUG;
+    }
+
+end:
+    avcodec_free_context(&ctx);
+    av_frame_free(&frame);
+    return ret;
+}
+
+static int decode_batches(AVPacket **pkts, int nb_pkts, int threads,
+                          const uint32_t *sums)
+{
+    AVPacket *batch_pkts[NB_FRAMES + 1];
+    unsigned hints[NB_FRAMES + 1] = { 0 };
+    AVFrame *frames[BATCH_FRAMES] = { NULL };
+    AVCodecContext *ctx = NULL;
+    int consumed = 0, next_pts = 0, full = 0, ret;
+
+    for (int i = 0; i < nb_pkts; i++) {
+        batch_pkts[i] = pkts[i];
+        if (pkts[i]->pts % KEEP_EVERY)
+            hints[i] = AV_CODEC_BATCH_HINT_DISCARD;
+    }
+    batch_pkts[nb_pkts] = NULL; // flush packet
+
+    for (int i = 0; i < BATCH_FRAMES; i++) {
+        frames[i] = av_frame_alloc();
+        if (!frames[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+
+    ret = open_decoder(&ctx, threads);
+    if (ret < 0)
+        goto end;
+    ctx->skip_frame = AVDISCARD_DEFAULT;
+
+    do {
+        int nb = nb_pkts + 1 - consumed, nb_frames = BATCH_FRAMES;
+
+        ret = avcodec_decode_batch(ctx, batch_pkts + consumed, hints + consumed,
+                                   &nb, frames, &nb_frames);
+        if (ret < 0 && ret != AVERROR_EOF) {
+            av_log(ctx, AV_LOG_ERROR, "Batch decoding failed: %s\n", av_err2str(ret));
+            goto end;
+        }
+        if (ctx->skip_frame != AVDISCARD_DEFAULT) {
+            av_log(ctx, AV_LOG_ERROR, "skip_frame was not restored\n");
+            ret = AVERROR_BUG;
+            goto end;
+        }
+        if (ret == 0 && !nb && !nb_frames) {
+            av_log(ctx, AV_LOG_ERROR, "No progress with %d packets left\n",
+                   nb_pkts + 1 - consumed);
+            ret = AVERROR_BUG;
+            goto end;
+        }
+        consumed += nb;
+        full     += nb_frames == BATCH_FRAMES;
+
+        for (int i = 0; i < nb_frames; i++) {
+            const AVFrame *frame = frames[i];
+
+            if (frame->pts != next_pts) {
+                av_log(ctx, AV_LOG_ERROR, "Got pts %"PRId64", expected %d\n",
+                       frame->pts, next_pts);
+                ret = AVERROR_BUG;
+                goto end;
+            }
+            if (frame_checksum(frame) != sums[frame->pts]) {
+                av_log(ctx, AV_LOG_ERROR, "Frame %"PRId64" differs from the reference\n",
+                       frame->pts);
+                ret = AVERROR_BUG;
+                goto end;
+            }
+            next_pts += KEEP_EVERY;
+        }
+    } while (ret != AVERROR_EOF);
+
+    ret = 0;
+    if (consumed != nb_pkts + 1 || next_pts < NB_FRAMES) {
+        av_log(ctx, AV_LOG_ERROR, "Got %d of the frames, %d of %d packets consumed\n",
+               next_pts / KEEP_EVERY, consumed, nb_pkts + 1);
+        ret = AVERROR_BUG;
+    } else if (!full) {
+        av_log(ctx, AV_LOG_ERROR, "The frames array was never full\n");
+        ret = AVERROR_BUG;
+    }
+
+end:
+    for (int i = 0; i < BATCH_FRAMES; i++)
+        av_frame_free(&frames[i]);
+    avcodec_free_context(&ctx);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVPacket *pkts[NB_FRAMES] = { NULL };
+    uint32_t sums[NB_FRAMES];
+    int nb_pkts, ret;
+    int threads = argc > 1 ? atoi(argv[1]) : 1;
+
+    ret = encode_frames(pkts, &nb_pkts);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Encoding failed: %s\n", av_err2str(ret));
+        goto end;
+    }
+
+    ret = decode_reference(pkts, nb_pkts, threads, sums);
+    if (ret < 0)
+        goto end;
+
+    ret = decode_batches(pkts, nb_pkts, threads, sums);
+
+end:
+    for (int i = 0; i < NB_FRAMES; i++)
+        av_packet_free(&pkts[i]);
+    return ret < 0;
+}
@@ -3,6 +3,14 @@ fate-api-flac: $(APITESTSDIR)/api-flac-test$(EXESUF)
 fate-api-flac: CMD = run $(APITESTSDIR)/api-flac-test$(EXESUF)
 fate-api-flac: CMP = null
 
+FATE_API_LIBAVCODEC-$(call ALLYES, MPEG4_ENCODER MPEG4_DECODER) += fate-api-decode-batch fate-api-decode-batch-frame-threads
+fate-api-decode-batch: $(APITESTSDIR)/api-decode-batch-test$(EXESUF)
+fate-api-decode-batch: CMD = run $(APITESTSDIR)/api-decode-batch-test$(EXESUF) 1
+fate-api-decode-batch: CMP = null
+fate-api-decode-batch-frame-threads: $(APITESTSDIR)/api-decode-batch-test$(EXESUF)
+fate-api-decode-batch-frame-threads: CMD = run $(APITESTSDIR)/api-decode-batch-test$(EXESUF) 3
+fate-api-decode-batch-frame-threads: CMP = null
+
 FATE_API_LIBAVCODEC-$(call ALLYES, H261_ENCODER H261_PARSER) += fate-api-enc-parser fate-api-enc-parser-cif
 fate-api-enc-parser: $(APITESTSDIR)/api-enc-parser-test$(EXESUF)
 fate-api-enc-parser: CMD = run $(APITESTSDIR)/api-enc-parser-test$(EXESUF) h261 176 144
@@ -505,6 +505,25 @@ fate-filter-drawvg-interpreter: $(DRAWVG_SCRIPT_ALL)
 fate-filter-drawvg-interpreter: libavfilter/tests/drawvg$(EXESUF)
 fate-filter-drawvg-interpreter: CMD = run libavfilter/tests/drawvg$(EXESUF) $(DRAWVG_SCRIPT_ALL)
 
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SPLIT_FILTER HFLIP_FILTER VFLIP_FILTER \
+                           BOXBLUR_FILTER GBLUR_FILTER NEGATE_FILTER           \
+                           EDGEDETECT_FILTER) += fate-filter-threads-pipeline
+fate-filter-threads-pipeline: libavfilter/tests/graphthreads$(EXESUF)
+fate-filter-threads-pipeline: CMD = run libavfilter/tests/graphthreads$(EXESUF) "testsrc2=d=1:s=176x144,split=3[a][b][c];[a]hflip,boxblur[out0];[b]vflip,gblur[out1];[c]negate,edgedetect[out2]" pipeline 4
+
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SENDCMD_FILTER SPLIT_FILTER HUE_FILTER \
+                           HFLIP_FILTER VFLIP_FILTER) += fate-filter-threads-pipeline-sendcmd
+fate-filter-threads-pipeline-sendcmd: libavfilter/tests/graphthreads$(EXESUF)
+fate-filter-threads-pipeline-sendcmd: CMD = run libavfilter/tests/graphthreads$(EXESUF) "testsrc2=d=1:s=176x144,sendcmd=c=0.4 hue h 90,split[a][b];[a]hue,hflip[out0];[b]vflip,hue[out1]" pipeline 4
+
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER NLMEANS_FILTER) += fate-filter-threads-frame-nlmeans
+fate-filter-threads-frame-nlmeans: libavfilter/tests/graphthreads$(EXESUF)
+fate-filter-threads-frame-nlmeans: CMD = run libavfilter/tests/graphthreads$(EXESUF) "testsrc2=d=1:s=176x144,nlmeans=s=3:p=3:r=7:enable=between(n\,5\,12)" frame 4
+
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER V360_FILTER) += fate-filter-threads-frame-v360
+fate-filter-threads-frame-v360: libavfilter/tests/graphthreads$(EXESUF)
+fate-filter-threads-frame-v360: CMD = run libavfilter/tests/graphthreads$(EXESUF) "testsrc2=d=1:s=176x144,v360=e:c3x2:w=192:h=128" frame 4
+
 FATE_FILTER_SAMPLES-$(call FILTERDEMDEC, FPS SCALE, MOV, QTRLE) += fate-filter-fps-cfr fate-filter-fps
 fate-filter-fps-cfr: CMD = framecrc -auto_conversion_filters -i $(TARGET_SAMPLES)/qtrle/apple-animation-variable-fps-bug.mov -r 30 -fps_mode cfr -pix_fmt yuv420p
 fate-filter-fps:     CMD = framecrc -auto_conversion_filters -i $(TARGET_SAMPLES)/qtrle/apple-animation-variable-fps-bug.mov -vf fps=30 -pix_fmt yuv420p
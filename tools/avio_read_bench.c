@@ -0,0 +1,179 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the read throughput of input protocols, e.g. to compare the file
+ * and iouring protocols. Each URL is read sequentially from start to end the
+ * way a demuxer reads it, then read again at random positions.
+ *
+ * Usage: avio_read_bench [-o options] [-n nb_seeks] url [url ...]
+ *
+ * For example:
+ *   avio_read_bench file:input.mov iouring:input.mov
+ *   avio_read_bench -o direct=1:queue_depth=32 iouring:input.mov
+ *   avio_read_bench -o readahead=1 http://host/input.mov
+ *
+ * Note that the page cache should be dropped between runs to measure the
+ * device rather than memory.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/crc.h"
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+#include "libavutil/lfg.h"
+#include "libavutil/macros.h"
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+
+#include "libavformat/avio.h"
+
+#define CHUNK_SIZE 32768
+
+static int bench_sequential(const char *url, AVDictionary *opts)
+{
+    AVDictionary *o = NULL;
+    AVIOContext *pb = NULL;
+    const AVCRC *crc_table = av_crc_get_table(AV_CRC_32_IEEE_LE);
+    uint8_t buf[CHUNK_SIZE];
+    uint32_t crc = UINT32_MAX;
+    int64_t total = 0, start, elapsed;
+    int64_t hits, misses, stall;
+    int ret;
+
+    av_dict_copy(&o, opts, 0);
+    start = av_gettime_relative();
+    ret = avio_open2(&pb, url, AVIO_FLAG_READ, NULL, &o);
+    av_dict_free(&o);
+    if (ret < 0)
+        return ret;
+
+    while ((ret = avio_read(pb, buf, sizeof(buf))) > 0) {
+        crc = av_crc(crc_table, crc, buf, ret);
+        total += ret;
+    }
+    elapsed = av_gettime_relative() - start;
+    if (ret < 0 && ret != AVERROR_EOF) {
+        avio_closep(&pb);
+        return ret;
+    }
+
+    printf("%-40s sequential: %12"PRId64" bytes in %9.3f ms, %9.1f MB/s, crc %08"PRIx32"\n",
+           url, total, elapsed / 1000.0, total / (double)FFMAX(elapsed, 1),
+           crc ^ UINT32_MAX);
+
+    /* Statistics exported by the read-ahead (async) protocol, if in use */
+    if (av_opt_get_int(pb, "stall_time", AV_OPT_SEARCH_CHILDREN, &stall) >= 0 &&
+        av_opt_get_int(pb, "read_hits", AV_OPT_SEARCH_CHILDREN, &hits) >= 0 &&
+        av_opt_get_int(pb, "read_misses", AV_OPT_SEARCH_CHILDREN, &misses) >= 0) {
+        printf("%-40s read-ahead: %12"PRId64" reads, %5.1f%% hits, stalled %9.3f ms\n",
+               url, hits + misses, 100.0 * hits / FFMAX(hits + misses, 1),
+               stall / 1000.0);
+    }
+
+    avio_closep(&pb);
+    return 0;
+}
+
+static int bench_random(const char *url, AVDictionary *opts, int nb_seeks)
+{
+    AVDictionary *o = NULL;
+    AVIOContext *pb = NULL;
+    AVLFG lfg;
+    uint8_t buf[CHUNK_SIZE];
+    int64_t size, start, elapsed;
+    int ret = 0;
+
+    av_dict_copy(&o, opts, 0);
+    ret = avio_open2(&pb, url, AVIO_FLAG_READ, NULL, &o);
+    av_dict_free(&o);
+    if (ret < 0)
+        return ret;
+
+    size = avio_size(pb);
+    if (size <= 0) {
+        avio_closep(&pb);
+        return size < 0 ? size : AVERROR_INVALIDDATA;
+    }
+
+    av_lfg_init(&lfg, 0x12345678);
+    start = av_gettime_relative();
+    for (int i = 0; i < nb_seeks; i++) {
+        uint64_t r = (uint64_t)av_lfg_get(&lfg) << 32 | av_lfg_get(&lfg);
+        int64_t pos = avio_seek(pb, r % size, SEEK_SET);
+        if (pos < 0) {
+            ret = pos;
+            break;
+        }
+        ret = avio_read(pb, buf, sizeof(buf));
+        if (ret < 0)
+            break;
+    }
+    elapsed = av_gettime_relative() - start;
+    avio_closep(&pb);
+    if (ret < 0 && ret != AVERROR_EOF)
+        return ret;
+
+    printf("%-40s random:     %12d seeks in %9.3f ms, %9.1f seeks/s\n",
+           url, nb_seeks, elapsed / 1000.0,
+           nb_seeks * 1000000.0 / FFMAX(elapsed, 1));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    AVDictionary *opts = NULL;
+    int nb_seeks = 1000;
+    int i, ret = 0;
+
+    for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+        if (!strcmp(argv[i], "-o")) {
+            ret = av_dict_parse_string(&opts, argv[i + 1], "=", ":", 0);
+            if (ret < 0)
+                goto end;
+        } else if (!strcmp(argv[i], "-n")) {
+            nb_seeks = strtol(argv[i + 1], NULL, 0);
+        } else {
+            break;
+        }
+    }
+
+    if (i >= argc || nb_seeks < 0) {
+        fprintf(stderr, "Usage: %s [-o options] [-n nb_seeks] url [url ...]\n", argv[0]);
+        av_dict_free(&opts);
+        return 1;
+    }
+
+    for (; i < argc; i++) {
+        ret = bench_sequential(argv[i], opts);
+        if (ret >= 0 && nb_seeks)
+            ret = bench_random(argv[i], opts, nb_seeks);
+        if (ret < 0) {
+            fprintf(stderr, "%s: %s\n", argv[i], av_err2str(ret));
+            break;
+        }
+    }
+
+end:
+    av_dict_free(&opts);
+    return ret < 0;
+}
@@ -0,0 +1,238 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure how video encoding scales with the number of threads, e.g. for
+ * FFV1 archival encodes of large frames. The same synthetic frames are
+ * encoded once for each thread count; the CRC of the output allows checking
+ * that threading does not change it.
+ *
+ * Usage: enc_thread_bench [-c codec] [-s WxH] [-p pix_fmt] [-n nb_frames]
+ *                         [-t thread_type] [-o options] threads [threads ...]
+ *
+ * For example:
+ *   enc_thread_bench -s 7680x4320 -p yuv444p16 -o g=1:slices=64 1 8 16 32
+ *   enc_thread_bench -t slice -o g=1:slices=64 1 8 16 32
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/crc.h"
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/lfg.h"
+#include "libavutil/macros.h"
+#include "libavutil/mem.h"
+#include "libavutil/parseutils.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+
+#include "libavcodec/avcodec.h"
+
+#define NB_SOURCE_FRAMES 4
+
+/* Smooth gradients with some noise, so that the frames are neither trivial
+ * nor incompressible for lossless encoders. */
+static int fill_frame(AVFrame *frame, int index)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    uint32_t *line = av_malloc_array(frame->width, sizeof(*line));
+    AVLFG lfg;
+
+    if (!line)
+        return AVERROR(ENOMEM);
+
+    av_lfg_init(&lfg, index);
+    for (int c = 0; c < desc->nb_components; c++) {
+        const int shift_w = c == 1 || c == 2 ? desc->log2_chroma_w : 0;
+        const int shift_h = c == 1 || c == 2 ? desc->log2_chroma_h : 0;
+        const int w       = AV_CEIL_RSHIFT(frame->width,  shift_w);
+        const int h       = AV_CEIL_RSHIFT(frame->height, shift_h);
+        const int depth   = desc->comp[c].depth;
+        const uint32_t mask = depth < 32 ? (1U << depth) - 1 : UINT32_MAX;
+
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                uint32_t v = (x * (c + 1) + y * (3 - c) + index * 7) << FFMAX(depth - 10, 0);
+                line[x] = (v + (av_lfg_get(&lfg) & 0xF)) & mask;
+            }
+            av_write_image_line2(line, frame->data, frame->linesize, desc,
+                                 0, y, c, w, 4);
+        }
+    }
+
+    av_free(line);
+    return 0;
+}
+
+static int encode(AVCodecContext *enc, const AVFrame *frame, AVPacket *pkt,
+                  uint32_t *crc, int64_t *size)
+{
+    const AVCRC *crc_table = av_crc_get_table(AV_CRC_32_IEEE_LE);
+    int ret = avcodec_send_frame(enc, frame);
+
+    while (ret >= 0) {
+        ret = avcodec_receive_packet(enc, pkt);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+            return 0;
+        if (ret < 0)
+            break;
+        *crc   = av_crc(crc_table, *crc, pkt->data, pkt->size);
+        *size += pkt->size;
+        av_packet_unref(pkt);
+    }
+    return ret;
+}
+
+static int run(const AVCodec *codec, AVFrame **frames, int nb_frames,
+               int threads, int thread_type, const AVDictionary *opts)
+{
+    AVDictionary *o = NULL;
+    AVCodecContext *enc = NULL;
+    AVPacket *pkt = NULL;
+    uint32_t crc = UINT32_MAX;
+    int64_t size = 0, start, elapsed;
+    int ret;
+
+    enc = avcodec_alloc_context3(codec);
+    pkt = av_packet_alloc();
+    if (!enc || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    enc->width        = frames[0]->width;
+    enc->height       = frames[0]->height;
+    enc->pix_fmt      = frames[0]->format;
+    enc->time_base    = (AVRational){ 1, 25 };
+    enc->thread_count = threads;
+    enc->thread_type  = thread_type;
+
+    av_dict_copy(&o, opts, 0);
+    ret = avcodec_open2(enc, codec, &o);
+    av_dict_free(&o);
+    if (ret < 0)
+        goto end;
+
+    start = av_gettime_relative();
+    for (int i = 0; i < nb_frames; i++) {
+        frames[i % NB_SOURCE_FRAMES]->pts = i;
+        ret = encode(enc, frames[i % NB_SOURCE_FRAMES], pkt, &crc, &size);
+        if (ret < 0)
+            goto end;
+    }
+    ret = encode(enc, NULL, pkt, &crc, &size);
+    if (ret < 0)
+        goto end;
+    elapsed = av_gettime_relative() - start;
+
+    printf("%3d threads: %5d frames in %9.3f ms, %8.2f fps, %12"PRId64" bytes, crc %08"PRIx32"\n",
+           threads, nb_frames, elapsed / 1000.0,
+           nb_frames * 1000000.0 / FFMAX(elapsed, 1), size, crc ^ UINT32_MAX);
+
+end:
+    av_packet_free(&pkt);
+    avcodec_free_context(&enc);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const AVCodec *codec;
+    const char *codec_name = "ffv1";
+    AVFrame *frames[NB_SOURCE_FRAMES] = { NULL };
+    AVDictionary *opts = NULL;
+    enum AVPixelFormat pix_fmt = AV_PIX_FMT_YUV444P16;
+    int width = 3840, height = 2160, nb_frames = 32;
+    int thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    int i, ret = 0;
+
+    for (i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+        const char *arg = argv[i + 1];
+        if (!strcmp(argv[i], "-c")) {
+            codec_name = arg;
+        } else if (!strcmp(argv[i], "-s")) {
+            ret = av_parse_video_size(&width, &height, arg);
+        } else if (!strcmp(argv[i], "-p")) {
+            pix_fmt = av_get_pix_fmt(arg);
+            ret = pix_fmt == AV_PIX_FMT_NONE ? AVERROR(EINVAL) : 0;
+        } else if (!strcmp(argv[i], "-n")) {
+            nb_frames = strtol(arg, NULL, 0);
+        } else if (!strcmp(argv[i], "-t")) {
+            thread_type = !strcmp(arg, "frame") ? FF_THREAD_FRAME :
+                          !strcmp(arg, "slice") ? FF_THREAD_SLICE :
+                          FF_THREAD_FRAME | FF_THREAD_SLICE;
+        } else if (!strcmp(argv[i], "-o")) {
+            ret = av_dict_parse_string(&opts, arg, "=", ":", 0);
+        } else {
+            break;
+        }
+        if (ret < 0) {
+            fprintf(stderr, "Invalid argument '%s' for %s\n", arg, argv[i]);
+            goto end;
+        }
+    }
+
+    if (i >= argc || nb_frames <= 0) {
+        fprintf(stderr, "Usage: %s [-c codec] [-s WxH] [-p pix_fmt] [-n nb_frames] "
+                "[-t frame|slice|both] [-o options] threads [threads ...]\n", argv[0]);
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    codec = avcodec_find_encoder_by_name(codec_name);
+    if (!codec || codec->type != AVMEDIA_TYPE_VIDEO) {
+        fprintf(stderr, "Unknown video encoder '%s'\n", codec_name);
+        ret = AVERROR_ENCODER_NOT_FOUND;
+        goto end;
+    }
+
+    for (int j = 0; j < NB_SOURCE_FRAMES; j++) {
+        frames[j] = av_frame_alloc();
+        if (!frames[j]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        frames[j]->width  = width;
+        frames[j]->height = height;
+        frames[j]->format = pix_fmt;
+        ret = av_frame_get_buffer(frames[j], 0);
+        if (ret < 0 || (ret = fill_frame(frames[j], j)) < 0)
+            goto end;
+    }
+
+    printf("%s %dx%d %s\n", codec->name, width, height, av_get_pix_fmt_name(pix_fmt));
+    for (; i < argc; i++) {
+        ret = run(codec, frames, nb_frames, strtol(argv[i], NULL, 0),
+                  thread_type, opts);
+        if (ret < 0) {
+            fprintf(stderr, "%s threads: %s\n", argv[i], av_err2str(ret));
+            break;
+        }
+    }
+
+end:
+    for (int j = 0; j < NB_SOURCE_FRAMES; j++)
+        av_frame_free(&frames[j]);
+    av_dict_free(&opts);
+    return ret < 0;
+}
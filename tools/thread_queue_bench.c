@@ -0,0 +1,150 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the throughput of the fftools ThreadQueue, comparing the default
+ * mutex-based queue to the lock-free single-producer/single-consumer ring.
+ *
+ * Usage: thread_queue_bench [nb_messages [queue_size]]
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/error.h"
+#include "libavutil/macros.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#include "libavcodec/packet.h"
+
+#include "fftools/thread_queue.h"
+
+typedef struct BenchContext {
+    ThreadQueue *tq;
+    unsigned     nb_messages;
+    int          ret;
+} BenchContext;
+
+static void *producer(void *arg)
+{
+    BenchContext *bc = arg;
+    AVPacket    *pkt = av_packet_alloc();
+
+    if (!pkt) {
+        bc->ret = AVERROR(ENOMEM);
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < bc->nb_messages; i++) {
+        pkt->pts = i;
+        bc->ret  = tq_send(bc->tq, 0, pkt);
+        if (bc->ret < 0)
+            break;
+    }
+    tq_send_finish(bc->tq, 0);
+
+    av_packet_free(&pkt);
+    return NULL;
+}
+
+static int run(const char *name, unsigned flags, unsigned nb_messages,
+               unsigned queue_size)
+{
+    BenchContext bc = { .nb_messages = nb_messages };
+    AVPacket   *pkt = NULL;
+    unsigned received = 0;
+    pthread_t thread;
+    int64_t start, elapsed;
+    int ret;
+
+    bc.tq = tq_alloc(1, queue_size, THREAD_QUEUE_PACKETS, flags);
+    pkt   = av_packet_alloc();
+    if (!bc.tq || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    start = av_gettime_relative();
+
+    ret = pthread_create(&thread, NULL, producer, &bc);
+    if (ret) {
+        ret = AVERROR(ret);
+        goto end;
+    }
+
+    while (1) {
+        int stream_idx;
+
+        ret = tq_receive(bc.tq, &stream_idx, pkt, 0);
+        if (ret < 0)
+            break;
+
+        if (pkt->pts != received) {
+            fprintf(stderr, "%s: got message %"PRId64", expected %u\n",
+                    name, pkt->pts, received);
+            ret = AVERROR_BUG;
+            break;
+        }
+        av_packet_unref(pkt);
+        received++;
+    }
+    tq_receive_finish(bc.tq, 0);
+
+    pthread_join(thread, NULL);
+
+    elapsed = av_gettime_relative() - start;
+
+    if (ret == AVERROR_EOF)
+        ret = bc.ret;
+    if (ret >= 0 && received != nb_messages)
+        ret = AVERROR_BUG;
+    if (ret < 0)
+        goto end;
+
+    printf("%-6s %10u messages in %8.3f ms: %12.0f msg/s\n", name, received,
+           elapsed / 1000.0, received * 1000000.0 / FFMAX(elapsed, 1));
+
+end:
+    av_packet_free(&pkt);
+    tq_free(&bc.tq);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned nb_messages = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+    unsigned queue_size  = argc > 2 ? strtoul(argv[2], NULL, 0) : 8;
+    int ret;
+
+    if (!nb_messages || !queue_size) {
+        fprintf(stderr, "Usage: %s [nb_messages [queue_size]]\n", argv[0]);
+        return 1;
+    }
+
+    ret = run("mutex", 0, nb_messages, queue_size);
+    if (ret >= 0)
+        ret = run("spsc", THREAD_QUEUE_ALLOC_SPSC, nb_messages, queue_size);
+    if (ret < 0) {
+        fprintf(stderr, "Benchmark failed: %s\n", av_err2str(ret));
+        return 1;
+    }
+
+    return 0;
+}